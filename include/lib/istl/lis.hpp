@@ -9,6 +9,9 @@
  * A generic implementation of the Longest Increasing Subsequence algorithm
  * which allows for custom data types, provided that a suitable comparison
  * function is given.
+ * The comparison can be any callable, so it can be inlined. This also allows
+ * computing the LIS over an array of indices into another container, where
+ * the comparison looks up the referenced elements, without copying them.
  */
 
 #ifndef ISTL_LIS_H_
@@ -21,44 +24,50 @@
 
 namespace istl {
 
-template<class T>
-std::vector<T> LIS(const std::vector<T> &points, int64_t begin, int64_t end,
-                   std::function<bool(const T& a,
-                                      const T& b)> compLessThan =
-                                      [](const T& a, const T& b)
-                                      { return a < b; } ) {
+/*
+ * Computes the LIS of points in the range [begin, end) and stores it in retLis.
+ * The compLessThan(a, b) can be any callable comparing two points.
+ * The dp and pred are working buffers. All three vectors are resized as needed,
+ * so they can be reused between calls to avoid repeated allocations.
+*/
+template<class T, class CompLessThan>
+void LIS(const std::vector<T> &points, int64_t begin, int64_t end,
+         const CompLessThan& compLessThan,
+         std::vector<int64_t>& dp, std::vector<int64_t>& pred, std::vector<T>& retLis) {
     /*
      * Based on the Python implementation here:
      * https://rosettacode.org/wiki/Longest_increasing_subsequence#Python
     */
 
+    retLis.clear();
+
     // Sanity check.
     if (points.size() == 0) {
-        return {};
+        return;
     }
     if (end < begin) {
-        return {};
+        return;
     }
 
     // Prepare the DP storage.
     const int64_t n = end - begin;
-    std::vector<int64_t> dp(n + 1, 0);
-    std::vector<int64_t> pred(n + 1, 0);
+    dp.assign(n + 1, 0);
+    pred.assign(n + 1, 0);
     int64_t len = 0;
 
     // Compute the LIS.
     for (int64_t i = 0; i < n; ++i) {
-        int32_t low = 1;
-        int32_t high = len;
+        int64_t low = 1;
+        int64_t high = len;
         while (low <= high) {
-            int32_t mid = (low + high) / 2;
+            const int64_t mid = (low + high) / 2;
             if (compLessThan(points[dp[mid] + begin], points[i + begin])) {
                 low = mid + 1;
             } else {
                 high = mid - 1;
             }
         }
-        const int32_t newLen = low;
+        const int64_t newLen = low;
         pred[i] = dp[newLen - 1];
         dp[newLen] = i;
         if (newLen > len) {
@@ -67,15 +76,27 @@ std::vector<T> LIS(const std::vector<T> &points, int64_t begin, int64_t end,
     }
 
     // Backtrack.
-    std::vector<T> lis;
-    lis.reserve(len);
+    if (len == 0) {
+        return;
+    }
+    retLis.resize(len, points[begin]);
     int64_t k = dp[len];
     for (int64_t i = (len - 1); i >= 0; --i) {
-        lis.emplace_back(points[k + begin]);
+        retLis[i] = points[k + begin];
         k = pred[k];
     }
-    std::reverse(lis.begin(), lis.end());
+}
 
+template<class T>
+std::vector<T> LIS(const std::vector<T> &points, int64_t begin, int64_t end,
+                   std::function<bool(const T& a,
+                                      const T& b)> compLessThan =
+                                      [](const T& a, const T& b)
+                                      { return a < b; } ) {
+    std::vector<int64_t> dp;
+    std::vector<int64_t> pred;
+    std::vector<T> lis;
+    LIS(points, begin, end, compLessThan, dp, pred, lis);
     return lis;
 }
 
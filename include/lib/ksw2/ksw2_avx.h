@@ -0,0 +1,214 @@
+#ifndef KSW2_AVX_H_
+#define KSW2_AVX_H_
+
+/*
+ * Vector helpers for the AVX2 and AVX-512 builds of the extz2/extd2/exts2 kernels.
+ *
+ * The wide kernels keep the 16-byte block layout of the SSE kernels: the same band
+ * rounding, boundary cells and traceback matrix. One instruction processes
+ * KSW_VEC_BLOCKS consecutive blocks, and the last vector of a row only stores the
+ * blocks which the SSE kernel would store, so the results are identical to SSE.
+ *
+ * Only one of the two builds is active in a translation unit, depending on the target
+ * flags of the file (-mavx2, or -mavx512f -mavx512bw).
+ */
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+#include <stdint.h>
+
+#if defined(__AVX512BW__)
+
+// GCC implements several of the AVX-512 intrinsics used below (alignr_epi64, andnot,
+// cvtepi8_epi32) with an undefined pass-through operand, and warns about it once
+// they are inlined into the kernels.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+typedef __m512i ksw_vec_t;
+#define KSW_VEC_BLOCKS 4
+#define KSW_AVX_NAME(name) name##_avx512
+
+static inline ksw_vec_t kv_set1_epi8(int8_t a) { return _mm512_set1_epi8(a); }
+static inline ksw_vec_t kv_loadu(const void* p) { return _mm512_loadu_si512(p); }
+static inline void kv_storeu(void* p, ksw_vec_t a) { _mm512_storeu_si512(p, a); }
+static inline ksw_vec_t kv_add8(ksw_vec_t a, ksw_vec_t b) { return _mm512_add_epi8(a, b); }
+static inline ksw_vec_t kv_sub8(ksw_vec_t a, ksw_vec_t b) { return _mm512_sub_epi8(a, b); }
+static inline ksw_vec_t kv_and(ksw_vec_t a, ksw_vec_t b) { return _mm512_and_si512(a, b); }
+static inline ksw_vec_t kv_or(ksw_vec_t a, ksw_vec_t b) { return _mm512_or_si512(a, b); }
+static inline ksw_vec_t kv_andnot(ksw_vec_t a, ksw_vec_t b) { return _mm512_andnot_si512(a, b); }
+static inline ksw_vec_t kv_max_epi8(ksw_vec_t a, ksw_vec_t b) { return _mm512_max_epi8(a, b); }
+static inline ksw_vec_t kv_min_epi8(ksw_vec_t a, ksw_vec_t b) { return _mm512_min_epi8(a, b); }
+static inline ksw_vec_t kv_max_epu8(ksw_vec_t a, ksw_vec_t b) { return _mm512_max_epu8(a, b); }
+static inline ksw_vec_t kv_min_epu8(ksw_vec_t a, ksw_vec_t b) { return _mm512_min_epu8(a, b); }
+static inline ksw_vec_t kv_cmpeq8(ksw_vec_t a, ksw_vec_t b)
+{
+    return _mm512_movm_epi8(_mm512_cmpeq_epi8_mask(a, b));
+}
+static inline ksw_vec_t kv_cmpgt8(ksw_vec_t a, ksw_vec_t b)
+{
+    return _mm512_movm_epi8(_mm512_cmpgt_epi8_mask(a, b));
+}
+// mask ? b : a, with the mask given as bytes of 0x00 or 0xff
+static inline ksw_vec_t kv_blendv(ksw_vec_t a, ksw_vec_t b, ksw_vec_t mask)
+{
+    return _mm512_mask_blend_epi8(_mm512_movepi8_mask(mask), a, b);
+}
+// bytes [prev[63], cur[0..62]]: the vector shifted by one byte, with the carry from prev
+static inline ksw_vec_t kv_shift1(ksw_vec_t cur, ksw_vec_t prev)
+{
+    return _mm512_alignr_epi8(cur, _mm512_alignr_epi64(cur, prev, 6), 15);
+}
+// stores only the first n 16-byte blocks of a
+static inline void kv_store_blocks(void* p, ksw_vec_t a, int n)
+{
+    if (n == KSW_VEC_BLOCKS)
+        _mm512_storeu_si512(p, a);
+    else
+        _mm512_mask_storeu_epi64(p, (__mmask8)((1U << (2 * n)) - 1), a);
+}
+
+#define KSW_VEC_INT32 16
+
+static inline ksw_vec_t kv_set1_epi32(int32_t a) { return _mm512_set1_epi32(a); }
+static inline ksw_vec_t kv_add32(ksw_vec_t a, ksw_vec_t b) { return _mm512_add_epi32(a, b); }
+static inline ksw_vec_t kv_sub32(ksw_vec_t a, ksw_vec_t b) { return _mm512_sub_epi32(a, b); }
+static inline ksw_vec_t kv_lane_index_epi32(void)
+{
+    return _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+}
+static inline ksw_vec_t kv_cvtepi8_epi32(const int8_t* p)
+{
+    return _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i*)p));
+}
+static inline ksw_vec_t kv_cvtepu8_epi32(const uint8_t* p)
+{
+    return _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)p));
+}
+// loads and stores the first n 32-bit lanes
+static inline ksw_vec_t kv_load_epi32(const int32_t* p, int n)
+{
+    return _mm512_maskz_loadu_epi32((__mmask16)((1U << n) - 1), p);
+}
+static inline void kv_store_epi32(int32_t* p, ksw_vec_t a, int n)
+{
+    _mm512_mask_storeu_epi32(p, (__mmask16)((1U << n) - 1), a);
+}
+// in the first n lanes: if (H > max_H) max_H = H, max_t = t
+static inline void kv_update_max_epi32(ksw_vec_t* max_H_, ksw_vec_t* max_t_, ksw_vec_t H,
+                                       ksw_vec_t t, int n)
+{
+    __mmask16 k = _mm512_cmpgt_epi32_mask(H, *max_H_) & (__mmask16)((1U << n) - 1);
+    *max_H_ = _mm512_mask_mov_epi32(*max_H_, k, H);
+    *max_t_ = _mm512_mask_mov_epi32(*max_t_, k, t);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#else  // AVX2
+
+typedef __m256i ksw_vec_t;
+#define KSW_VEC_BLOCKS 2
+#define KSW_AVX_NAME(name) name##_avx2
+
+static inline ksw_vec_t kv_set1_epi8(int8_t a) { return _mm256_set1_epi8(a); }
+static inline ksw_vec_t kv_loadu(const void* p) { return _mm256_loadu_si256((const __m256i*)p); }
+static inline void kv_storeu(void* p, ksw_vec_t a) { _mm256_storeu_si256((__m256i*)p, a); }
+static inline ksw_vec_t kv_add8(ksw_vec_t a, ksw_vec_t b) { return _mm256_add_epi8(a, b); }
+static inline ksw_vec_t kv_sub8(ksw_vec_t a, ksw_vec_t b) { return _mm256_sub_epi8(a, b); }
+static inline ksw_vec_t kv_and(ksw_vec_t a, ksw_vec_t b) { return _mm256_and_si256(a, b); }
+static inline ksw_vec_t kv_or(ksw_vec_t a, ksw_vec_t b) { return _mm256_or_si256(a, b); }
+static inline ksw_vec_t kv_andnot(ksw_vec_t a, ksw_vec_t b) { return _mm256_andnot_si256(a, b); }
+static inline ksw_vec_t kv_max_epi8(ksw_vec_t a, ksw_vec_t b) { return _mm256_max_epi8(a, b); }
+static inline ksw_vec_t kv_min_epi8(ksw_vec_t a, ksw_vec_t b) { return _mm256_min_epi8(a, b); }
+static inline ksw_vec_t kv_max_epu8(ksw_vec_t a, ksw_vec_t b) { return _mm256_max_epu8(a, b); }
+static inline ksw_vec_t kv_min_epu8(ksw_vec_t a, ksw_vec_t b) { return _mm256_min_epu8(a, b); }
+static inline ksw_vec_t kv_cmpeq8(ksw_vec_t a, ksw_vec_t b) { return _mm256_cmpeq_epi8(a, b); }
+static inline ksw_vec_t kv_cmpgt8(ksw_vec_t a, ksw_vec_t b) { return _mm256_cmpgt_epi8(a, b); }
+// mask ? b : a, with the mask given as bytes of 0x00 or 0xff
+static inline ksw_vec_t kv_blendv(ksw_vec_t a, ksw_vec_t b, ksw_vec_t mask)
+{
+    return _mm256_blendv_epi8(a, b, mask);
+}
+// bytes [prev[31], cur[0..30]]: the vector shifted by one byte, with the carry from prev
+static inline ksw_vec_t kv_shift1(ksw_vec_t cur, ksw_vec_t prev)
+{
+    return _mm256_alignr_epi8(cur, _mm256_permute2x128_si256(prev, cur, 0x21), 15);
+}
+// stores only the first n 16-byte blocks of a
+static inline void kv_store_blocks(void* p, ksw_vec_t a, int n)
+{
+    if (n == KSW_VEC_BLOCKS)
+        _mm256_storeu_si256((__m256i*)p, a);
+    else
+        _mm_storeu_si128((__m128i*)p, _mm256_castsi256_si128(a));
+}
+
+#define KSW_VEC_INT32 8
+
+static inline ksw_vec_t kv_set1_epi32(int32_t a) { return _mm256_set1_epi32(a); }
+static inline ksw_vec_t kv_add32(ksw_vec_t a, ksw_vec_t b) { return _mm256_add_epi32(a, b); }
+static inline ksw_vec_t kv_sub32(ksw_vec_t a, ksw_vec_t b) { return _mm256_sub_epi32(a, b); }
+static inline ksw_vec_t kv_lane_index_epi32(void)
+{
+    return _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+}
+static inline ksw_vec_t kv_cvtepi8_epi32(const int8_t* p)
+{
+    return _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)p));
+}
+static inline ksw_vec_t kv_cvtepu8_epi32(const uint8_t* p)
+{
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p));
+}
+static inline ksw_vec_t kv_lane_mask_epi32(int n)
+{
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32(n), kv_lane_index_epi32());
+}
+// loads and stores the first n 32-bit lanes
+static inline ksw_vec_t kv_load_epi32(const int32_t* p, int n)
+{
+    return _mm256_maskload_epi32(p, kv_lane_mask_epi32(n));
+}
+static inline void kv_store_epi32(int32_t* p, ksw_vec_t a, int n)
+{
+    _mm256_maskstore_epi32(p, kv_lane_mask_epi32(n), a);
+}
+// in the first n lanes: if (H > max_H) max_H = H, max_t = t
+static inline void kv_update_max_epi32(ksw_vec_t* max_H_, ksw_vec_t* max_t_, ksw_vec_t H,
+                                       ksw_vec_t t, int n)
+{
+    ksw_vec_t m = _mm256_and_si256(_mm256_cmpgt_epi32(H, *max_H_), kv_lane_mask_epi32(n));
+    *max_H_ = _mm256_blendv_epi8(*max_H_, H, m);
+    *max_t_ = _mm256_blendv_epi8(*max_t_, t, m);
+}
+
+#endif  // __AVX512BW__
+
+/*
+ * Reduces the lanes of the exact max search to the result of the 4-lane SSE loop.
+ * Lanes j, j + 4, j + 8, ... scan the positions of the SSE lane j, which keeps the first
+ * position with the highest score, and the SSE lanes are then merged in order.
+ */
+static inline void kv_reduce_max_epi32(ksw_vec_t max_H_, ksw_vec_t max_t_, int32_t* max_H,
+                                       int32_t* max_t)
+{
+    int32_t HH[KSW_VEC_INT32], tt[KSW_VEC_INT32], i, j;
+    kv_storeu(HH, max_H_);
+    kv_storeu(tt, max_t_);
+    for (i = 0; i < 4; ++i) {
+        int32_t h = HH[i], ht = tt[i];
+        for (j = i + 4; j < KSW_VEC_INT32; j += 4)
+            if (HH[j] > h || (HH[j] == h && tt[j] < ht)) h = HH[j], ht = tt[j];
+        if (*max_H < h) *max_H = h, *max_t = ht;
+    }
+}
+
+#endif  // __AVX2__
+
+#endif  // KSW2_AVX_H_
@@ -77,6 +77,12 @@ bool TrimCigar(const PacBio::BAM::Cigar& cigar, int32_t windowSize, int32_t minM
 int32_t ScoreCigarAlignment(const PacBio::BAM::Cigar& cigar, int32_t match, int32_t mismatch,
                             int32_t gapOpen, int32_t gapExt);
 
+/// \brief Scores a global alignment known only by its edit distance, in the same way as
+///         ScoreCigarAlignment. The span difference is taken as a single gap, and all other
+///         edits as mismatches. This is exact for such alignments, and an estimate otherwise.
+int32_t ScoreEditDistance(int32_t editDistance, int32_t queryLen, int32_t targetLen, int32_t match,
+                          int32_t mismatch, int32_t gapOpen, int32_t gapExt);
+
 }  // namespace Pancake
 }  // namespace PacBio
 
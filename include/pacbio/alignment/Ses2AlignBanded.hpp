@@ -12,6 +12,7 @@
 #include <sstream>
 #include <vector>
 
+#include <pacbio/alignment/SesMatchExtension.h>
 #include <pacbio/alignment/SesOptions.h>
 #include <pacbio/alignment/SesResults.h>
 
@@ -21,6 +22,19 @@ namespace PacBio {
 namespace Pancake {
 namespace Alignment {
 
+/*
+ * A traceback cell packs the x coordinate of the furthest reaching point on
+ * the diagonal, and the direction to the previous diagonal (prevK - k + 1, which
+ * is in [0, 2]) in the lower 2 bits. This halves the traceback memory compared
+ * to SESTracebackPoint.
+*/
+inline int32_t EncodeTracebackCell(int32_t x, int32_t prevKOffset)
+{
+    return x * 4 + (prevKOffset + 1);
+}
+inline int32_t DecodeTracebackX(int32_t cell) { return cell >> 2; }
+inline int32_t DecodeTracebackDir(int32_t cell) { return cell & 3; }
+
 template <SESAlignMode ALIGN_MODE, SESTrimmingMode TRIM_MODE, SESTracebackMode TRACEBACK>
 SesResults SES2AlignBanded(const char* query, size_t queryLen, const char* target,
                               size_t targetLen, int32_t maxDiffs, int32_t bandwidth,
@@ -69,7 +83,9 @@ SesResults SES2AlignBanded(const char* query, size_t queryLen, const char* targe
     int32_t lastK = 0;
     int32_t lastD = 0;
     int32_t prevK = -1;
-    auto& WMatrix = ss->v2;         // Traceback matrix, implemented as a flat vector. We track the start of each row with dStart.
+    auto& WMatrix = ss->v2Packed;   // Traceback matrix, implemented as a flat vector. We track the start of each row with dStart.
+                                    // Each cell packs the x coordinate and the 2-bit direction to the previous diagonal into
+                                    // a single int32_t. See EncodeTracebackCell.
     auto& dStart = ss->dStart;      // Start of each diff's row in the WMatrix vector. dStart[d] = <WMatrixPos, minK>,
                                     // where WMatrixPos is the index of the element in the WMatrix's flat vector where the row begins,
                                     // and minK is the banding related minimum K for the inner loop.
@@ -101,9 +117,6 @@ SesResults SES2AlignBanded(const char* query, size_t queryLen, const char* targe
         if (rowLen > static_cast<int32_t>(alnPath.capacity())) {
             alnPath.resize(rowLen);
         }
-        if ((rowLen * maxDiffs) > static_cast<int32_t>(WMatrix.capacity())) {
-            WMatrix.resize(rowLen * maxDiffs);
-        }
     }
     // clang-format on
 
@@ -125,6 +138,13 @@ SesResults SES2AlignBanded(const char* query, size_t queryLen, const char* targe
             // Because of banding, we start filling up the row from the beginning which
             // corresponds to minK, and we need to keep track of what minK is.
             dStart[d] = {WMatrixPos, minK};
+
+            // The matrix grows with the rows which are actually computed, instead of
+            // reserving the full rowLen * maxDiffs cells up front.
+            const int32_t rowEnd = WMatrixPos + (maxK - minK + 1);
+            if (rowEnd > static_cast<int32_t>(WMatrix.size())) {
+                WMatrix.resize(std::max(rowEnd, 2 * static_cast<int32_t>(WMatrix.size())));
+            }
         }
         // clang-format on
 
@@ -213,18 +233,9 @@ SesResults SES2AlignBanded(const char* query, size_t queryLen, const char* targe
 
             int32_t x = y + k;
             int32_t minLeft = std::min(qlen - x, tlen - y);
-            const char* querySub = query + x;
-            const char* targetSub = target + y;
-            int32_t moves = 0;
-
-            while (moves < minLeft && querySub[moves] == targetSub[moves]) {
-                ++moves;
-                if constexpr (TRIM_MODE == SESTrimmingMode::Enabled) {
-                    if ((b & MASKC) == 0) {
-                        ++m;
-                    }
-                    b = (b << 1) | 1;
-                }
+            const int32_t moves = CountMatchingPrefix(query + x, target + y, minLeft);
+            if constexpr (TRIM_MODE == SESTrimmingMode::Enabled) {
+                ApplyMatchesToTrimmingWindow(b, m, moves, C);
             }
             y += moves;
             x += moves;
@@ -233,7 +244,7 @@ SesResults SES2AlignBanded(const char* query, size_t queryLen, const char* targe
 
             // clang-format off
             if constexpr (TRACEBACK == SESTracebackMode::Enabled) {
-                WMatrix[WMatrixPos] = {x, prevK};
+                WMatrix[WMatrixPos] = EncodeTracebackCell(x, prevK - k);
                 ++WMatrixPos;
             }
             if constexpr (TRIM_MODE == SESTrimmingMode::Enabled) {
@@ -303,8 +314,9 @@ SesResults SES2AlignBanded(const char* query, size_t queryLen, const char* targe
             std::cerr << "[d = " << (d - 1) << "] b = " << b << ", e = " << e << ", minK = " << minK << ", maxK = " << maxK << "\n";
             std::cerr << "    ";
             for (int32_t k = minK; k < maxK; ++k) {
-                const auto& w = WMatrix[b + k - minK];
-                std::cerr << "\t{k = " << k << ", w.x2 = " << w.x2 << ", y2 = " << (w.x2 - k) << ", w.prevK = " << w.prevK << "}\n";
+                const int32_t w = WMatrix[b + k - minK];
+                const int32_t x2 = DecodeTracebackX(w);
+                std::cerr << "\t{k = " << k << ", x2 = " << x2 << ", y2 = " << (x2 - k) << ", prevK = " << (k + DecodeTracebackDir(w) - 1) << "}\n";
             }
             // std::cerr << "\n";
             std::cerr << "\n";
@@ -312,8 +324,9 @@ SesResults SES2AlignBanded(const char* query, size_t queryLen, const char* targe
         std::cerr << "[d = " << lastD << "] b = " << dStart[lastD].first << ", minK = " << minK << ", lastK = " << lastK << "\n";
         std::cerr << "";
         for (int32_t k = dStart[lastD].second; k <= lastK; ++k) {
-            const auto& w = WMatrix[dStart[lastD].first + k - dStart[lastD].second];
-            std::cerr << "\t{k = " << k << ", w.x2 = " << w.x2 << ", y2 = " << (w.x2 - k) << ", w.prevK = " << w.prevK << "}\n";
+            const int32_t w = WMatrix[dStart[lastD].first + k - dStart[lastD].second];
+            const int32_t x2 = DecodeTracebackX(w);
+            std::cerr << "\t{k = " << k << ", x2 = " << x2 << ", y2 = " << (x2 - k) << ", prevK = " << (k + DecodeTracebackDir(w) - 1) << "}\n";
         }
         std::cerr << "lastD = " << lastD << ", lastK = " << lastK << "\n";
         std::cerr << "\n";
@@ -335,16 +348,15 @@ SesResults SES2AlignBanded(const char* query, size_t queryLen, const char* targe
         while (currD > 0) {
             int32_t currRowStart = dStart[currD].first;
             int32_t currMinK = dStart[currD].second;
-            const auto& currW = WMatrix[currRowStart + currK - currMinK];
-            int32_t x2 = currW.x2;
-            int32_t y2 = currW.x2 - currK;
-            int32_t trPrevK = currW.prevK;
+            const int32_t currW = WMatrix[currRowStart + currK - currMinK];
+            int32_t x2 = DecodeTracebackX(currW);
+            int32_t y2 = x2 - currK;
+            int32_t trPrevK = currK + DecodeTracebackDir(currW) - 1;
 
             int32_t prevRowStart = dStart[currD - 1].first;
             int32_t prevMinK = dStart[currD - 1].second;
-            const auto& prevW = WMatrix[prevRowStart + trPrevK - prevMinK];
-            int32_t prevX2 = prevW.x2;
-            int32_t prevY2 = prevW.x2 - trPrevK;
+            int32_t prevX2 = DecodeTracebackX(WMatrix[prevRowStart + trPrevK - prevMinK]);
+            int32_t prevY2 = prevX2 - trPrevK;
 
             if (currK > trPrevK) {
                 int32_t matches = std::min(x2 - prevX2, y2 - prevY2);
@@ -377,9 +389,8 @@ SesResults SES2AlignBanded(const char* query, size_t queryLen, const char* targe
         {
             int32_t currRowStart = dStart[currD].first;
             int32_t currMinK = dStart[currD].second;
-            const auto& currW = WMatrix[currRowStart + currK - currMinK];
-            int32_t x2 = currW.x2;
-            int32_t y2 = currW.x2 - currK;
+            int32_t x2 = DecodeTracebackX(WMatrix[currRowStart + currK - currMinK]);
+            int32_t y2 = x2 - currK;
             int32_t prevX2 = 0;
             int32_t prevY2 = 0;
 
@@ -12,6 +12,7 @@
 #include <sstream>
 #include <vector>
 
+#include <pacbio/alignment/SesMatchExtension.h>
 #include <pacbio/alignment/SesOptions.h>
 #include <pacbio/alignment/SesResults.h>
 
@@ -59,7 +60,6 @@ SesResults SES2DistanceBanded(const char* query, size_t queryLen, const char* ta
     uint64_t b = 0;
     int32_t m = 0;
     const uint64_t C = 60;
-    const uint64_t MASKC = static_cast<uint64_t>(1) << (C - 1);
 
     for (int32_t d = 0; d < maxDiffs; ++d) {
         ret.numDiffs = d;
@@ -112,18 +112,9 @@ SesResults SES2DistanceBanded(const char* query, size_t queryLen, const char* ta
 
             int32_t x = y + k;
             int32_t minLeft = std::min(qlen - x, tlen - y);
-            const char* querySub = query + x;
-            const char* targetSub = target + y;
-            int32_t moves = 0;
-
-            while (moves < minLeft && querySub[moves] == targetSub[moves]) {
-                ++moves;
-                if constexpr (TRIM_MODE == SESTrimmingMode::Enabled) {
-                    if ((b & MASKC) == 0) {
-                        ++m;
-                    }
-                    b = (b << 1) | 1;
-                }
+            const int32_t moves = CountMatchingPrefix(query + x, target + y, minLeft);
+            if constexpr (TRIM_MODE == SESTrimmingMode::Enabled) {
+                ApplyMatchesToTrimmingWindow(b, m, moves, C);
             }
             y += moves;
             x += moves;
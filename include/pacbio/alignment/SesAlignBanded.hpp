@@ -3,6 +3,7 @@
 #ifndef PANCAKE_ALIGNMENT_SES_ALIGN_BANDED_H
 #define PANCAKE_ALIGNMENT_SES_ALIGN_BANDED_H
 
+#include <algorithm>
 #include <cstdint>
 
 #include <iostream>
@@ -14,6 +15,7 @@
 #include <pbbam/CigarOperation.h>
 
 #include <pacbio/alignment/AlignmentTools.h>
+#include <pacbio/alignment/SesMatchExtension.h>
 #include <pacbio/alignment/SesOptions.h>
 #include <pacbio/alignment/SesResults.h>
 
@@ -132,10 +134,10 @@ SesResults SESAlignBanded(const char* query, size_t queryLen, const char* target
             }
 
             int32_t y = x - k;
-            while (x < N && y < M && query[x] == target[y]) {
-                ++x;
-                ++y;
-            }
+            const int32_t moves =
+                CountMatchingPrefix(query + x, target + y, std::min(N - x, M - y));
+            x += moves;
+            y += moves;
             v[kz] = x;
             u[kz] = x + y;
 
@@ -0,0 +1,96 @@
+// Author: Ivan Sovic
+
+/*
+ * Helpers for the "snake" part of the O(ND) alignment algorithms, which extends
+ * the matches along a diagonal. For high identity alignments this is where most
+ * of the time is spent, so the bytes are compared in blocks instead of one by one.
+*/
+
+#ifndef PANCAKE_ALIGNMENT_SES_MATCH_EXTENSION_H
+#define PANCAKE_ALIGNMENT_SES_MATCH_EXTENSION_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace PacBio {
+namespace Pancake {
+namespace Alignment {
+
+/*
+ * Returns the number of consecutive equal bytes at the beginning of a and b,
+ * comparing at most maxLen bytes. If maxLen <= 0, returns 0.
+ * Blocks of 16 bytes are compared with SSE2, and blocks of 8 bytes with XOR of
+ * two words, where the position of the first difference is the number of
+ * trailing zeros. Both require a little-endian platform.
+*/
+inline int32_t CountMatchingPrefix(const char* a, const char* b, int32_t maxLen)
+{
+    int32_t moves = 0;
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) && defined(__GNUC__)
+#if defined(__SSE2__)
+    for (; (moves + 16) <= maxLen; moves += 16) {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + moves));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + moves));
+        const uint32_t mismatchMask =
+            (~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)))) & 0xFFFFU;
+        if (mismatchMask != 0) {
+            return moves + __builtin_ctz(mismatchMask);
+        }
+    }
+#endif
+    for (; (moves + 8) <= maxLen; moves += 8) {
+        uint64_t wa = 0;
+        uint64_t wb = 0;
+        std::memcpy(&wa, a + moves, sizeof(wa));
+        std::memcpy(&wb, b + moves, sizeof(wb));
+        const uint64_t diff = wa ^ wb;
+        if (diff != 0) {
+            return moves + (__builtin_ctzll(diff) >> 3);
+        }
+    }
+#endif
+
+    while (moves < maxLen && a[moves] == b[moves]) {
+        ++moves;
+    }
+    return moves;
+}
+
+/*
+ * Applies numMatches consecutive matches to the trimming state of the SES
+ * algorithms at once. The state is a bit history b of the last C moves
+ * (1 for a match), and the match count m within that window. For every match
+ * the per-base update is:
+ *      if ((b & (1 << (C - 1))) == 0) ++m;
+ *      b = (b << 1) | 1;
+ * Each step tests one of the top bits of the window, so the bulk update counts
+ * the zero bits among the top min(numMatches, C) bits of the window.
+*/
+inline void ApplyMatchesToTrimmingWindow(uint64_t& b, int32_t& m, int32_t numMatches,
+                                         const uint64_t C)
+{
+    if (numMatches <= 0) {
+        return;
+    }
+    const uint64_t numTested = std::min(static_cast<uint64_t>(numMatches), C);
+    const uint64_t testedBits =
+        (b >> (C - numTested)) & ((static_cast<uint64_t>(1) << numTested) - 1);
+    m += static_cast<int32_t>(numTested) - __builtin_popcountll(testedBits);
+    if (numMatches >= 64) {
+        b = ~static_cast<uint64_t>(0);
+    } else {
+        b = (b << numMatches) | ((static_cast<uint64_t>(1) << numMatches) - 1);
+    }
+}
+
+}  // namespace Alignment
+}  // namespace Pancake
+}  // namespace PacBio
+
+#endif  // PANCAKE_ALIGNMENT_SES_MATCH_EXTENSION_H
@@ -43,6 +43,7 @@ public:
     std::vector<int32_t> v;             // Working row.
     std::vector<int32_t> u;             // Banding.
     std::vector<SESTracebackPoint> v2;  // Traceback matrix.
+    std::vector<int32_t> v2Packed;  // Traceback matrix, with x and the direction packed per cell.
     std::vector<SESPathPoint> alnPath;
     std::vector<std::pair<int32_t, int32_t>> dStart;  // <row start, minK>
 };
@@ -22,6 +22,8 @@ struct OverlapHifiSettings
         static const int32_t QueryBlockEndId = 0;
 
         static constexpr double FreqPercentile = 0.0002;
+        static const int64_t MaxSeedHitsPerQuery = 0;
+        static const int32_t MaxQuerySeedOccurrences = 0;
         static const int64_t MinQueryLen = 50;
         static const int64_t MinTargetLen = 50;
         static const int64_t MaxSeedDistance = 5000;
@@ -47,6 +49,7 @@ struct OverlapHifiSettings
         static const int32_t BestN = 0;
         static const bool UseHPC = false;
         static const bool UseTraceback = false;
+        static const bool CacheTargetRevCmp = false;
         static const bool MaskHomopolymers = false;
         static const bool MaskSimpleRepeats = false;
         static const bool MaskHomopolymerSNPs = false;
@@ -63,6 +66,7 @@ struct OverlapHifiSettings
 
     std::string TargetDBPrefix;
     std::string QueryDBPrefix;
+    std::string SharedTargetFile;
     size_t NumThreads = Defaults::NumThreads;
 
     int32_t TargetBlockId = Defaults::TargetBlockId;
@@ -70,6 +74,8 @@ struct OverlapHifiSettings
     int32_t QueryBlockEndId = Defaults::QueryBlockEndId;
 
     double FreqPercentile = Defaults::FreqPercentile;
+    int64_t MaxSeedHitsPerQuery = Defaults::MaxSeedHitsPerQuery;
+    int32_t MaxQuerySeedOccurrences = Defaults::MaxQuerySeedOccurrences;
     int64_t MinQueryLen = Defaults::MinQueryLen;
     int64_t MinTargetLen = Defaults::MinTargetLen;
     int64_t MaxSeedDistance = Defaults::MaxSeedDistance;
@@ -95,6 +101,7 @@ struct OverlapHifiSettings
     int32_t BestN = Defaults::BestN;
     bool UseHPC = Defaults::UseHPC;
     bool UseTraceback = Defaults::UseTraceback;
+    bool CacheTargetRevCmp = Defaults::CacheTargetRevCmp;
     bool MaskHomopolymers = Defaults::MaskHomopolymers;
     bool MaskSimpleRepeats = Defaults::MaskSimpleRepeats;
     bool MaskHomopolymerSNPs = Defaults::MaskHomopolymerSNPs;
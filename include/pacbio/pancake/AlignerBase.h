@@ -12,6 +12,32 @@
 namespace PacBio {
 namespace Pancake {
 
+enum class AlignmentMode
+{
+    GLOBAL,
+    EXTEND,
+};
+
+/*
+ * One pair of sequences for AlignBatch. The job does not own the sequences.
+*/
+class AlignmentJob
+{
+public:
+    const char* qseq = NULL;
+    int64_t qlen = 0;
+    const char* tseq = NULL;
+    int64_t tlen = 0;
+    AlignmentMode mode = AlignmentMode::GLOBAL;
+
+    AlignmentJob() = default;
+    AlignmentJob(const char* _qseq, int64_t _qlen, const char* _tseq, int64_t _tlen,
+                 AlignmentMode _mode)
+        : qseq(_qseq), qlen(_qlen), tseq(_tseq), tlen(_tlen), mode(_mode)
+    {
+    }
+};
+
 class AlignerBase
 {
 public:
@@ -20,6 +46,65 @@ public:
                                    int64_t tlen) = 0;
     virtual AlignmentResult Extend(const char* qseq, int64_t qlen, const char* tseq,
                                    int64_t tlen) = 0;
+
+    /*
+     * Same as Global and Extend, but the result is written into a caller-owned object.
+     * Aligners which override these reuse the storage of result.cigar, so a caller which
+     * keeps one result object across calls does not allocate per alignment.
+    */
+    virtual void GlobalInto(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen,
+                            AlignmentResult& result)
+    {
+        result = Global(qseq, qlen, tseq, tlen);
+    }
+    virtual void ExtendInto(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen,
+                            AlignmentResult& result)
+    {
+        result = Extend(qseq, qlen, tseq, tlen);
+    }
+
+    /*
+     * Score-only versions of Global and Extend: the result has no CIGAR, but the same
+     * score and end positions. Aligners which override these skip the traceback.
+     * The edit distance aligners (Edlib, SES2) only know the number of edits without the
+     * traceback, so their score is the one of ScoreEditDistance: a single gap for the span
+     * difference and mismatches for the other edits. SES1 counts a mismatch as two indels
+     * without the traceback, so it uses the default.
+    */
+    virtual AlignmentResult GlobalScore(const char* qseq, int64_t qlen, const char* tseq,
+                                        int64_t tlen)
+    {
+        AlignmentResult result = Global(qseq, qlen, tseq, tlen);
+        result.cigar.clear();
+        return result;
+    }
+    virtual AlignmentResult ExtendScore(const char* qseq, int64_t qlen, const char* tseq,
+                                        int64_t tlen)
+    {
+        AlignmentResult result = Extend(qseq, qlen, tseq, tlen);
+        result.cigar.clear();
+        return result;
+    }
+
+    /*
+     * Aligns a batch of independent jobs. The results are in the same order as the jobs.
+     * The default implementation aligns the jobs one after another. Backends can override
+     * it to align several jobs at once. The results vector is resized to the number of
+     * jobs, and the storage of its elements is reused.
+    */
+    virtual void AlignBatch(const std::vector<AlignmentJob>& jobs,
+                            std::vector<AlignmentResult>& results)
+    {
+        results.resize(jobs.size());
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            const auto& job = jobs[i];
+            if (job.mode == AlignmentMode::GLOBAL) {
+                GlobalInto(job.qseq, job.qlen, job.tseq, job.tlen, results[i]);
+            } else {
+                ExtendInto(job.qseq, job.qlen, job.tseq, job.tlen, results[i]);
+            }
+        }
+    }
 };
 
 typedef std::shared_ptr<AlignerBase> AlignerBasePtr;
@@ -0,0 +1,69 @@
+// Author: Ivan Sovic
+
+#ifndef PANCAKE_ALIGNER_BATCH_EXECUTOR_H
+#define PANCAKE_ALIGNER_BATCH_EXECUTOR_H
+
+#include <pacbio/pancake/AlignerBase.h>
+#include <pacbio/pancake/AlignerFactory.h>
+#include <pacbio/pancake/AlignmentParameters.h>
+#include <pbcopper/parallel/FireAndForget.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace PacBio {
+namespace Pancake {
+
+/*
+ * Aligns batches of jobs on a pool of threads which is kept for the lifetime of the
+ * executor. Aligners are not thread safe, so each thread has its own aligner created
+ * by AlignerFactory. The jobs are handed out to the threads one at a time, so that
+ * a few long jobs do not hold up the rest of the batch.
+ * With one thread, the batch goes to the AlignBatch of the single aligner instead.
+ * The executor is an aligner itself, so it can be used in place of the aligner it
+ * wraps: single alignments are done in the calling thread, by the first aligner.
+ * It must not be used from more than one thread at a time, nor from the pool threads.
+*/
+class AlignerBatchExecutor : public AlignerBase
+{
+public:
+    AlignerBatchExecutor(const AlignerType& alignerType, const AlignmentParameters& alnParams,
+                         int32_t numThreads);
+
+    /*
+     * Same as above, but the jobs run on the given pool instead of one owned by the
+     * executor, so that several executors can share the same threads. The pool is not
+     * owned, and has to outlive the executor. The numThreads aligners are handed to the
+     * pool as tasks, so the pool can have any number of threads, but it must not be the
+     * pool which runs the caller, otherwise the tasks can wait for each other forever.
+    */
+    AlignerBatchExecutor(const AlignerType& alignerType, const AlignmentParameters& alnParams,
+                         int32_t numThreads, PacBio::Parallel::FireAndForget* faf);
+    ~AlignerBatchExecutor() override;
+
+    AlignmentResult Global(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen) override;
+    AlignmentResult Extend(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen) override;
+    void GlobalInto(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen,
+                    AlignmentResult& result) override;
+    void ExtendInto(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen,
+                    AlignmentResult& result) override;
+    AlignmentResult GlobalScore(const char* qseq, int64_t qlen, const char* tseq,
+                                int64_t tlen) override;
+    AlignmentResult ExtendScore(const char* qseq, int64_t qlen, const char* tseq,
+                                int64_t tlen) override;
+
+    void AlignBatch(const std::vector<AlignmentJob>& jobs,
+                    std::vector<AlignmentResult>& results) override;
+
+    int32_t NumThreads() const { return static_cast<int32_t>(aligners_.size()); }
+
+private:
+    std::vector<AlignerBasePtr> aligners_;
+    std::unique_ptr<PacBio::Parallel::FireAndForget> fafOwned_;
+    PacBio::Parallel::FireAndForget* faf_ = nullptr;  // Either fafOwned_ or a shared pool.
+};
+
+}  // namespace Pancake
+}  // namespace PacBio
+
+#endif  // PANCAKE_ALIGNER_BATCH_EXECUTOR_H
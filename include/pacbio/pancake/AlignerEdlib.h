@@ -25,6 +25,9 @@ public:
     AlignmentResult Global(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen) override;
     AlignmentResult Extend(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen) override;
 
+    AlignmentResult GlobalScore(const char* qseq, int64_t qlen, const char* tseq,
+                                int64_t tlen) override;
+
 private:
     AlignmentParameters opt_;
 };
@@ -8,6 +8,7 @@
 #include <pacbio/pancake/AlignerKSW2.h>
 #include <pacbio/pancake/AlignerSES1.h>
 #include <pacbio/pancake/AlignerSES2.h>
+#include <pacbio/pancake/AlignerWFA.h>
 #include <pacbio/pancake/AlignmentParameters.h>
 
 namespace PacBio {
@@ -19,6 +20,7 @@ enum class AlignerType
     EDLIB,
     SES1,
     SES2,
+    WFA,
 };
 
 std::string AlignerTypeToString(const AlignerType& alignerType);
@@ -33,6 +33,14 @@ typedef std::unique_ptr<mm_tbuf_t, void (*)(mm_tbuf_t*)> Minimap2ThreadBufferPtr
 class AlignerKSW2;
 std::shared_ptr<AlignerBase> CreateAlignerKSW2(const AlignmentParameters& opt);
 
+/*
+ * The aligner keeps its working memory between calls: the kalloc arena used by KSW2,
+ * the 2-bit encoded sequences and the KSW2 CIGAR buffer. Together with GlobalInto and
+ * ExtendInto, this makes repeated alignments free of heap allocations once the buffers
+ * have grown to the size of the largest alignment. The arena is released if it grows
+ * beyond MAX_KALLOC_CAPACITY_ bytes, so that one huge alignment does not pin its memory.
+ * An instance must not be used from more than one thread at a time.
+*/
 class AlignerKSW2 : public AlignerBase
 {
 public:
@@ -42,18 +50,50 @@ public:
     AlignmentResult Global(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen) override;
     AlignmentResult Extend(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen) override;
 
+    void GlobalInto(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen,
+                    AlignmentResult& result) override;
+    void ExtendInto(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen,
+                    AlignmentResult& result) override;
+
+    AlignmentResult GlobalScore(const char* qseq, int64_t qlen, const char* tseq,
+                                int64_t tlen) override;
+    AlignmentResult ExtendScore(const char* qseq, int64_t qlen, const char* tseq,
+                                int64_t tlen) override;
+
+    /*
+     * Number of global alignments finished at each band level. Level 0 is the initial
+     * band, and each following level is twice as wide as the previous one, up to the
+     * alignMaxBandwidth cap.
+    */
+    const std::vector<int64_t>& GetBandLevelCounts() const { return bandLevelCounts_; }
+
 private:
+    static const size_t MAX_KALLOC_CAPACITY_ = 256 * 1024 * 1024;
+
     AlignmentParameters opt_;
     Minimap2ThreadBufferPtr buffer_;
     int8_t mat_[25];
+    std::vector<uint8_t> qseqInt_;
+    std::vector<uint8_t> tseqInt_;
+    ksw_extz_t ez_;
+    std::vector<int64_t> bandLevelCounts_;
     // mm_idxopt_t iopt_;
     // mm_mapopt_t mopt_;
 
-    static PacBio::Data::Cigar ConvertMinimap2CigarToPbbam_(uint32_t* mm2Cigar, int32_t cigarLen,
-                                                            const std::vector<uint8_t>& qseq,
-                                                            const std::vector<uint8_t>& tseq);
-    static std::vector<uint8_t> ConvertSeqAlphabet_(const char* seq, size_t seqlen,
-                                                    const int8_t* conv_table);
+    void Global_(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen, bool scoreOnly,
+                 AlignmentResult& ret);
+    void Extend_(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen, bool scoreOnly,
+                 AlignmentResult& ret);
+    void ResetArenaIfLarge_();
+
+    static bool PathTouchesBandEdge_(const uint32_t* mm2Cigar, int32_t cigarLen, int32_t bandwidth);
+
+    static void ConvertMinimap2CigarToPbbam_(const uint32_t* mm2Cigar, int32_t cigarLen,
+                                             const std::vector<uint8_t>& qseq,
+                                             const std::vector<uint8_t>& tseq,
+                                             PacBio::Data::Cigar& cigar);
+    static void ConvertSeqAlphabet_(const char* seq, size_t seqlen, const int8_t* conv_table,
+                                    std::vector<uint8_t>& ret);
 
     static void ksw_gen_simple_mat_(int m, int8_t* mat, int8_t a, int8_t b, int8_t sc_ambi);
     // static int mm_test_zdrop_(void* km, const mm_mapopt_t* opt, const uint8_t* qseq,
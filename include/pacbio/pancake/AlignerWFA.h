@@ -0,0 +1,104 @@
+// Author: Ivan Sovic
+
+#ifndef PANCAKE_ALIGNER_WFA_H
+#define PANCAKE_ALIGNER_WFA_H
+
+#include <pacbio/pancake/AlignerBase.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace PacBio {
+namespace Pancake {
+
+class AlignerWFA;
+std::shared_ptr<AlignerBase> CreateAlignerWFA(const AlignmentParameters& opt);
+
+/*
+ * Gap-affine wavefront alignment (WFA, Marco-Sola et al. 2021), with the same scoring
+ * as AlignerKSW2: match bonus, mismatch penalty and a two-piece affine gap penalty,
+ * where a gap of length l costs min(gapOpen1 + l * gapExtend1, gapOpen2 + l * gapExtend2).
+ *
+ * The scores are converted to penalties (Eizenga and Paten 2022), so that the
+ * wavefronts are computed only up to the penalty of the optimal alignment. This takes
+ * O(ns) time for sequences of length n with an alignment penalty s, instead of the
+ * O(nw) of a banded DP, which makes it fast for similar sequences. Global limits the
+ * diagonals with the band heuristic from Minimap2: a band of alignBandwidth * 1.5 + 1
+ * around the main diagonal, or the full band when the span difference is larger than
+ * half of that. The result is the optimal alignment within this band. AlignerKSW2
+ * instead starts from a band which covers the span difference, and doubles it up to
+ * alignMaxBandwidth while the alignment touches the band edge, so the two aligners can
+ * return different alignments for the same pair.
+ *
+ * Extend computes an extension alignment from the beginning of both sequences, and
+ * drops the diagonals which score more than zdrop below the best score found so far
+ * (X-drop). As in AlignerKSW2, the alignment is extended to the end of the query if
+ * that scores better than the maximum minus the endBonus, otherwise it ends at the
+ * maximum. The reported score is the score of the returned alignment.
+ *
+ * Bases are compared as characters, without special scoring of ambiguous bases.
+ * The wavefronts are kept for the traceback, and their memory is reused between calls.
+*/
+class AlignerWFA : public AlignerBase
+{
+public:
+    AlignerWFA(const AlignmentParameters& opt);
+    ~AlignerWFA() override;
+
+    AlignmentResult Global(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen) override;
+    AlignmentResult Extend(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen) override;
+
+private:
+    // Location of one wavefront in the offsets_ buffer. All its components
+    // have the same span of diagonals [lo, hi].
+    struct Wavefront_
+    {
+        int32_t lo = 0;
+        int32_t hi = -1;
+        int64_t start = -1;
+    };
+
+    // Read-only view of one component of a wavefront.
+    struct ComponentView_
+    {
+        const int32_t* data = nullptr;
+        int32_t lo = 0;
+        int32_t hi = -1;
+    };
+
+    // The end cell of an alignment, reached with the penalty s on the diagonal k.
+    struct AlignmentEnd_
+    {
+        int32_t s = -1;
+        int32_t k = 0;
+        int32_t h = 0;
+        int32_t score = 0;
+    };
+
+    AlignmentParameters opt_;
+
+    // Penalties in the wavefront space, divided by their greatest common divisor (scale_).
+    int32_t mismatch_ = 0;
+    int32_t gapOpen1_ = 0;
+    int32_t gapExtend1_ = 0;
+    int32_t gapOpen2_ = 0;
+    int32_t gapExtend2_ = 0;
+    int32_t scale_ = 1;
+    int32_t numComponents_ = 3;
+    int32_t maxStep_ = 0;
+
+    std::vector<Wavefront_> wavefronts_;
+    std::vector<int32_t> offsets_;
+
+    int32_t Get_(int32_t comp, int32_t s, int32_t k) const;
+    ComponentView_ View_(int32_t comp, int32_t s) const;
+    int32_t PenaltyToScore_(int32_t s, int32_t qPos, int32_t tPos) const;
+    bool ComputeWavefront_(int32_t s, const char* qseq, int32_t qlen, const char* tseq,
+                           int32_t tlen, int32_t kMin, int32_t kMax);
+    PacBio::Data::Cigar Backtrack_(const AlignmentEnd_& end) const;
+};
+
+}  // namespace Pancake
+}  // namespace PacBio
+
+#endif  // PANCAKE_ALIGNER_WFA_H
@@ -18,6 +18,7 @@ public:
     int32_t zdrop = 100;                    // Zdrop for alignment extension.
     int32_t zdrop2 = 500;                   // In case the small Zdrop fails, this one is applied. ('zdrop_inv' in Minimap2)
     int32_t alignBandwidth = 500;           // Bandwidth used for alignment of non-long-gap regions.
+    int32_t alignMaxBandwidth = 10000;      // Global alignment doubles the band up to this value if the path touches the band edge.
     int32_t endBonus = 50;                  // Score used at the beginning of alignment extension.
     int32_t matchScore = 2;                 // 'a' in Minimap2.
     int32_t mismatchPenalty = 4;            // 'b' in Minimap2.
@@ -33,6 +34,7 @@ inline std::ostream& operator<<(std::ostream& out, const AlignmentParameters& a)
     out << "zdrop = " << a.zdrop << "\n"
         << "zdrop2 = " << a.zdrop2 << "\n"
         << "alignBandwidth = " << a.alignBandwidth << "\n"
+        << "alignMaxBandwidth = " << a.alignMaxBandwidth << "\n"
         << "endBonus = " << a.endBonus << "\n"
         << "matchScore = " << a.matchScore << "\n"
         << "mismatchPenalty = " << a.mismatchPenalty << "\n"
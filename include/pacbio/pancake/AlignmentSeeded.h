@@ -3,6 +3,7 @@
 #ifndef PANCAKE_ALIGNMENT_SEEDED_H
 #define PANCAKE_ALIGNMENT_SEEDED_H
 
+#include <pacbio/alignment/SesResults.h>
 #include <pacbio/pancake/AlignerFactory.h>
 #include <pacbio/pancake/DPChain.h>
 #include <pacbio/pancake/Overlap.h>
@@ -58,6 +59,38 @@ inline std::ostream& operator<<(std::ostream& os, const AlignmentRegion& b)
     return os;
 }
 
+/*
+ * Internal regions can first be checked for an exact match, then aligned with a banded SES
+ * under a small edit budget, and only then passed to the global aligner. This is the
+ * budget which callers can opt in to: the maximum number of edits the SES fast path takes.
+*/
+constexpr int32_t DEFAULT_REGION_FAST_PATH_MAX_DIFFS = 2;
+
+/*
+ * Number of internal regions aligned by each of the fast path tiers.
+*/
+class RegionAlignmentCounts
+{
+public:
+    int64_t numExact = 0;
+    int64_t numSES = 0;
+    int64_t numAligner = 0;
+
+    RegionAlignmentCounts& operator+=(const RegionAlignmentCounts& b)
+    {
+        numExact += b.numExact;
+        numSES += b.numSES;
+        numAligner += b.numAligner;
+        return *this;
+    }
+};
+inline std::ostream& operator<<(std::ostream& os, const RegionAlignmentCounts& b)
+{
+    os << "numExact = " << b.numExact << ", numSES = " << b.numSES
+       << ", numAligner = " << b.numAligner;
+    return os;
+}
+
 class AlignRegionsGenericResult
 {
 public:
@@ -66,6 +99,24 @@ public:
     int32_t offsetBackQuery = 0;
     int32_t offsetFrontTarget = 0;
     int32_t offsetBackTarget = 0;
+    RegionAlignmentCounts regionCounts;
+};
+
+/*
+ * Buffers of AlignRegionsGeneric. They are owned by the caller, so that their storage
+ * (including the CIGARs of the results and the SES matrices) can be reused between overlaps.
+*/
+class AlignRegionsGenericScratch
+{
+public:
+    std::vector<AlignmentJob> globalJobs;
+    std::vector<AlignmentResult> globalResults;
+    std::vector<int32_t> regionToJob;
+    std::vector<AlignmentResult> fastResults;
+    std::vector<int32_t> regionToFast;
+    AlignmentResult flankResult;
+    std::shared_ptr<Alignment::SESScratchSpace> sesScratch{
+        std::make_shared<Alignment::SESScratchSpace>()};
 };
 
 std::vector<AlignmentRegion> ExtractAlignmentRegions(const std::vector<SeedHit>& inSortedHits,
@@ -79,19 +130,70 @@ AlignmentResult AlignSingleRegion(const char* targetSeq, int32_t targetLen, cons
                                   AlignerBasePtr& alignerGlobal, AlignerBasePtr& alignerExt,
                                   const AlignmentRegion& region);
 
+/*
+ * Same as above, but the result is written into a caller-owned object, so that
+ * its CIGAR storage can be reused between regions.
+*/
+void AlignSingleRegion(const char* targetSeq, int32_t targetLen, const char* querySeqFwd,
+                       const char* querySeqRev, int32_t queryLen, AlignerBasePtr& alignerGlobal,
+                       AlignerBasePtr& alignerExt, const AlignmentRegion& region,
+                       AlignmentResult& alnRes);
+
+/*
+ * Same as above, but a GLOBAL region is passed to alignerGlobal only if it is not an exact
+ * match and it has more than fastPathMaxDiffs edits. The fast paths are disabled if
+ * fastPathMaxDiffs < 0. The tier which aligned the region is added to regionCounts.
+ * Results of the fast paths are scored by ScoreCigarAlignment with the match, mismatch,
+ * gapOpen1 and gapExtend1 of alnParams. The SES fast path reuses the given scratch space.
+*/
+void AlignSingleRegion(const char* targetSeq, int32_t targetLen, const char* querySeqFwd,
+                       const char* querySeqRev, int32_t queryLen, AlignerBasePtr& alignerGlobal,
+                       AlignerBasePtr& alignerExt, const AlignmentRegion& region,
+                       int32_t fastPathMaxDiffs, const AlignmentParameters& alnParams,
+                       const std::shared_ptr<Alignment::SESScratchSpace>& sesScratch,
+                       AlignmentResult& alnRes, RegionAlignmentCounts& regionCounts);
+
 AlignRegionsGenericResult AlignRegionsGeneric(const char* targetSeq, const int32_t targetLen,
                                               const char* queryFwd, const char* queryRev,
                                               const int32_t queryLen,
                                               const std::vector<AlignmentRegion>& regions,
                                               AlignerBasePtr& alignerGlobal,
-                                              AlignerBasePtr& alignerExt);
+                                              AlignerBasePtr& alignerExt, int32_t fastPathMaxDiffs,
+                                              const AlignmentParameters& alnParams);
+
+/*
+ * Same as above, but the buffers are reused from the given scratch.
+*/
+AlignRegionsGenericResult AlignRegionsGeneric(
+    const char* targetSeq, const int32_t targetLen, const char* queryFwd, const char* queryRev,
+    const int32_t queryLen, const std::vector<AlignmentRegion>& regions,
+    AlignerBasePtr& alignerGlobal, AlignerBasePtr& alignerExt, int32_t fastPathMaxDiffs,
+    const AlignmentParameters& alnParams, AlignRegionsGenericScratch& scratch);
 
+/*
+ * Aligns the overlap along the seed hits. The internal region fast paths are disabled.
+*/
 OverlapPtr AlignmentSeeded(const OverlapPtr& ovl, const std::vector<SeedHit>& sortedHits,
                            const char* targetSeq, const int32_t targetLen, const char* queryFwd,
                            const char* queryRev, const int32_t queryLen, int32_t minAlignmentSpan,
                            int32_t maxFlankExtensionDist, AlignerBasePtr& alignerGlobal,
                            AlignerBasePtr& alignerExt);
 
+/*
+ * Same as above, with the edit budget of the internal region fast paths (disabled if < 0)
+ * and the scoring of their results, as in AlignSingleRegion. The buffers of
+ * AlignRegionsGeneric are reused from the given scratch.
+ * The number of regions aligned by each tier is added to regionCounts.
+*/
+OverlapPtr AlignmentSeeded(const OverlapPtr& ovl, const std::vector<SeedHit>& sortedHits,
+                           const char* targetSeq, const int32_t targetLen, const char* queryFwd,
+                           const char* queryRev, const int32_t queryLen, int32_t minAlignmentSpan,
+                           int32_t maxFlankExtensionDist, AlignerBasePtr& alignerGlobal,
+                           AlignerBasePtr& alignerExt, int32_t fastPathMaxDiffs,
+                           const AlignmentParameters& alnParams,
+                           AlignRegionsGenericScratch& scratch,
+                           RegionAlignmentCounts& regionCounts);
+
 }  // namespace Pancake
 }  // namespace PacBio
 
@@ -31,10 +31,31 @@ struct ChainedHits
     ChainedHits(int32_t _targetId, bool _targetRev) : targetId(_targetId), targetRev(_targetRev) {}
 };
 
+/*
+ * Chains the hits with dynamic programming. The predecessors of every hit are
+ * evaluated in AVX2 lanes if the CPU supports it and useSIMD is true; the
+ * results are identical to the scalar evaluation.
+*/
 std::vector<ChainedHits> ChainHits(const SeedHit* hits, int32_t hits_size, int32_t chain_max_skip,
                                    int32_t chain_max_predecessors, int32_t seed_join_dist,
                                    int32_t diag_margin, int32_t min_num_seeds,
-                                   int32_t min_cov_bases, int32_t min_dp_score);
+                                   int32_t min_cov_bases, int32_t min_dp_score,
+                                   bool useSIMD = true);
+
+/*
+ * Chains the hits with the same scoring function as ChainHits, but finds the best
+ * predecessor of every hit with a range maximum query over a segment tree, in the
+ * style of the RMQ chaining in minimap2. This runs in O(n log n) regardless of
+ * the density of the hits, and does not depend on the chainMaxSkip heuristic.
+ * The tree is indexed by the diagonal, so the query covers only the predecessors
+ * within diagMargin. It uses a linear penalty on the distance in both coordinates,
+ * so in addition the maxInnerPredecessors nearest predecessors are scored exactly.
+ * Hits need to be sorted by target ID, strand, target position and query position.
+*/
+std::vector<ChainedHits> ChainHitsRMQ(const SeedHit* hits, int32_t hitsSize,
+                                      int32_t maxInnerPredecessors, int32_t seedJoinDist,
+                                      int32_t diagMargin, int32_t minNumSeeds, int32_t minCovBases,
+                                      int32_t minDPScore);
 
 double ComputeChainDivergence(const std::vector<SeedHit>& hits);
 
@@ -8,6 +8,7 @@
 #include <pacbio/pancake/AlignerBase.h>
 #include <pacbio/pancake/AlignerFactory.h>
 #include <pacbio/pancake/AlignmentParameters.h>
+#include <pacbio/pancake/AlignmentSeeded.h>
 #include <pacbio/pancake/DPChain.h>
 #include <pacbio/pancake/FastaSequenceCached.h>
 #include <pacbio/pancake/Overlap.h>
@@ -18,6 +19,7 @@
 #include <pacbio/pancake/SeqDBReaderCachedBlock.h>
 #include <pacbio/pancake/SequenceSeedsCached.h>
 #include <pacbio/util/CommonTypes.h>
+#include <pbcopper/parallel/FireAndForget.h>
 #include <cstdint>
 #include <memory>
 #include <unordered_map>
@@ -48,11 +50,14 @@ public:
     double secondaryAllowedOverlapFractionTarget = 0.50;
     double secondaryMinScoreFraction = 0.80;
     bool useLIS = true;
+    int32_t chainRMQMinHits = 20000;            // Chain with range maximum queries if there are at least this many hits. Off if <= 0.
+    int32_t chainRMQMaxInnerPredecessors = 32;  // Number of nearest predecessors scored exactly by the RMQ chaining.
 
     // Indexing.
     PacBio::Pancake::SeedDB::SeedDBParameters seedParams{19, 10, 0, false, true, 255, true};
     PacBio::Pancake::SeedDB::SeedDBParameters seedParamsFallback{19, 10, 0, false, true, 255, true};
     double freqPercentile = 0.0002;
+    int32_t maxQuerySeedOccurrences = 0;        // Sub-sample seeds repeating more than this in a query. Off if <= 0.
 
     // Alignment.
     bool align = true;
@@ -62,6 +67,11 @@ public:
     AlignmentParameters alnParamsGlobal;
     AlignerType alignerTypeExt = AlignerType::KSW2;
     AlignmentParameters alnParamsExt;
+    int32_t alignThreads = 1;                   // Threads for aligning the internal regions of one mapping. Off if <= 1.
+    int32_t alignParallelMinQuerySpan = 50000;  // Only mappings with at least this query span are aligned on multiple threads.
+    // Internal regions with at most this many edits skip the global aligner. Off if < 0.
+    // Opt in with DEFAULT_REGION_FAST_PATH_MAX_DIFFS.
+    int32_t alignFastPathMaxDiffs = -1;
 
     // Other.
     bool skipSymmetricOverlaps = false;
@@ -85,6 +95,8 @@ inline std::ostream& operator<<(std::ostream& out, const MapperCLRSettings& a)
         << "minCoveredBases = " << a.minCoveredBases << "\n"
         << "minDPScore = " << a.minDPScore << "\n"
         << "useLIS = " << a.useLIS << "\n"
+        << "chainRMQMinHits = " << a.chainRMQMinHits << "\n"
+        << "chainRMQMaxInnerPredecessors = " << a.chainRMQMaxInnerPredecessors << "\n"
 
         << "secondaryAllowedOverlapFractionQuery = " << a.secondaryAllowedOverlapFractionQuery
         << "\n"
@@ -99,7 +111,9 @@ inline std::ostream& operator<<(std::ostream& out, const MapperCLRSettings& a)
         << "alnParamsGlobal:\n"
         << a.alnParamsGlobal << "alignerTypeExt = " << AlignerTypeToString(a.alignerTypeExt) << "\n"
         << "alnParamsExt:\n"
-        << a.alnParamsExt
+        << a.alnParamsExt << "alignThreads = " << a.alignThreads << "\n"
+        << "alignParallelMinQuerySpan = " << a.alignParallelMinQuerySpan << "\n"
+        << "alignFastPathMaxDiffs = " << a.alignFastPathMaxDiffs << "\n"
 
         << "seedParams.KmerSize = " << a.seedParams.KmerSize << "\n"
         << "seedParams.MinimizerWindow = " << a.seedParams.MinimizerWindow << "\n"
@@ -119,6 +133,7 @@ inline std::ostream& operator<<(std::ostream& out, const MapperCLRSettings& a)
         << "seedParamsFallback.UseRC = " << a.seedParamsFallback.UseRC << "\n"
 
         << "freqPercentile = " << a.freqPercentile << "\n"
+        << "maxQuerySeedOccurrences = " << a.maxQuerySeedOccurrences << "\n"
 
         << "skipSymmetricOverlaps = " << a.skipSymmetricOverlaps << "\n"
         << "minQueryLen = " << a.minQueryLen << "\n"
@@ -145,6 +160,14 @@ class MapperCLR
 {
 public:
     MapperCLR(const MapperCLRSettings& settings);
+
+    /*
+     * Same as above, but if alignThreads > 1, the internal regions of long mappings are
+     * aligned on the given pool instead of one owned by the mapper. This lets the mappers
+     * of several worker threads share one pool. The pool has to outlive the mapper, and
+     * must not be the pool which runs Map.
+    */
+    MapperCLR(const MapperCLRSettings& settings, PacBio::Parallel::FireAndForget* alignPool);
     ~MapperCLR();
 
     std::vector<MapperCLRResult> Map(const std::vector<std::string>& targetSeqs,
@@ -155,10 +178,20 @@ public:
                         const std::vector<PacBio::Pancake::Int128t>& querySeeds,
                         const int32_t queryId, int64_t freqCutoff);
 
+    /*
+     * Number of internal regions aligned by each of the exact match, SES and global
+     * aligner tiers, over all of the mappings aligned by this mapper.
+    */
+    const RegionAlignmentCounts& GetRegionAlignmentCounts() const { return regionAlignmentCounts_; }
+
 private:
     MapperCLRSettings settings_;
     AlignerBasePtr alignerGlobal_;
     AlignerBasePtr alignerExt_;
+    AlignerBasePtr alignerGlobalParallel_;  // Set only if alignThreads > 1.
+    RegionAlignmentCounts regionAlignmentCounts_;
+    DiagonalBucketScratch diagonalBucketScratch_;
+    AlignRegionsGenericScratch alignRegionsScratch_;
 
     static OverlapPtr MakeOverlap_(const std::vector<SeedHit>& sortedHits, int32_t queryId,
                                    int32_t queryLen, const PacBio::Pancake::SeedIndex& index,
@@ -169,13 +202,15 @@ private:
         const PacBio::Pancake::SeedIndex& index, const std::vector<SeedHit>& hits,
         const std::vector<PacBio::Pancake::Range>& hitGroups, int32_t queryId, int32_t queryLen,
         int32_t chainMaxSkip, int32_t chainMaxPredecessors, int32_t maxGap, int32_t chainBandwidth,
-        int32_t minNumSeeds, int32_t minCoveredBases, int32_t minDPScore, bool useLIS);
+        int32_t minNumSeeds, int32_t minCoveredBases, int32_t minDPScore, bool useLIS,
+        int32_t chainRMQMinHits, int32_t chainRMQMaxInnerPredecessors);
 
     static std::vector<std::unique_ptr<ChainedRegion>> ReChainSeedHits_(
         const std::vector<std::unique_ptr<ChainedRegion>>& chainedRegions,
         const PacBio::Pancake::SeedIndex& index, int32_t queryId, int32_t queryLen,
         int32_t chainMaxSkip, int32_t chainMaxPredecessors, int32_t maxGap, int32_t chainBandwidth,
-        int32_t minNumSeeds, int32_t minCoveredBases, int32_t minDPScore);
+        int32_t minNumSeeds, int32_t minCoveredBases, int32_t minDPScore, int32_t chainRMQMinHits,
+        int32_t chainRMQMaxInnerPredecessors);
 
     static void LongMergeChains_(std::vector<std::unique_ptr<ChainedRegion>>& chainedRegions,
                                  int32_t maxGap);
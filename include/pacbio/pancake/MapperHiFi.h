@@ -22,17 +22,53 @@ namespace PacBio {
 namespace Pancake {
 namespace OverlapHiFi {
 
+/*
+ * Reusable memory for mapping queries. Buffers grow to the size required by the
+ * largest query and are then reused, so that mapping many queries does not keep
+ * allocating and freeing memory. One object should be used by at most one thread
+ * at a time.
+*/
+class MapperScratch
+{
+public:
+    // Seed hits of the query, and the working memory used to collect them.
+    std::vector<SeedHit> hits;
+    PacBio::Pancake::DiagonalBucketScratch bucketScratch;
+
+    // IDs of the hits of a single diagonal group and the LIS buffers.
+    std::vector<int32_t> groupHitIds;
+    std::vector<int32_t> groupHitIdsTmp;
+    std::vector<int32_t> groupRunStarts;
+    std::vector<int32_t> lisHitIds;
+    std::vector<SeedHit> lisHits;
+    std::vector<int64_t> lisDp;
+    std::vector<int64_t> lisPred;
+
+    // Reverse complemented query and a window of the target used for alignment.
+    std::string reverseQuerySeq;
+    std::string targetSubseq;
+
+    std::shared_ptr<PacBio::Pancake::Alignment::SESScratchSpace> sesScratch{
+        std::make_shared<PacBio::Pancake::Alignment::SESScratchSpace>()};
+};
+
 class MapperResult
 {
 public:
     std::vector<PacBio::Pancake::OverlapPtr> overlaps;
+    // True if the frequency cutoff was lowered to fit the per-query hit budget.
+    bool hitsCapped = false;
+    // Number of overlaps which were abandoned during alignment because they could no
+    // longer pass the minimum identity filter, and how many of those skipped the reverse pass.
+    int32_t numAlignmentsAborted = 0;
+    int32_t numReversePassesSkipped = 0;
 };
 
 class Mapper
 {
 public:
     Mapper(const OverlapHifiSettings& settings)
-        : settings_{settings}, sesScratch_{std::make_shared<Pancake::Alignment::SESScratchSpace>()}
+        : settings_{settings}, scratch_{std::make_shared<MapperScratch>()}
     {
     }
     ~Mapper() = default;
@@ -46,17 +82,22 @@ public:
     /// \param querySeeds Precomputed seeds for the query sequence. The seeds will not be
     ///                     computed internally like in other mappers.
     /// \param freqCutoff Maximum allowed frequency of any particular seed to retain it.
+    ///                     It is further lowered for queries which would produce more
+    ///                     than MaxSeedHitsPerQuery hits.
+    /// \param scratch Reusable memory for mapping. If nullptr, the Mapper's own scratch space
+    ///                 is used, in which case a Mapper object should not be shared between threads.
     /// \returns An object which contains a vector of all found overlaps.
     ///
     MapperResult Map(const PacBio::Pancake::SeqDBReaderCachedBlock& targetSeqs,
                      const PacBio::Pancake::SeedIndex& index,
                      const PacBio::Pancake::FastaSequenceCached& querySeq,
                      const PacBio::Pancake::SequenceSeedsCached& querySeeds, int64_t freqCutoff,
-                     bool generateFlippedOverlap) const;
+                     bool generateFlippedOverlap,
+                     std::shared_ptr<MapperScratch> scratch = nullptr) const;
 
 private:
     OverlapHifiSettings settings_;
-    std::shared_ptr<PacBio::Pancake::Alignment::SESScratchSpace> sesScratch_;
+    std::shared_ptr<MapperScratch> scratch_;
 
     /// \brief Writes the seed hits to a specified file, in a CSV format, useful for visualization.
     /// The header line contains:
@@ -99,7 +140,8 @@ private:
         const std::vector<SeedHit>& sortedHits,
         const PacBio::Pancake::FastaSequenceCached& querySeq,
         const PacBio::Pancake::SeedIndex& index, int32_t chainBandwidth, int32_t minNumSeeds,
-        int32_t minChainSpan, int32_t minMatch, bool skipSelfHits, bool skipSymmetricOverlaps);
+        int32_t minChainSpan, int32_t minMatch, bool skipSelfHits, bool skipSymmetricOverlaps,
+        MapperScratch& scratch);
 
     /// \brief  Helper function used by FormDiagonalAnchors_ which creates a new overlap object
     ///         based on the minimum and maximum hit IDs.
@@ -137,18 +179,22 @@ private:
     /// \param maskHomopolymers Ignore homopolymer errors when computing the alignment identity.
     ///                             Also, converts them to lowercase in the variant strings.
     /// \param maskSimpleRepeats Ignores indel errors in simple repeats, such as di-nuc.
-    /// \param sesScratch The memory scratch space for alignment. Providing a pointer to default
-    ///                     constructed object is enough.
+    /// \param earlyTermMinIdentity See AlignOverlap_.
+    /// \param scratch The memory scratch space for alignment.
+    /// \param retNumAborted Incremented for each overlap abandoned by the identity bound.
+    /// \param retNumReverseSkipped Incremented for each abandoned overlap which skipped the
+    ///                             reverse pass.
     /// \returns A new vector of overlaps with alignment information and modified coordinates.
     ///
     static std::vector<OverlapPtr> AlignOverlaps_(
         const PacBio::Pancake::SeqDBReaderCachedBlock& targetSeqs,
-        const PacBio::Pancake::FastaSequenceCached& querySeq, const std::string reverseQuerySeq,
+        const PacBio::Pancake::FastaSequenceCached& querySeq, const std::string& reverseQuerySeq,
         const std::vector<OverlapPtr>& overlaps, double alignBandwidth, double alignMaxDiff,
         bool useTraceback, bool noSNPs, bool noIndels, bool maskHomopolymers,
         bool maskSimpleRepeats, bool maskHomopolymerSNPs, bool maskHomopolymersArbitrary,
         bool trimAlignment, int32_t trimWindowSize, double trimMatchFraction, bool trimToFirstMatch,
-        std::shared_ptr<PacBio::Pancake::Alignment::SESScratchSpace> sesScratch);
+        float earlyTermMinIdentity, MapperScratch& scratch, int32_t& retNumAborted,
+        int32_t& retNumReverseSkipped);
 
     /// \brief Generates a set of flipped overlaps from a given set of overlaps. A flipped overlap
     ///         is when the A-read and B-read change places, but the A-read is still always kept in
@@ -164,14 +210,17 @@ private:
     /// \param maskSimpleRepeats Ignores indel errors in simple repeats, such as di-nuc.
     static std::vector<OverlapPtr> GenerateFlippedOverlaps_(
         const PacBio::Pancake::SeqDBReaderCachedBlock& targetSeqs,
-        const PacBio::Pancake::FastaSequenceCached& querySeq, const std::string reverseQuerySeq,
+        const PacBio::Pancake::FastaSequenceCached& querySeq, const std::string& reverseQuerySeq,
         const std::vector<OverlapPtr>& overlaps, bool noSNPs, bool noIndels, bool maskHomopolymers,
-        bool maskSimpleRepeats, bool maskHomopolymerSNPs, bool maskHomopolymersArbitrary);
+        bool maskSimpleRepeats, bool maskHomopolymerSNPs, bool maskHomopolymersArbitrary,
+        MapperScratch& scratch);
 
     /// \brief Performs alignment and alignment extension of a single overlap. Uses the
     ///        banded O(nd) algorithm to align the overlap. The edit distance is
     ///        (pessimistically) estimated using the number of diffs computed by the O(nd).
     /// \param targetSeq The target sequence (B-read) for alignment.
+    /// \param targetSeqRevCmp Reverse complement of the target sequence, or nullptr if the
+    ///                         target block does not hold the reverse complements.
     /// \param querySeq The query sequence (A-read) for alignment.
     /// \param reverseQuerySeq The full reverse-complemented query sequence.
     /// \param ovl The overlap which to align.
@@ -181,22 +230,38 @@ private:
     ///                     This is a parameter of the O(nd) algorithm.
     /// \param useTraceback Runs alignment with traceback, for more accurate
     ///                     identity computation (in terms of mismatches) and CIGAR construction.
-    /// \returns A new vector overlap with alignment information and modified coordinates.
+    /// \param earlyTermMinIdentity If > 0, the minimum identity (in percentage) with which the
+    ///                     overlap would pass FilterOverlaps_. The number of diffs allowed in
+    ///                     each pass is limited so that the overlap can still reach this identity,
+    ///                     and the overlap is abandoned as soon as it cannot. Should only be used
+    ///                     if the identity is not modified after alignment (no traceback).
+    /// \param retReverseSkipped Set to true if the overlap was abandoned before the reverse pass.
+    /// \returns A new vector overlap with alignment information and modified coordinates,
+    ///          or nullptr if the overlap was abandoned.
     ///
     static OverlapPtr AlignOverlap_(
-        const PacBio::Pancake::FastaSequenceCached& targetSeq,
-        const PacBio::Pancake::FastaSequenceCached& querySeq, const std::string reverseQuerySeq,
+        const PacBio::Pancake::FastaSequenceCached& targetSeq, const char* targetSeqRevCmp,
+        const PacBio::Pancake::FastaSequenceCached& querySeq, const std::string& reverseQuerySeq,
         const OverlapPtr& ovl, double alignBandwidth, double alignMaxDiff, bool useTraceback,
         bool noSNPs, bool noIndels, bool maskHomopolymers, bool maskSimpleRepeats,
         bool maskHomopolymerSNPs, bool maskHomopolymersArbitrary, bool trimAlignment,
         int32_t trimWindowSize, double trimMatchFraction, bool trimToFirstMatch,
-        std::shared_ptr<PacBio::Pancake::Alignment::SESScratchSpace> sesScratch);
+        float earlyTermMinIdentity, MapperScratch& scratch, bool& retReverseSkipped);
+
+    /// \brief  Returns the largest number of diffs an overlap spanning span bases can have,
+    ///         and still pass the minimum identity check in FilterOverlaps_ without traceback.
+    ///         Returns -1 if even an exact match would not pass.
+    /// \param span Maximum of the query and target spans of the overlap.
+    /// \param minIdentity Minimum allowed identity, in percentage.
+    ///
+    static int32_t IdentityDiffBudget_(int32_t span, float minIdentity);
 
     static void NormalizeAndExtractVariantsInPlace_(
         OverlapPtr& ovl, const PacBio::Pancake::FastaSequenceCached& targetSeq,
-        const PacBio::Pancake::FastaSequenceCached& querySeq, const std::string reverseQuerySeq,
-        bool noSNPs, bool noIndels, bool maskHomopolymers, bool maskSimpleRepeats,
-        bool maskHomopolymerSNPs, bool maskHomopolymersArbitrary);
+        const char* targetSeqRevCmp, const PacBio::Pancake::FastaSequenceCached& querySeq,
+        const std::string& reverseQuerySeq, bool noSNPs, bool noIndels, bool maskHomopolymers,
+        bool maskSimpleRepeats, bool maskHomopolymerSNPs, bool maskHomopolymersArbitrary,
+        std::string& targetSubseq);
 
     /// \brief Filters overlaps based on the number of seeds, identity, mapped span or length.
     ///
@@ -234,14 +299,32 @@ private:
     /// \param seqStart Start position (0-based) to extract the subsequence.
     /// \param seqEnd End position (0-based, non-inclusive) to extract the subsequence.
     /// \param revCmp True if the sequence should be reverse complemented.
-    /// \return Returns the requested bases as a string.
+    /// \param retSeq Output string for the requested bases. Its memory is reused.
     ///
-    static std::string FetchTargetSubsequence_(
-        const PacBio::Pancake::FastaSequenceCached& targetSeq, int32_t seqStart, int32_t seqEnd,
-        bool revCmp);
+    static void FetchTargetSubsequence_(const PacBio::Pancake::FastaSequenceCached& targetSeq,
+                                        int32_t seqStart, int32_t seqEnd, bool revCmp,
+                                        std::string& retSeq);
+
+    static void FetchTargetSubsequence_(const char* seq, int32_t seqLen, int32_t seqStart,
+                                        int32_t seqEnd, bool revCmp, std::string& retSeq);
 
-    static std::string FetchTargetSubsequence_(const char* seq, int32_t seqLen, int32_t seqStart,
-                                               int32_t seqEnd, bool revCmp);
+    /// \brief  Returns a window of the target sequence for alignment. A forward window points
+    ///         directly into the target sequence, and a reverse complemented window points into
+    ///         the reverse complement of the sequence if it is available. Otherwise, the reverse
+    ///         complemented window is copied into the buffer.
+    /// \param seq The full sequence from which a window should be taken.
+    /// \param seqRevCmp Reverse complement of the full sequence, or nullptr if not available.
+    /// \param seqLen Length of the sequence.
+    /// \param seqStart Start position (0-based, forward strand) of the window.
+    /// \param seqEnd End position (0-based, non-inclusive, forward strand) of the window.
+    /// \param revCmp True if the window should be reverse complemented.
+    /// \param buffer Storage for a reverse complemented window. Its memory is reused.
+    /// \returns Pointer to the bases of the window and its length.
+    ///
+    static std::pair<const char*, int32_t> FetchTargetWindow_(const char* seq,
+                                                              const char* seqRevCmp, int32_t seqLen,
+                                                              int32_t seqStart, int32_t seqEnd,
+                                                              bool revCmp, std::string& buffer);
 };
 
 }  // namespace OverlapHiFi
@@ -50,17 +50,34 @@ void GenerateMinimizers(std::vector<PacBio::Pancake::Int128t>& retSeeds,
                         const bool useReverseComplement, const bool useHPC,
                         const int32_t maxHPCLen);
 
-template <class TargetHashType>
-bool CollectSeedHits(std::vector<SeedHit>& hits, const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
-                     const int64_t querySeedsSize, const int32_t /*queryLen*/,
-                     const TargetHashType& hash,
-                     const PacBio::Pancake::SeedDB::SeedRaw* targetSeeds,
-                     const int64_t /*targetSeedsSize*/, const std::vector<int32_t>& targetLengths,
-                     const int32_t /*kmerSize*/, const int32_t /*spacing*/,
-                     const int64_t freqCutoff)
+/*
+ * Marks which query seeds should be used to collect hits. Keys which occur more than
+ * maxOccurrences times within the query (e.g. in tandem repeats) are sub-sampled down
+ * to maxOccurrences occurrences, spread evenly over all occurrences of the key.
+ * On return retKeep[i] != 0 if the i-th query seed should be used.
+ * If maxOccurrences <= 0 all seeds are kept.
+*/
+void SubsampleRepetitiveQuerySeeds(std::vector<uint8_t>& retKeep,
+                                   const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                                   const int64_t querySeedsSize, const int32_t maxOccurrences);
+
+/*
+ * Same as above, but the sorted <key, ordinal> pairs of the query seeds are built in
+ * sortedQuery, so that its memory can be reused between queries.
+*/
+void SubsampleRepetitiveQuerySeeds(std::vector<uint8_t>& retKeep,
+                                   std::vector<std::pair<int64_t, int64_t>>& sortedQuery,
+                                   const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                                   const int64_t querySeedsSize, const int32_t maxOccurrences);
+
+/*
+ * Creates a hit from a query seed and a single target seed.
+ * Hits on the opposite strand have the target coordinate converted to the reverse strand.
+*/
+inline SeedHit MakeSeedHit(const PacBio::Pancake::SeedDB::Seed& decodedQuery,
+                           const PacBio::Pancake::SeedDB::SeedRaw& targetSeed,
+                           const std::vector<int32_t>& targetLengths)
 {
-    hits.clear();
-
     static auto GetSequenceLength = [](const std::vector<int32_t>& sequenceLengths,
                                        int32_t seqId) -> int32_t {
         // Sanity check for the sequence ID.
@@ -73,14 +90,67 @@ bool CollectSeedHits(std::vector<SeedHit>& hits, const PacBio::Pancake::SeedDB::
         return sequenceLengths[seqId];
     };
 
+    auto decodedTarget = PacBio::Pancake::SeedDB::Seed(targetSeed);
+    bool isRev = false;
+    int32_t targetPos = decodedTarget.pos;  // Start position of the target kmer hit.
+    int32_t queryPos = decodedQuery.pos;    // Start position of the query kmer hit.
+    const int32_t querySpan = decodedQuery.span;
+    const int32_t targetSpan = decodedTarget.span;
+
+    if (decodedQuery.seqRev != decodedTarget.IsRev()) {
+        isRev = true;
+        const int32_t targetLen = GetSequenceLength(targetLengths, decodedTarget.seqID);
+        targetPos = targetLen - (decodedTarget.pos + targetSpan);
+        // queryPos = queryLen - (decodedQuery.pos +
+        //                        querySpan);  // End pos in fwd is start pos in rev.
+    }
+
+    return SeedHit{decodedTarget.seqID, isRev, targetPos, queryPos, targetSpan, querySpan, 0};
+}
+
+/*
+ * Appends one hit for every target seed in the range [targetStart, targetEnd) of
+ * the key-sorted targetSeeds array, paired with the given query seed.
+*/
+inline void AppendSeedHits(std::vector<SeedHit>& hits,
+                           const PacBio::Pancake::SeedDB::Seed& decodedQuery,
+                           const PacBio::Pancake::SeedDB::SeedRaw* targetSeeds,
+                           const int64_t targetStart, const int64_t targetEnd,
+                           const std::vector<int32_t>& targetLengths)
+{
+    for (int64_t i = targetStart; i < targetEnd; ++i) {
+        hits.emplace_back(MakeSeedHit(decodedQuery, targetSeeds[i], targetLengths));
+    }
+}
+
+template <class TargetHashType>
+bool CollectSeedHits(std::vector<SeedHit>& hits, const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                     const int64_t querySeedsSize, const int32_t /*queryLen*/,
+                     const TargetHashType& hash,
+                     const PacBio::Pancake::SeedDB::SeedRaw* targetSeeds,
+                     const int64_t /*targetSeedsSize*/, const std::vector<int32_t>& targetLengths,
+                     const int32_t /*kmerSize*/, const int32_t /*spacing*/,
+                     const int64_t freqCutoff, const int32_t maxQueryKeyOccurrences = 0)
+{
+    hits.clear();
+
+    // Collapse the keys which repeat many times within the query.
+    std::vector<uint8_t> keep;
+    if (maxQueryKeyOccurrences > 0) {
+        SubsampleRepetitiveQuerySeeds(keep, querySeeds, querySeedsSize, maxQueryKeyOccurrences);
+    }
+
     // The +1 is because for every seed base there are Spacing spaces, and the subtraction
     // is because after the last seed base the spaces shouldn't be counted.
     //    const int32_t seedSize = kmerSize * (spacing + 1) - spacing;
 
     for (int64_t seedId = 0; seedId < querySeedsSize; ++seedId) {
+        if (keep.empty() == false && keep[seedId] == 0) {
+            continue;
+        }
         const auto& querySeed = querySeeds[seedId];
         auto decodedQuery = PacBio::Pancake::SeedDB::Seed(querySeed);
-        auto it = hash.find(decodedQuery.key);
+        auto it = hash.find(PacBio::Pancake::SeedDB::Seed::SignExtendKey(decodedQuery.key));
         if (it != hash.end()) {
             int64_t start = std::get<0>(it->second);
             int64_t end = std::get<1>(it->second);
@@ -88,33 +158,46 @@ bool CollectSeedHits(std::vector<SeedHit>& hits, const PacBio::Pancake::SeedDB::
             if (freqCutoff > 0 && (end - start) > freqCutoff) {
                 continue;
             }
-            for (int64_t i = start; i < end; ++i) {
-                auto decodedTarget = PacBio::Pancake::SeedDB::Seed(targetSeeds[i]);
-                bool isRev = false;
-                int32_t targetPos = decodedTarget.pos;  // Start position of the target kmer hit.
-                int32_t queryPos = decodedQuery.pos;    // Start position of the query kmer hit.
-                const int32_t querySpan = decodedQuery.span;
-                const int32_t targetSpan = decodedTarget.span;
-
-                if (decodedQuery.IsRev() != decodedTarget.IsRev()) {
-                    isRev = true;
-                    const int32_t targetLen = GetSequenceLength(targetLengths, decodedTarget.seqID);
-                    targetPos = targetLen - (decodedTarget.pos + targetSpan);
-                    // queryPos = queryLen - (decodedQuery.pos +
-                    //                        querySpan);  // End pos in fwd is start pos in rev.
-                }
-
-                SeedHit hit{decodedTarget.seqID, isRev,     targetPos, queryPos,
-                            targetSpan,          querySpan, 0};
-
-                hits.emplace_back(hit);
-            }
+            AppendSeedHits(hits, decodedQuery, targetSeeds, start, end, targetLengths);
         }
     }
 
     return hits.size() > 0;
 }
 
+/*
+ * Same as CollectSeedHits, but instead of probing a hash table for every query seed,
+ * the query keys are sorted and matched against the key-sorted targetSeeds array
+ * with a galloping merge-join. The target array is accessed strictly left to right,
+ * which is cheaper than random hash probes when the query has many seeds compared
+ * to the size of the target array.
+ * The targetSeeds array needs to be sorted with kx::radix_sort (as in the SeedIndex).
+ * The hits are produced in exactly the same order as with CollectSeedHits.
+*/
+bool CollectSeedHitsMergeJoin(std::vector<SeedHit>& hits,
+                              const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                              const int64_t querySeedsSize, const int32_t queryLen,
+                              const PacBio::Pancake::SeedDB::SeedRaw* targetSeeds,
+                              const int64_t targetSeedsSize,
+                              const std::vector<int32_t>& targetLengths, const int32_t kmerSize,
+                              const int32_t spacing, const int64_t freqCutoff,
+                              const int32_t maxQueryKeyOccurrences = 0);
+
+/*
+ * The lookup of CollectSeedHitsMergeJoin, without constructing the hits.
+ * On return, retRanges[i] is the [start, end) range of the target seeds with the same
+ * key as the i-th query seed (empty if there are none). If maxQueryKeyOccurrences > 0,
+ * retKeep is filled in the same way as by SubsampleRepetitiveQuerySeeds, otherwise it is
+ * cleared. The sortedQuery is working memory, which can be reused between queries.
+*/
+void FindSeedRangesMergeJoin(std::vector<std::pair<int64_t, int64_t>>& retRanges,
+                             std::vector<uint8_t>& retKeep,
+                             std::vector<std::pair<int64_t, int64_t>>& sortedQuery,
+                             const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                             const int64_t querySeedsSize,
+                             const PacBio::Pancake::SeedDB::SeedRaw* targetSeeds,
+                             const int64_t targetSeedsSize, const int32_t maxQueryKeyOccurrences);
+
 }  // namespace SeedDB
 }  // namespace Pancake
 }  // namespace PacBio
@@ -93,6 +93,16 @@ public:
         return ((seed >> (64 + 8)) & MINIMIZER_64bit_MASK);
     }
 
+    /*
+     * DecodeKey sign-extends the 56-bit key, because the coded seed is a signed 128-bit
+     * integer, while the key bitfield of a decoded Seed is zero-extended. This converts
+     * either form into the one returned by DecodeKey, which the seed indices are built with.
+    */
+    static inline uint64_t SignExtendKey(uint64_t key)
+    {
+        return static_cast<uint64_t>(static_cast<int64_t>(key << 8) >> 8);
+    }
+
     static inline uint64_t DecodeSpan(const PacBio::Pancake::Int128t& seed)
     {
         return ((seed >> 64) & MINIMIZER_8bit_MASK);
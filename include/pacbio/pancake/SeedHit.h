@@ -114,6 +114,24 @@ inline std::tuple<int32_t, int32_t, int32_t, int32_t> PackSeedHitWithDiagonalToT
 void CalcHitCoverage(const std::vector<SeedHit>& hits, int32_t hitsBegin, int32_t hitsEnd,
                      int32_t& coveredBasesQuery, int32_t& coveredBasesTarget);
 
+/*
+ * Sorts the seed hits in the same order as PackSeedHitWithDiagonalToTuple would,
+ * i.e. by target ID and strand, diagonal, target position and query position.
+ * Each hit is packed into a 128-bit key (the query position is implied by the diagonal
+ * and the target position, so the low 32 bits hold the index of the hit instead), and
+ * the keys are sorted with kx::radix_sort.
+ * Hits which are equal in all four sorting components keep their relative order.
+*/
+void SortSeedHitsByDiagonal(std::vector<SeedHit>& hits);
+
+/*
+ * Same as above, but reuses the provided buffers for the sorting keys and the
+ * permuted hits, so that repeated calls do not need to allocate memory.
+*/
+void SortSeedHitsByDiagonal(std::vector<SeedHit>& hits,
+                            std::vector<PacBio::Pancake::UInt128t>& keysBuffer,
+                            std::vector<SeedHit>& hitsBuffer);
+
 }  // namespace Pancake
 }  // namespace PacBio
 
@@ -7,7 +7,9 @@
 #include <pacbio/pancake/SeedDBIndexCache.h>
 #include <pacbio/pancake/SeedHit.h>
 #include <cstdint>
+#include <lib/flat_hash_map/flat_hash_map.hpp>
 #include <memory>
+#include <tuple>
 #include <unordered_map>
 #include <vector>
 
@@ -27,6 +29,12 @@
 
 const uint64_t SEED_INDEX_EMPTY_HASH_KEY = 0xFFFFFFFFFFFFFFFF;
 
+/*
+ * CollectHits uses the merge-join lookup instead of the hash lookup when the
+ * query has at least one seed per this many seeds in the index.
+ */
+const int64_t SEED_INDEX_MERGE_JOIN_MAX_TARGET_TO_QUERY_RATIO = 32;
+
 #ifdef SEED_INDEX_USING_UNORDERED_MAP
 #include <unordered_map>
 // Key: kmer hash, Value: pair of <startId, endId> in the seeds_ vector.
@@ -56,6 +64,24 @@ typedef ska::flat_hash_map<uint64_t, std::pair<int64_t, int64_t>> SeedHashType;
 namespace PacBio {
 namespace Pancake {
 
+/*
+ * Working memory of SeedIndex::CollectHitsIntoDiagonalBuckets. Keeping one instance
+ * per thread avoids reallocating the buffers for every query.
+ */
+class DiagonalBucketScratch
+{
+public:
+    std::vector<uint8_t> keep;
+    std::vector<std::pair<int64_t, int64_t>> sortedQuery;
+    std::vector<std::pair<int64_t, int64_t>> queryRanges;
+    std::vector<std::tuple<int64_t, int64_t, int64_t>> ranges;
+    std::vector<SeedHit> unsortedHits;
+    std::vector<int32_t> hitBucketIds;
+    ska::flat_hash_map<uint64_t, int32_t> bucketIds;
+    std::vector<std::pair<uint64_t, int32_t>> sortedBuckets;
+    std::vector<int64_t> bucketOffsets;
+};
+
 class SeedIndex
 {
 public:
@@ -64,18 +90,76 @@ public:
     SeedIndex(const PacBio::Pancake::SeedDB::SeedDBParameters& seedParams,
               const std::vector<int32_t>& sequenceLengths,
               std::vector<PacBio::Pancake::SeedDB::SeedRaw>&& seeds);
+    /*
+     * Creates an index on top of an externally owned array of seeds, which is already
+     * sorted with kx::radix_sort (e.g. a read-only memory mapped SharedTargetBlock).
+     * The seeds are not copied and no hash table is built; all lookups use the merge-join.
+     * The seed array needs to outlive the index.
+     */
+    SeedIndex(std::shared_ptr<PacBio::Pancake::SeedDBIndexCache>& seedDBCache,
+              const PacBio::Pancake::SeedDB::SeedRaw* sortedSeeds, int64_t numSeeds);
     ~SeedIndex();
 
     void ComputeFrequencyStats(double percentileCutoff, int64_t& retFreqMax, double& retFreqAvg,
                                double& retFreqMedian, int64_t& retFreqCutoff) const;
     int64_t GetSeeds(uint64_t key, std::vector<PacBio::Pancake::SeedDB::SeedRaw>& seeds) const;
+    /*
+     * Computes a frequency cutoff for a single query, so that collecting the hits with
+     * it produces at most maxHits hits. The most frequent keys of the query are dropped
+     * first; the least frequent ones are always kept, even if they alone exceed the budget.
+     * Returns freqCutoff unchanged if the budget is not exceeded or if maxHits <= 0.
+     * The retCapped is set to true if the cutoff had to be reduced.
+     * The maxQueryKeyOccurrences has the same meaning as in CollectHits.
+     */
+    int64_t ComputeQueryFreqCutoff(const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                                   int64_t querySeedsSize, int64_t freqCutoff, int64_t maxHits,
+                                   bool& retCapped, int32_t maxQueryKeyOccurrences = 0) const;
+    /*
+     * Collects the hits of the query seeds against the index.
+     * Seeds with frequency in the index above freqCutoff are skipped (if freqCutoff > 0).
+     * Keys which occur more than maxQueryKeyOccurrences times in the query are sub-sampled
+     * down to that many occurrences (if maxQueryKeyOccurrences > 0).
+     */
     bool CollectHits(const std::vector<PacBio::Pancake::SeedDB::SeedRaw>& querySeeds,
-                     int32_t queryLen, std::vector<SeedHit>& hits, int64_t freqCutoff) const;
+                     int32_t queryLen, std::vector<SeedHit>& hits, int64_t freqCutoff,
+                     int32_t maxQueryKeyOccurrences = 0) const;
     bool CollectHits(const PacBio::Pancake::SeedDB::SeedRaw* querySeeds, int64_t querySeedsSize,
-                     int32_t queryLen, std::vector<SeedHit>& hits, int64_t freqCutoff) const;
+                     int32_t queryLen, std::vector<SeedHit>& hits, int64_t freqCutoff,
+                     int32_t maxQueryKeyOccurrences = 0) const;
+    bool CollectHitsHash(const PacBio::Pancake::SeedDB::SeedRaw* querySeeds, int64_t querySeedsSize,
+                         int32_t queryLen, std::vector<SeedHit>& hits, int64_t freqCutoff,
+                         int32_t maxQueryKeyOccurrences = 0) const;
+    bool CollectHitsMergeJoin(const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                              int64_t querySeedsSize, int32_t queryLen, std::vector<SeedHit>& hits,
+                              int64_t freqCutoff, int32_t maxQueryKeyOccurrences = 0) const;
+    /*
+     * Collects the same hits as CollectHits, and returns them in the same order as
+     * SortSeedHitsByDiagonal would, but without sorting the entire set of hits.
+     * The index ranges are looked up the same way as in CollectHits (hash or merge-join).
+     * The first pass decodes every hit once, and counts the hits per target ID, strand and
+     * coarse diagonal bucket (diagonalBucketWidth diagonals wide). The second pass places
+     * every hit into its bucket, and only the buckets are sorted.
+     */
+    bool CollectHitsIntoDiagonalBuckets(const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                                        int64_t querySeedsSize, int32_t queryLen,
+                                        std::vector<SeedHit>& hits, int64_t freqCutoff,
+                                        int32_t diagonalBucketWidth,
+                                        int32_t maxQueryKeyOccurrences = 0) const;
+    /*
+     * Same as above, but reuses the working memory in scratch between calls.
+     */
+    bool CollectHitsIntoDiagonalBuckets(const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                                        int64_t querySeedsSize, int32_t queryLen,
+                                        std::vector<SeedHit>& hits, int64_t freqCutoff,
+                                        int32_t diagonalBucketWidth, DiagonalBucketScratch& scratch,
+                                        int32_t maxQueryKeyOccurrences = 0) const;
 
     const std::vector<int32_t> GetSequenceLengths() const { return sequenceLengths_; }
 
+    const PacBio::Pancake::SeedDB::SeedRaw* GetSortedSeeds() const { return seedsData_; }
+
+    int64_t GetNumSeeds() const { return numSeeds_; }
+
     const PacBio::Pancake::SeedDB::SeedDBParameters& GetSeedParams() const { return seedParams_; }
 
     int32_t GetSequenceLength(int32_t seqId) const
@@ -92,11 +176,24 @@ public:
 
 private:
     std::vector<PacBio::Pancake::SeedDB::SeedRaw> seeds_;
+    // Points either to seeds_ or to an external sorted array of seeds.
+    const PacBio::Pancake::SeedDB::SeedRaw* seedsData_ = nullptr;
+    int64_t numSeeds_ = 0;
+    bool useHash_ = true;
     SeedHashType hash_;
     PacBio::Pancake::SeedDB::SeedDBParameters seedParams_;
     std::vector<int32_t> sequenceLengths_;
 
+    // Pairs of <seed frequency, number of keys with that frequency>, sorted by
+    // frequency. Collected in BuildHash_ for fast computation of seed statistics.
+    std::vector<std::pair<int64_t, int64_t>> freqHistogram_;
+    int64_t numValidKeys_ = 0;
+    int64_t sumFreqs_ = 0;
+
     void BuildHash_();
+    void IndexSortedSeeds_();
+    bool FindKeyRange_(uint64_t key, int64_t& retStart, int64_t& retEnd) const;
+    bool UseMergeJoin_(int64_t querySeedsSize) const;
 };
 
 }  // namespace Pancake
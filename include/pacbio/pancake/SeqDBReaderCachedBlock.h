@@ -32,17 +32,41 @@ public:
     void LoadSequences(const std::vector<int32_t>& seqIds);
     void LoadSequences(const std::vector<std::string>& seqNames);
 
+    /*
+     * Uses already loaded records instead of reading them from the SeqDB, e.g.
+     * sequences from a memory mapped SharedTargetBlock. The bases are not copied,
+     * so the memory they point to needs to outlive this reader. Homopolymer
+     * compression is not applied to these records.
+     */
+    void LoadExternalRecords(const std::vector<FastaSequenceCached>& records);
+
     const FastaSequenceCached& GetSequence(int32_t seqId) const;
     const FastaSequenceCached& GetSequence(const std::string& seqName) const;
     void GetSequence(FastaSequenceCached& record, int32_t seqId);
     void GetSequence(FastaSequenceCached& record, const std::string& seqName);
     const std::vector<FastaSequenceCached>& records() const { return records_; }
 
+    /*
+     * Computes the reverse complement of every loaded sequence, so that reverse strand
+     * windows can be used without copying them. The sequences are split between
+     * numThreads threads. The reverse complements are released when new sequences
+     * are loaded.
+     */
+    void ComputeReverseComplements(int32_t numThreads);
+
+    /*
+     * Returns the reverse complement of the sequence with the given ID, with the same
+     * length as the sequence, or nullptr if ComputeReverseComplements was not called.
+     */
+    const char* GetReverseComplement(int32_t seqId) const;
+
 private:
     std::shared_ptr<PacBio::Pancake::SeqDBIndexCache> seqDBIndexCache_;
     bool useHomopolymerCompression_;
     std::vector<uint8_t> data_;
     std::vector<FastaSequenceCached> records_;
+    std::vector<char> dataRevCmp_;
+    std::vector<const char*> recordsRevCmp_;
 
     // Info to allow random access.
     std::unordered_map<std::string, int32_t> headerToOrdinalId_;
@@ -52,6 +76,8 @@ private:
     void LoadBlockCompressed_(const std::vector<ContiguousFilePart>& parts);
 
     void CompressHomopolymers_();
+
+    void ClearReverseComplements_();
 };
 
 }  // namespace Pancake
@@ -0,0 +1,109 @@
+// Author: Ivan Sovic
+
+/*
+ * A single file which holds the sorted seeds and the sequences of one target block.
+ * The file is memory mapped read-only and shared (MAP_SHARED), so that many processes
+ * mapping against the same target block on the same node keep only one copy of the
+ * target index and sequences in memory (the OS page cache).
+ *
+ * Layout (native endianness):
+ *  - SharedTargetBlockHeader
+ *  - numRecords x SharedTargetBlockRecord
+ *  - Sequence names, concatenated.
+ *  - Sequence bases, concatenated (already HP-compressed, if specified).
+ *  - numSeeds x SeedRaw, sorted with kx::radix_sort, aligned to 16 bytes.
+*/
+
+#ifndef PANCAKE_SHARED_TARGET_BLOCK_H
+#define PANCAKE_SHARED_TARGET_BLOCK_H
+
+#include <pacbio/pancake/FastaSequenceCached.h>
+#include <pacbio/pancake/Seed.h>
+#include <pacbio/pancake/SeedDBParameters.h>
+#include <pacbio/pancake/SeedIndex.h>
+#include <pacbio/pancake/SeqDBReaderCachedBlock.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PacBio {
+namespace Pancake {
+
+static const char SHARED_TARGET_BLOCK_MAGIC[8] = {'P', 'C', 'K', 'S', 'T', 'B', 'L', 'K'};
+static const int32_t SHARED_TARGET_BLOCK_VERSION = 1;
+
+struct SharedTargetBlockHeader
+{
+    char magic[8];
+    int32_t version = 0;
+    int32_t targetBlockId = 0;
+    int32_t kmerSize = 0;
+    int32_t minimizerWindow = 0;
+    int32_t spacing = 0;
+    int32_t maxHPCLen = 0;
+    int32_t useHPC = 0;
+    int32_t useHPCForSeedsOnly = 0;
+    int32_t useRC = 0;
+    int32_t seqsUseHPC = 0;
+    int64_t numRecords = 0;
+    int64_t numSeeds = 0;
+    int64_t recordsOffset = 0;
+    int64_t namesOffset = 0;
+    int64_t basesOffset = 0;
+    int64_t seedsOffset = 0;
+    int64_t fileSize = 0;
+};
+
+struct SharedTargetBlockRecord
+{
+    int32_t seqId = 0;
+    int32_t nameLen = 0;
+    int64_t nameOffset = 0;
+    int64_t basesOffset = 0;
+    int64_t numBases = 0;
+};
+
+class SharedTargetBlock
+{
+public:
+    /// \brief Opens an existing shared target block file and maps it read-only.
+    ///        Throws if the file is not a valid shared target block.
+    SharedTargetBlock(const std::string& filename);
+    ~SharedTargetBlock();
+
+    SharedTargetBlock(const SharedTargetBlock&) = delete;
+    SharedTargetBlock& operator=(const SharedTargetBlock&) = delete;
+
+    /// \brief Writes the sequences and the sorted seeds of a target block into a new file.
+    ///        The data is first written to a temporary file which is then renamed, so
+    ///        other processes never observe a partially written file.
+    static void Write(const std::string& filename, int32_t targetBlockId,
+                      const PacBio::Pancake::SeqDBReaderCachedBlock& seqReader, bool seqsUseHPC,
+                      const PacBio::Pancake::SeedIndex& index);
+
+    int32_t TargetBlockId() const { return header_.targetBlockId; }
+    bool SeqsUseHPC() const { return header_.seqsUseHPC; }
+    PacBio::Pancake::SeedDB::SeedDBParameters SeedParams() const;
+
+    const PacBio::Pancake::SeedDB::SeedRaw* Seeds() const { return seeds_; }
+    int64_t NumSeeds() const { return header_.numSeeds; }
+
+    /// \brief Sequences of the block. The bases point directly into the mapped file.
+    const std::vector<FastaSequenceCached>& Records() const { return records_; }
+
+private:
+    std::string filename_;
+    int fd_ = -1;
+    const uint8_t* data_ = nullptr;
+    int64_t dataSize_ = 0;
+    SharedTargetBlockHeader header_;
+    const PacBio::Pancake::SeedDB::SeedRaw* seeds_ = nullptr;
+    std::vector<FastaSequenceCached> records_;
+
+    void Unmap_();
+};
+
+}  // namespace Pancake
+}  // namespace PacBio
+
+#endif  // PANCAKE_SHARED_TARGET_BLOCK_H
@@ -11,6 +11,7 @@ namespace PacBio {
 namespace Pancake {
 
 __extension__ using Int128t = __int128;
+__extension__ using UInt128t = unsigned __int128;
 
 using HeaderLookupType = ska::flat_hash_map<std::string, int32_t>;
 using IdLookupType = ska::flat_hash_map<int32_t, int32_t>;
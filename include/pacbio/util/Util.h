@@ -145,6 +145,28 @@ inline std::string ReverseComplement(const char* seq, int64_t seqLen, int64_t st
     return ret;
 }
 
+/// \brief Reverse complements seq[start, end) into retSeq. The retSeq is overwritten and
+///        its memory reused, so that it can serve as a buffer across many calls.
+inline void ReverseComplement(const char* seq, int64_t seqLen, int64_t start, int64_t end,
+                              std::string& retSeq)
+{
+    retSeq.clear();
+    if (seqLen == 0) {
+        return;
+    }
+    if (start < 0 || end < 0 || start >= end || start > seqLen || end > seqLen) {
+        std::ostringstream oss;
+        oss << "Invalid start or end in a call to ReverseComplement. start = " << start
+            << ", end = " << end << ", seqLen = " << seqLen << ".";
+        throw std::runtime_error(oss.str());
+    }
+    const int64_t span = end - start;
+    retSeq.resize(span);
+    for (int64_t i = 0; i < span; ++i) {
+        retSeq[i] = PacBio::Pancake::BaseToBaseComplement[static_cast<int32_t>(seq[end - 1 - i])];
+    }
+}
+
 }  // namespace Pancake
 }  // namespace PacBio
 
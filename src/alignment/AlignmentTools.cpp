@@ -2,6 +2,7 @@
 
 #include <pacbio/alignment/AlignmentTools.h>
 
+#include <algorithm>
 #include <array>
 #include <cstring>
 #include <sstream>
@@ -1270,5 +1271,18 @@ int32_t ScoreCigarAlignment(const PacBio::BAM::Cigar& cigar, int32_t match, int3
     return score;
 }
 
+int32_t ScoreEditDistance(int32_t editDistance, int32_t queryLen, int32_t targetLen, int32_t match,
+                          int32_t mismatch, int32_t gapOpen, int32_t gapExt)
+{
+    const int32_t gapLen = std::abs(queryLen - targetLen);
+    const int32_t numX = std::max(0, editDistance - gapLen);
+    const int32_t numEq = std::min(queryLen, targetLen) - numX;
+    int64_t score = static_cast<int64_t>(match) * numEq - static_cast<int64_t>(mismatch) * numX;
+    if (gapLen > 0) {
+        score -= (gapOpen + gapExt * (gapLen - 1));
+    }
+    return score;
+}
+
 }  // namespace Pancake
 }  // namespace PacBio
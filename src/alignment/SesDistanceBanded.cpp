@@ -1,6 +1,7 @@
 // Author: Ivan Sovic
 
 #include <pacbio/alignment/SesDistanceBanded.h>
+#include <pacbio/alignment/SesMatchExtension.h>
 
 #include <algorithm>
 #include <cmath>
@@ -51,10 +52,10 @@ SesResults SESDistanceBanded(const char* query, size_t queryLen, const char* tar
             }
 
             int32_t y = x - k;
-            while (x < N && y < M && query[x] == target[y]) {
-                ++x;
-                ++y;
-            }
+            const int32_t moves =
+                CountMatchingPrefix(query + x, target + y, std::min(N - x, M - y));
+            x += moves;
+            y += moves;
             v[kz] = x;
             u[kz] = x + y;
 
@@ -11,6 +11,7 @@
 #define SIMD_AVX 0x40
 #define SIMD_AVX2 0x80
 #define SIMD_AVX512F 0x100
+#define SIMD_AVX512BW 0x200
 
 #ifndef _MSC_VER
 // adapted from https://github.com/01org/linux-sgx/blob/master/common/inc/internal/linux/cpuid_gnu.h
@@ -30,9 +31,21 @@ void __cpuidex(int cpuid[4], int func_id, int subfunc_id)
 
 static int ksw_simd = -1;
 
+// XCR0, to check that the OS saves the AVX (and AVX-512) register state
+static unsigned long long x86_xgetbv(void)
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (unsigned long long)edx << 32 | eax;
+#endif
+}
+
 static int x86_simd(void)
 {
-    int flag = 0, cpuid[4], max_id;
+    int flag = 0, cpuid[4], max_id, os_avx = 0, os_avx512 = 0;
     __cpuidex(cpuid, 0, 0);
     max_id = cpuid[0];
     if (max_id == 0) return 0;
@@ -44,10 +57,16 @@ static int x86_simd(void)
     if (cpuid[2] >> 19 & 1) flag |= SIMD_SSE4_1;
     if (cpuid[2] >> 20 & 1) flag |= SIMD_SSE4_2;
     if (cpuid[2] >> 28 & 1) flag |= SIMD_AVX;
+    if (cpuid[2] >> 27 & 1) {  // OSXSAVE
+        unsigned long long xcr0 = x86_xgetbv();
+        os_avx = (xcr0 & 0x6) == 0x6;       // XMM and YMM state
+        os_avx512 = (xcr0 & 0xe6) == 0xe6;  // and the opmask and ZMM state
+    }
     if (max_id >= 7) {
         __cpuidex(cpuid, 7, 0);
-        if (cpuid[1] >> 5 & 1) flag |= SIMD_AVX2;
-        if (cpuid[1] >> 16 & 1) flag |= SIMD_AVX512F;
+        if ((cpuid[1] >> 5 & 1) && os_avx) flag |= SIMD_AVX2;
+        if ((cpuid[1] >> 16 & 1) && os_avx512) flag |= SIMD_AVX512F;
+        if ((cpuid[1] >> 30 & 1) && os_avx512) flag |= SIMD_AVX512BW;
     }
     return flag;
 }
@@ -63,7 +82,31 @@ void ksw_extz2_sse(void* km, int qlen, const uint8_t* query, int tlen, const uin
                                 const uint8_t* target, int8_t m, const int8_t* mat, int8_t q,
                                 int8_t e, int w, int zdrop, int end_bonus, int flag,
                                 ksw_extz_t* ez);
+#ifdef KSW_AVX2_DISPATCH
+    extern void ksw_extz2_avx2(void* km, int qlen, const uint8_t* query, int tlen,
+                               const uint8_t* target, int8_t m, const int8_t* mat, int8_t q,
+                               int8_t e, int w, int zdrop, int end_bonus, int flag, ksw_extz_t* ez);
+#endif
+#ifdef KSW_AVX512_DISPATCH
+    extern void ksw_extz2_avx512(void* km, int qlen, const uint8_t* query, int tlen,
+                                 const uint8_t* target, int8_t m, const int8_t* mat, int8_t q,
+                                 int8_t e, int w, int zdrop, int end_bonus, int flag,
+                                 ksw_extz_t* ez);
+#endif
     if (ksw_simd < 0) ksw_simd = x86_simd();
+#ifdef KSW_AVX512_DISPATCH
+    if ((ksw_simd & SIMD_AVX512F) && (ksw_simd & SIMD_AVX512BW)) {
+        ksw_extz2_avx512(km, qlen, query, tlen, target, m, mat, q, e, w, zdrop, end_bonus, flag,
+                         ez);
+        return;
+    }
+#endif
+#ifdef KSW_AVX2_DISPATCH
+    if (ksw_simd & SIMD_AVX2) {
+        ksw_extz2_avx2(km, qlen, query, tlen, target, m, mat, q, e, w, zdrop, end_bonus, flag, ez);
+        return;
+    }
+#endif
     if (ksw_simd & SIMD_SSE4_1)
         ksw_extz2_sse41(km, qlen, query, tlen, target, m, mat, q, e, w, zdrop, end_bonus, flag, ez);
     else if (ksw_simd & SIMD_SSE2)
@@ -84,7 +127,33 @@ void ksw_extd2_sse(void* km, int qlen, const uint8_t* query, int tlen, const uin
                                 const uint8_t* target, int8_t m, const int8_t* mat, int8_t q,
                                 int8_t e, int8_t q2, int8_t e2, int w, int zdrop, int end_bonus,
                                 int flag, ksw_extz_t* ez);
+#ifdef KSW_AVX2_DISPATCH
+    extern void ksw_extd2_avx2(void* km, int qlen, const uint8_t* query, int tlen,
+                               const uint8_t* target, int8_t m, const int8_t* mat, int8_t q,
+                               int8_t e, int8_t q2, int8_t e2, int w, int zdrop, int end_bonus,
+                               int flag, ksw_extz_t* ez);
+#endif
+#ifdef KSW_AVX512_DISPATCH
+    extern void ksw_extd2_avx512(void* km, int qlen, const uint8_t* query, int tlen,
+                                 const uint8_t* target, int8_t m, const int8_t* mat, int8_t q,
+                                 int8_t e, int8_t q2, int8_t e2, int w, int zdrop, int end_bonus,
+                                 int flag, ksw_extz_t* ez);
+#endif
     if (ksw_simd < 0) ksw_simd = x86_simd();
+#ifdef KSW_AVX512_DISPATCH
+    if ((ksw_simd & SIMD_AVX512F) && (ksw_simd & SIMD_AVX512BW)) {
+        ksw_extd2_avx512(km, qlen, query, tlen, target, m, mat, q, e, q2, e2, w, zdrop, end_bonus,
+                         flag, ez);
+        return;
+    }
+#endif
+#ifdef KSW_AVX2_DISPATCH
+    if (ksw_simd & SIMD_AVX2) {
+        ksw_extd2_avx2(km, qlen, query, tlen, target, m, mat, q, e, q2, e2, w, zdrop, end_bonus,
+                       flag, ez);
+        return;
+    }
+#endif
     if (ksw_simd & SIMD_SSE4_1)
         ksw_extd2_sse41(km, qlen, query, tlen, target, m, mat, q, e, q2, e2, w, zdrop, end_bonus,
                         flag, ez);
@@ -107,7 +176,31 @@ void ksw_exts2_sse(void* km, int qlen, const uint8_t* query, int tlen, const uin
                                 const uint8_t* target, int8_t m, const int8_t* mat, int8_t q,
                                 int8_t e, int8_t q2, int8_t noncan, int zdrop, int flag,
                                 ksw_extz_t* ez);
+#ifdef KSW_AVX2_DISPATCH
+    extern void ksw_exts2_avx2(void* km, int qlen, const uint8_t* query, int tlen,
+                               const uint8_t* target, int8_t m, const int8_t* mat, int8_t q,
+                               int8_t e, int8_t q2, int8_t noncan, int zdrop, int flag,
+                               ksw_extz_t* ez);
+#endif
+#ifdef KSW_AVX512_DISPATCH
+    extern void ksw_exts2_avx512(void* km, int qlen, const uint8_t* query, int tlen,
+                                 const uint8_t* target, int8_t m, const int8_t* mat, int8_t q,
+                                 int8_t e, int8_t q2, int8_t noncan, int zdrop, int flag,
+                                 ksw_extz_t* ez);
+#endif
     if (ksw_simd < 0) ksw_simd = x86_simd();
+#ifdef KSW_AVX512_DISPATCH
+    if ((ksw_simd & SIMD_AVX512F) && (ksw_simd & SIMD_AVX512BW)) {
+        ksw_exts2_avx512(km, qlen, query, tlen, target, m, mat, q, e, q2, noncan, zdrop, flag, ez);
+        return;
+    }
+#endif
+#ifdef KSW_AVX2_DISPATCH
+    if (ksw_simd & SIMD_AVX2) {
+        ksw_exts2_avx2(km, qlen, query, tlen, target, m, mat, q, e, q2, noncan, zdrop, flag, ez);
+        return;
+    }
+#endif
     if (ksw_simd & SIMD_SSE4_1)
         ksw_exts2_sse41(km, qlen, query, tlen, target, m, mat, q, e, q2, noncan, zdrop, flag, ez);
     else if (ksw_simd & SIMD_SSE2)
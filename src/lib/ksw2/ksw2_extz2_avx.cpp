@@ -0,0 +1,296 @@
+#include <assert.h>
+#include <string.h>
+#include "ksw2.h"
+#include "ksw2_avx.h"
+
+#if defined(__AVX2__) && defined(KSW_CPU_DISPATCH)
+
+// Same algorithm as ksw_extz2_sse41(), with KSW_VEC_BLOCKS 16-byte blocks per vector.
+void KSW_AVX_NAME(ksw_extz2)(void* km, int qlen, const uint8_t* query, int tlen,
+                             const uint8_t* target, int8_t m, const int8_t* mat, int8_t q, int8_t e,
+                             int w, int zdrop, int end_bonus, int flag, ksw_extz_t* ez)
+{
+    int r, t, qe = q + e, n_col_, *off = 0, *off_end = 0, tlen_, qlen_, last_st, last_en, wl, wr,
+              max_sc, min_sc;
+    int with_cigar = !(flag & KSW_EZ_SCORE_ONLY), approx_max = !!(flag & KSW_EZ_APPROX_MAX);
+    int32_t *H = 0, H0 = 0, last_H0_t = 0;
+    uint8_t *qr, *sf, *mem, *mem2 = 0;
+    ksw_vec_t q_, qe2_, zero_, flag1_, flag2_, flag8_, flag16_, sc_mch_, sc_mis_, sc_N_, m1_,
+        max_sc_;
+    __m128i *u, *v, *x, *y, *s, *p = 0;
+
+    ksw_reset_extz(ez);
+    if (m <= 0 || qlen <= 0 || tlen <= 0) return;
+
+    zero_ = kv_set1_epi8(0);
+    q_ = kv_set1_epi8(q);
+    qe2_ = kv_set1_epi8((q + e) * 2);
+    flag1_ = kv_set1_epi8(1);
+    flag2_ = kv_set1_epi8(2);
+    flag8_ = kv_set1_epi8(0x08);
+    flag16_ = kv_set1_epi8(0x10);
+    sc_mch_ = kv_set1_epi8(mat[0]);
+    sc_mis_ = kv_set1_epi8(mat[1]);
+    sc_N_ = mat[m * m - 1] == 0 ? kv_set1_epi8(-e) : kv_set1_epi8(mat[m * m - 1]);
+    m1_ = kv_set1_epi8(m - 1);  // wildcard
+    max_sc_ = kv_set1_epi8(mat[0] + (q + e) * 2);
+
+    if (w < 0) w = tlen > qlen ? tlen : qlen;
+    wl = wr = w;
+    tlen_ = (tlen + 15) / 16;
+    n_col_ = qlen < tlen ? qlen : tlen;
+    n_col_ = ((n_col_ < w + 1 ? n_col_ : w + 1) + 15) / 16 + 1;
+    qlen_ = (qlen + 15) / 16;
+    for (t = 1, max_sc = mat[0], min_sc = mat[1]; t < m * m; ++t) {
+        max_sc = max_sc > mat[t] ? max_sc : mat[t];
+        min_sc = min_sc < mat[t] ? min_sc : mat[t];
+    }
+    if (-min_sc > 2 * (q + e)) return;  // otherwise, we won't see any mismatches
+
+    // Same layout as in SSE, with room for one full vector read past the last array.
+    mem = (uint8_t*)kcalloc(km, tlen_ * 6 + qlen_ + 1 + KSW_VEC_BLOCKS, 16);
+    u = (__m128i*)(((size_t)mem + 15) >> 4 << 4);  // 16-byte aligned
+    v = u + tlen_, x = v + tlen_, y = x + tlen_, s = y + tlen_, sf = (uint8_t*)(s + tlen_),
+    qr = sf + tlen_ * 16;
+    if (!approx_max) {
+        H = (int32_t*)kmalloc(km, tlen_ * 16 * 4);
+        for (t = 0; t < tlen_ * 16; ++t)
+            H[t] = KSW_NEG_INF;
+    }
+    if (with_cigar) {
+        mem2 = (uint8_t*)kmalloc(km, ((size_t)(qlen + tlen - 1) * n_col_ + 1) * 16);
+        p = (__m128i*)(((size_t)mem2 + 15) >> 4 << 4);
+        off = (int*)kmalloc(km, (qlen + tlen - 1) * sizeof(int) * 2);
+        off_end = off + qlen + tlen - 1;
+    }
+
+    for (t = 0; t < qlen; ++t)
+        qr[t] = query[qlen - 1 - t];
+    memcpy(sf, target, tlen);
+
+    for (r = 0, last_st = last_en = -1; r < qlen + tlen - 1; ++r) {
+        int st = 0, en = tlen - 1, st0, en0, st_, en_;
+        int8_t x1, v1;
+        uint8_t *qrr = qr + (qlen - 1 - r), *u8 = (uint8_t *)u, *v8 = (uint8_t *)v;
+        ksw_vec_t x1_, v1_;
+        // find the boundaries
+        if (st < r - qlen + 1) st = r - qlen + 1;
+        if (en > r) en = r;
+        if (st<(r - wr + 1)>> 1) st = (r - wr + 1) >> 1;  // take the ceil
+        if (en > (r + wl) >> 1) en = (r + wl) >> 1;       // take the floor
+        if (st > en) {
+            ez->zdropped = 1;
+            break;
+        }
+        st0 = st, en0 = en;
+        st = st / 16 * 16, en = (en + 16) / 16 * 16 - 1;
+        // set boundary conditions
+        if (st > 0) {
+            if (st - 1 >= last_st && st - 1 <= last_en)
+                x1 = ((uint8_t*)x)[st - 1],
+                v1 = v8[st - 1];  // (r-1,s-1) calculated in the last round
+            else
+                x1 = v1 = 0;  // not calculated; set to zeros
+        } else
+            x1 = 0, v1 = r ? q : 0;
+        if (en >= r) ((uint8_t*)y)[r] = 0, u8[r] = r ? q : 0;
+        // loop fission: set scores first
+        if (!(flag & KSW_EZ_GENERIC_SC)) {
+            // the same 16-byte blocks as in SSE are stored, starting at st0
+            for (t = st0; t <= en0; t += KSW_VEC_BLOCKS * 16) {
+                ksw_vec_t sq, sr, tmp, mask;
+                int nb = (en0 - t) / 16 + 1;
+                sq = kv_loadu(&sf[t]);
+                sr = kv_loadu(&qrr[t]);
+                mask = kv_or(kv_cmpeq8(sq, m1_), kv_cmpeq8(sr, m1_));
+                tmp = kv_cmpeq8(sq, sr);
+                tmp = kv_blendv(sc_mis_, sc_mch_, tmp);
+                tmp = kv_blendv(tmp, sc_N_, mask);
+                kv_store_blocks((uint8_t*)s + t, tmp, nb < KSW_VEC_BLOCKS ? nb : KSW_VEC_BLOCKS);
+            }
+        } else {
+            for (t = st0; t <= en0; ++t)
+                ((uint8_t*)s)[t] = mat[sf[t] * m + qrr[t]];
+        }
+        // core loop
+        x1_ = kv_set1_epi8(x1);
+        v1_ = kv_set1_epi8(v1);
+        st_ = st / 16, en_ = en / 16;
+        assert(en_ - st_ + 1 <= n_col_);
+        if (!with_cigar) {  // score only
+            for (t = st_; t <= en_; t += KSW_VEC_BLOCKS) {
+                ksw_vec_t z, a, b, xt1, vt1, ut, tmp;
+                int nb = en_ - t + 1 < KSW_VEC_BLOCKS ? en_ - t + 1 : KSW_VEC_BLOCKS;
+                z = kv_add8(kv_loadu(&s[t]), qe2_);
+                tmp = kv_loadu(&x[t]);
+                xt1 = kv_shift1(tmp, x1_); /* xt1 <- x[r-1][t-1..t+W-2] */
+                x1_ = tmp;
+                tmp = kv_loadu(&v[t]);
+                vt1 = kv_shift1(tmp, v1_); /* vt1 <- v[r-1][t-1..t+W-2] */
+                v1_ = tmp;
+                a = kv_add8(xt1, vt1);
+                ut = kv_loadu(&u[t]);
+                b = kv_add8(kv_loadu(&y[t]), ut);
+                z = kv_max_epi8(z, a);
+                z = kv_max_epu8(z, b);
+                z = kv_min_epu8(z, max_sc_);
+                kv_store_blocks(&u[t], kv_sub8(z, vt1), nb);
+                kv_store_blocks(&v[t], kv_sub8(z, ut), nb);
+                z = kv_sub8(z, q_);
+                a = kv_sub8(a, z);
+                b = kv_sub8(b, z);
+                kv_store_blocks(&x[t], kv_max_epi8(a, zero_), nb);
+                kv_store_blocks(&y[t], kv_max_epi8(b, zero_), nb);
+            }
+        } else if (!(flag & KSW_EZ_RIGHT)) {  // gap left-alignment
+            __m128i* pr = p + (size_t)r * n_col_ - st_;
+            off[r] = st, off_end[r] = en;
+            for (t = st_; t <= en_; t += KSW_VEC_BLOCKS) {
+                ksw_vec_t d, z, a, b, xt1, vt1, ut, tmp;
+                int nb = en_ - t + 1 < KSW_VEC_BLOCKS ? en_ - t + 1 : KSW_VEC_BLOCKS;
+                z = kv_add8(kv_loadu(&s[t]), qe2_);
+                tmp = kv_loadu(&x[t]);
+                xt1 = kv_shift1(tmp, x1_);
+                x1_ = tmp;
+                tmp = kv_loadu(&v[t]);
+                vt1 = kv_shift1(tmp, v1_);
+                v1_ = tmp;
+                a = kv_add8(xt1, vt1);
+                ut = kv_loadu(&u[t]);
+                b = kv_add8(kv_loadu(&y[t]), ut);
+                d = kv_and(kv_cmpgt8(a, z), flag1_);  // d = a > z? 1 : 0
+                z = kv_max_epi8(z, a);
+                tmp = kv_cmpgt8(b, z);
+                d = kv_blendv(d, flag2_, tmp);  // d = b > z? 2 : d
+                z = kv_max_epu8(z, b);
+                z = kv_min_epu8(z, max_sc_);
+                kv_store_blocks(&u[t], kv_sub8(z, vt1), nb);
+                kv_store_blocks(&v[t], kv_sub8(z, ut), nb);
+                z = kv_sub8(z, q_);
+                a = kv_sub8(a, z);
+                b = kv_sub8(b, z);
+                tmp = kv_cmpgt8(a, zero_);
+                kv_store_blocks(&x[t], kv_and(tmp, a), nb);
+                d = kv_or(d, kv_and(tmp, flag8_));  // d = a > 0? 0x08 : 0
+                tmp = kv_cmpgt8(b, zero_);
+                kv_store_blocks(&y[t], kv_and(tmp, b), nb);
+                d = kv_or(d, kv_and(tmp, flag16_));  // d = b > 0? 0x10 : 0
+                kv_store_blocks(&pr[t], d, nb);
+            }
+        } else {  // gap right-alignment
+            __m128i* pr = p + (size_t)r * n_col_ - st_;
+            off[r] = st, off_end[r] = en;
+            for (t = st_; t <= en_; t += KSW_VEC_BLOCKS) {
+                ksw_vec_t d, z, a, b, xt1, vt1, ut, tmp;
+                int nb = en_ - t + 1 < KSW_VEC_BLOCKS ? en_ - t + 1 : KSW_VEC_BLOCKS;
+                z = kv_add8(kv_loadu(&s[t]), qe2_);
+                tmp = kv_loadu(&x[t]);
+                xt1 = kv_shift1(tmp, x1_);
+                x1_ = tmp;
+                tmp = kv_loadu(&v[t]);
+                vt1 = kv_shift1(tmp, v1_);
+                v1_ = tmp;
+                a = kv_add8(xt1, vt1);
+                ut = kv_loadu(&u[t]);
+                b = kv_add8(kv_loadu(&y[t]), ut);
+                d = kv_andnot(kv_cmpgt8(z, a), flag1_);  // d = z > a? 0 : 1
+                z = kv_max_epi8(z, a);
+                tmp = kv_cmpgt8(z, b);
+                d = kv_blendv(flag2_, d, tmp);  // d = z > b? d : 2
+                z = kv_max_epu8(z, b);
+                z = kv_min_epu8(z, max_sc_);
+                kv_store_blocks(&u[t], kv_sub8(z, vt1), nb);
+                kv_store_blocks(&v[t], kv_sub8(z, ut), nb);
+                z = kv_sub8(z, q_);
+                a = kv_sub8(a, z);
+                b = kv_sub8(b, z);
+                tmp = kv_cmpgt8(zero_, a);
+                kv_store_blocks(&x[t], kv_andnot(tmp, a), nb);
+                d = kv_or(d, kv_andnot(tmp, flag8_));  // d = 0 > a? 0 : 0x08
+                tmp = kv_cmpgt8(zero_, b);
+                kv_store_blocks(&y[t], kv_andnot(tmp, b), nb);
+                d = kv_or(d, kv_andnot(tmp, flag16_));  // d = 0 > b? 0 : 0x10
+                kv_store_blocks(&pr[t], d, nb);
+            }
+        }
+        if (!approx_max) {  // find the exact max with a 32-bit score array
+            int32_t max_H, max_t;
+            // compute H[], max_H and max_t
+            if (r > 0) {
+                int32_t en1 = st0 + (en0 - st0) / 4 * 4;
+                ksw_vec_t max_H_, max_t_, qe_, idx_;
+                max_H = H[en0] = en0 > 0
+                                     ? H[en0 - 1] + u8[en0] - qe
+                                     : H[en0] + v8[en0] - qe;  // special casing the last element
+                max_t = en0;
+                max_H_ = kv_set1_epi32(max_H);
+                max_t_ = kv_set1_epi32(max_t);
+                qe_ = kv_set1_epi32(q + e);
+                idx_ = kv_lane_index_epi32();
+                for (t = st0; t < en1; t += KSW_VEC_INT32) {
+                    // this implements: H[t]+=v8[t]-qe; if(H[t]>max_H) max_H=H[t],max_t=t;
+                    ksw_vec_t H1;
+                    int nl = en1 - t < KSW_VEC_INT32 ? en1 - t : KSW_VEC_INT32;
+                    H1 = kv_load_epi32(&H[t], nl);
+                    H1 = kv_add32(H1, kv_cvtepu8_epi32(&v8[t]));
+                    H1 = kv_sub32(H1, qe_);
+                    kv_store_epi32(&H[t], H1, nl);
+                    kv_update_max_epi32(&max_H_, &max_t_, H1, kv_add32(kv_set1_epi32(t), idx_), nl);
+                }
+                kv_reduce_max_epi32(max_H_, max_t_, &max_H, &max_t);
+                for (t = en1; t < en0; ++t) {  // for the rest of values that haven't been computed
+                    H[t] += (int32_t)v8[t] - qe;
+                    if (H[t] > max_H) max_H = H[t], max_t = t;
+                }
+            } else
+                H[0] = v8[0] - qe - qe, max_H = H[0], max_t = 0;  // special casing r==0
+            // update ez
+            if (en0 == tlen - 1 && H[en0] > ez->mte) ez->mte = H[en0], ez->mte_q = r - en;
+            if (r - st0 == qlen - 1 && H[st0] > ez->mqe) ez->mqe = H[st0], ez->mqe_t = st0;
+            if (ksw_apply_zdrop(ez, 1, max_H, r, max_t, zdrop, e)) break;
+            if (r == qlen + tlen - 2 && en0 == tlen - 1) ez->score = H[tlen - 1];
+        } else {  // find approximate max; Z-drop might be inaccurate, too.
+            if (r > 0) {
+                if (last_H0_t >= st0 && last_H0_t <= en0 && last_H0_t + 1 >= st0 &&
+                    last_H0_t + 1 <= en0) {
+                    int32_t d0 = v8[last_H0_t] - qe;
+                    int32_t d1 = u8[last_H0_t + 1] - qe;
+                    if (d0 > d1)
+                        H0 += d0;
+                    else
+                        H0 += d1, ++last_H0_t;
+                } else if (last_H0_t >= st0 && last_H0_t <= en0) {
+                    H0 += v8[last_H0_t] - qe;
+                } else {
+                    ++last_H0_t, H0 += u8[last_H0_t] - qe;
+                }
+                if ((flag & KSW_EZ_APPROX_DROP) &&
+                    ksw_apply_zdrop(ez, 1, H0, r, last_H0_t, zdrop, e))
+                    break;
+            } else
+                H0 = v8[0] - qe - qe, last_H0_t = 0;
+            if (r == qlen + tlen - 2 && en0 == tlen - 1) ez->score = H0;
+        }
+        last_st = st, last_en = en;
+    }
+    kfree(km, mem);
+    if (!approx_max) kfree(km, H);
+    if (with_cigar) {  // backtrack
+        int rev_cigar = !!(flag & KSW_EZ_REV_CIGAR);
+        if (!ez->zdropped && !(flag & KSW_EZ_EXTZ_ONLY)) {
+            ksw_backtrack(km, 1, rev_cigar, 0, (uint8_t*)p, off, off_end, n_col_ * 16, tlen - 1,
+                          qlen - 1, &ez->m_cigar, &ez->n_cigar, &ez->cigar);
+        } else if (!ez->zdropped && (flag & KSW_EZ_EXTZ_ONLY) &&
+                   ez->mqe + end_bonus > (int)ez->max) {
+            ez->reach_end = 1;
+            ksw_backtrack(km, 1, rev_cigar, 0, (uint8_t*)p, off, off_end, n_col_ * 16, ez->mqe_t,
+                          qlen - 1, &ez->m_cigar, &ez->n_cigar, &ez->cigar);
+        } else if (ez->max_t >= 0 && ez->max_q >= 0) {
+            ksw_backtrack(km, 1, rev_cigar, 0, (uint8_t*)p, off, off_end, n_col_ * 16, ez->max_t,
+                          ez->max_q, &ez->m_cigar, &ez->n_cigar, &ez->cigar);
+        }
+        kfree(km, mem2);
+        kfree(km, off);
+    }
+}
+#endif  // __AVX2__ && KSW_CPU_DISPATCH
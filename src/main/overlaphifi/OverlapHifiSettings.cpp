@@ -53,6 +53,14 @@ R"({
     "description" : "Select the output format."
 })", std::string("m4")};
 
+const CLI_v2::Option SharedTargetFile{
+R"({
+    "names" : ["shared-target"],
+    "type" : "string",
+    "default" : "",
+    "description" : "Path to a file holding the target block index and sequences, memory mapped and shared between processes. If the file does not exist, it is created from the target DB. Processes mapping onto the same target block can point to the same file to avoid keeping a copy of the target in each process."
+})", std::string("")};
+
 const CLI_v2::Option FreqPercentile{
 R"({
     "names" : ["freq-percentile"],
@@ -60,6 +68,20 @@ R"({
     "type" : "double"
 })", OverlapHifiSettings::Defaults::FreqPercentile};
 
+const CLI_v2::Option MaxSeedHitsPerQuery{
+R"({
+    "names" : ["max-seed-hits"],
+    "description" : "Maximum number of seed hits per query. If a query would produce more hits, its most frequent seeds are dropped until the hits fit. Value <= 0 turns off the limit.",
+    "type" : "int"
+})", OverlapHifiSettings::Defaults::MaxSeedHitsPerQuery};
+
+const CLI_v2::Option MaxQuerySeedOccurrences{
+R"({
+    "names" : ["max-query-seed-occ"],
+    "description" : "Seeds which occur more than this many times within a single query (e.g. in tandem repeats) are sub-sampled to this many occurrences before collecting hits. Value <= 0 turns off sub-sampling.",
+    "type" : "int"
+})", OverlapHifiSettings::Defaults::MaxQuerySeedOccurrences};
+
 const CLI_v2::Option MinQueryLen{
 R"({
     "names" : ["min-qlen"],
@@ -232,6 +254,13 @@ R"({
     "type" : "bool"
 })", OverlapHifiSettings::Defaults::UseTraceback};
 
+const CLI_v2::Option CacheTargetRevCmp{
+R"({
+    "names" : ["cache-target-rc"],
+    "description" : "Reverse complement all target sequences once after loading, so that reverse strand overlaps are aligned without copying target windows. Uses additional memory equal to the size of the target block, and this memory is not shared with '--shared-target'.",
+    "type" : "bool"
+})", OverlapHifiSettings::Defaults::CacheTargetRevCmp};
+
 const CLI_v2::Option MaskHomopolymers{
 R"({
     "names" : ["mask-hp"],
@@ -332,12 +361,15 @@ OverlapWriterFormat ParseOutFormat(const std::string& val)
 OverlapHifiSettings::OverlapHifiSettings(const PacBio::CLI_v2::Results& options)
     : TargetDBPrefix{options[OptionNames::TargetDBPrefix]}
     , QueryDBPrefix{options[OptionNames::QueryDBPrefix]}
+    , SharedTargetFile{options[OptionNames::SharedTargetFile]}
     , NumThreads{options.NumThreads()}
     , TargetBlockId{std::stoi(options[OptionNames::TargetBlockId])}
     , QueryBlockStartId{std::stoi(options[OptionNames::QueryBlockStartId])}
     , QueryBlockEndId{std::stoi(options[OptionNames::QueryBlockEndId])}
 
     , FreqPercentile{options[OptionNames::FreqPercentile]}
+    , MaxSeedHitsPerQuery{options[OptionNames::MaxSeedHitsPerQuery]}
+    , MaxQuerySeedOccurrences{options[OptionNames::MaxQuerySeedOccurrences]}
     , MinQueryLen{options[OptionNames::MinQueryLen]}
     , MinTargetLen{options[OptionNames::MinTargetLen]}
     , MaxSeedDistance{options[OptionNames::MaxSeedDistance]}
@@ -361,6 +393,7 @@ OverlapHifiSettings::OverlapHifiSettings(const PacBio::CLI_v2::Results& options)
     , BestN{options[OptionNames::BestN]}
     , UseHPC{options[OptionNames::UseHPC]}
     , UseTraceback{options[OptionNames::UseTraceback]}
+    , CacheTargetRevCmp{options[OptionNames::CacheTargetRevCmp]}
     , MaskHomopolymers{options[OptionNames::MaskHomopolymers]}
     , MaskSimpleRepeats{options[OptionNames::MaskSimpleRepeats]}
     , MaskHomopolymerSNPs{options[OptionNames::MaskHomopolymerSNPs]}
@@ -425,9 +458,12 @@ PacBio::CLI_v2::Interface OverlapHifiSettings::CreateCLI()
     // clang-format off
     i.AddOptionGroup("Input/Output Options", {
         OptionNames::OutFormat,
+        OptionNames::SharedTargetFile,
     });
     i.AddOptionGroup("Algorithm Options", {
         OptionNames::FreqPercentile,
+        OptionNames::MaxSeedHitsPerQuery,
+        OptionNames::MaxQuerySeedOccurrences,
         OptionNames::MinQueryLen,
         OptionNames::MinTargetLen,
         OptionNames::MaxSeedDistance,
@@ -453,6 +489,7 @@ PacBio::CLI_v2::Interface OverlapHifiSettings::CreateCLI()
         OptionNames::BestN,
         OptionNames::UseHPC,
         OptionNames::UseTraceback,
+        OptionNames::CacheTargetRevCmp,
         OptionNames::MaskHomopolymers,
         OptionNames::MaskSimpleRepeats,
         OptionNames::MaskHomopolymerSNPs,
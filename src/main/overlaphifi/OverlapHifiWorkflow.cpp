@@ -11,16 +11,25 @@
 #include <pacbio/pancake/SeedIndex.h>
 #include <pacbio/pancake/SeqDBIndexCache.h>
 #include <pacbio/pancake/SeqDBReaderCached.h>
+#include <pacbio/pancake/SharedTargetBlock.h>
 #include <pacbio/util/TicToc.h>
 #include <pbcopper/logging/LogLevel.h>
 #include <pbcopper/logging/Logging.h>
 #include <pbcopper/parallel/FireAndForget.h>
 #include <pbcopper/parallel/WorkQueue.h>
+#include <fstream>
+#include <memory>
 #include <sstream>
 
 namespace PacBio {
 namespace Pancake {
 
+static bool FileExists(const std::string& path)
+{
+    std::ifstream ifs(path);
+    return ifs.good();
+}
+
 void Worker(const PacBio::Pancake::SeqDBReaderCachedBlock& targetSeqDBReader,
             const PacBio::Pancake::SeedIndex& index,
             const PacBio::Pancake::SeqDBReaderCachedBlock& querySeqDBReader,
@@ -96,27 +105,79 @@ int OverlapHifiWorkflow::Runner(const PacBio::CLI_v2::Results& options)
 
     // Create the target readers.
     PacBio::Pancake::SeqDBReaderCachedBlock targetSeqDBReader(targetSeqDBCache, settings.UseHPC);
-    targetSeqDBReader.LoadBlocks({settings.TargetBlockId});
-    PacBio::Pancake::SeedDBReaderRawBlock targetSeedDBReader(targetSeedDBCache);
+    std::unique_ptr<PacBio::Pancake::SharedTargetBlock> sharedTarget;
+    std::unique_ptr<PacBio::Pancake::SeedIndex> indexPtr;
+
+    // Build the target block from the DBs, unless it can be attached from a shared file.
+    const bool useSharedTarget = settings.SharedTargetFile.empty() == false;
+    if (useSharedTarget == false || FileExists(settings.SharedTargetFile) == false) {
+        targetSeqDBReader.LoadBlocks({settings.TargetBlockId});
+        PacBio::Pancake::SeedDBReaderRawBlock targetSeedDBReader(targetSeedDBCache);
+
+        // Read the seeds for the target block.
+        std::vector<PacBio::Pancake::SeedDB::SeedRaw> targetSeeds =
+            targetSeedDBReader.GetBlock(settings.TargetBlockId);
+
+        PBLOG_INFO << "Target seqs: " << targetSeqDBReader.records().size();
+        PBLOG_INFO << "Target seeds: " << targetSeeds.size();
+
+        // Build the seed index.
+        TicToc ttIndex;
+        indexPtr =
+            std::make_unique<PacBio::Pancake::SeedIndex>(targetSeedDBCache, std::move(targetSeeds));
+        ttIndex.Stop();
+        PBLOG_INFO << "Built the seed index in " << ttIndex.GetSecs() << " sec / "
+                   << ttIndex.GetCpuSecs() << " CPU sec";
+
+        if (useSharedTarget) {
+            PacBio::Pancake::SharedTargetBlock::Write(settings.SharedTargetFile,
+                                                      settings.TargetBlockId, targetSeqDBReader,
+                                                      settings.UseHPC, *indexPtr);
+            PBLOG_INFO << "Wrote the shared target block to: " << settings.SharedTargetFile;
+            // Release the private copy, and attach to the shared one below.
+            indexPtr.reset();
+        }
+    }
 
-    // Read the seeds for the target block.
-    std::vector<PacBio::Pancake::SeedDB::SeedRaw> targetSeeds =
-        targetSeedDBReader.GetBlock(settings.TargetBlockId);
+    if (useSharedTarget) {
+        sharedTarget =
+            std::make_unique<PacBio::Pancake::SharedTargetBlock>(settings.SharedTargetFile);
+        const auto& bl = targetSeqDBCache->GetBlockLine(settings.TargetBlockId);
+        const auto& sharedRecords = sharedTarget->Records();
+        if (sharedTarget->TargetBlockId() != settings.TargetBlockId ||
+            sharedTarget->SeedParams() != targetSeedDBCache->seedParams ||
+            sharedTarget->SeqsUseHPC() != settings.UseHPC ||
+            static_cast<int32_t>(sharedRecords.size()) != (bl.endSeqId - bl.startSeqId) ||
+            (sharedRecords.empty() == false && sharedRecords.front().Id() != bl.startSeqId)) {
+            std::ostringstream oss;
+            oss << "The shared target file '" << settings.SharedTargetFile
+                << "' does not match the target DB, block ID or the seed parameters. Block ID in "
+                   "the file: "
+                << sharedTarget->TargetBlockId()
+                << ", requested block ID: " << settings.TargetBlockId;
+            throw std::runtime_error(oss.str());
+        }
+        targetSeqDBReader.LoadExternalRecords(sharedRecords);
+        indexPtr = std::make_unique<PacBio::Pancake::SeedIndex>(
+            targetSeedDBCache, sharedTarget->Seeds(), sharedTarget->NumSeeds());
+        PBLOG_INFO << "Attached to the shared target block: " << settings.SharedTargetFile;
+        PBLOG_INFO << "Target seqs: " << targetSeqDBReader.records().size();
+        PBLOG_INFO << "Target seeds: " << sharedTarget->NumSeeds();
+    }
+    const PacBio::Pancake::SeedIndex& index = *indexPtr;
+
+    if (settings.CacheTargetRevCmp) {
+        TicToc ttRevCmp;
+        targetSeqDBReader.ComputeReverseComplements(static_cast<int32_t>(settings.NumThreads));
+        ttRevCmp.Stop();
+        PBLOG_INFO << "Reverse complemented the target seqs in " << ttRevCmp.GetSecs() << " sec / "
+                   << ttRevCmp.GetCpuSecs() << " CPU sec";
+    }
 
     ttInit.Stop();
     PBLOG_INFO << "Loaded the target index and seqs in " << ttInit.GetSecs() << " sec / "
                << ttInit.GetCpuSecs() << " CPU sec";
 
-    PBLOG_INFO << "Target seqs: " << targetSeqDBReader.records().size();
-    PBLOG_INFO << "Target seeds: " << targetSeeds.size();
-
-    // Build the seed index.
-    TicToc ttIndex;
-    PacBio::Pancake::SeedIndex index(targetSeedDBCache, std::move(targetSeeds));
-    ttIndex.Stop();
-    PBLOG_INFO << "Built the seed index in " << ttIndex.GetSecs() << " sec / "
-               << ttIndex.GetCpuSecs() << " CPU sec";
-
     // Seed statistics, and computing the cutoff.
     TicToc ttSeedStats;
     int64_t freqMax = 0;
@@ -152,6 +213,9 @@ int OverlapHifiWorkflow::Runner(const PacBio::CLI_v2::Results& options)
     // Process all blocks.
     PacBio::Pancake::SeqDBReaderCachedBlock querySeqDBReader(querySeqDBCache, settings.UseHPC);
     PacBio::Pancake::SeedDBReaderCachedBlock querySeedDBReader(querySeedDBCache);
+    int64_t totalCappedQueries = 0;
+    int64_t totalAlignmentsAborted = 0;
+    int64_t totalReversePassesSkipped = 0;
     for (int32_t queryBlockId = settings.QueryBlockStartId; queryBlockId < endBlockId;
          queryBlockId += settings.CombineBlocks) {
 
@@ -224,6 +288,9 @@ int OverlapHifiWorkflow::Runner(const PacBio::CLI_v2::Results& options)
             faf.Finalize();
 
             // Write the results.
+            int64_t numCappedQueries = 0;
+            int64_t numAlignmentsAborted = 0;
+            int64_t numReversePassesSkipped = 0;
             for (size_t i = 0; i < querySeqDBReader.records().size(); ++i) {
                 const auto& result = results[i];
                 const auto& querySeq = querySeqDBReader.records()[i];
@@ -231,6 +298,21 @@ int OverlapHifiWorkflow::Runner(const PacBio::CLI_v2::Results& options)
                 for (const auto& ovl : result.overlaps) {
                     writer->Write(ovl, targetSeqDBReader, querySeq);
                 }
+                numCappedQueries += result.hitsCapped;
+                numAlignmentsAborted += result.numAlignmentsAborted;
+                numReversePassesSkipped += result.numReversePassesSkipped;
+            }
+            totalCappedQueries += numCappedQueries;
+            totalAlignmentsAborted += numAlignmentsAborted;
+            totalReversePassesSkipped += numReversePassesSkipped;
+            if (numCappedQueries > 0) {
+                PBLOG_INFO << "Number of queries with seed hits capped to "
+                           << settings.MaxSeedHitsPerQuery << ": " << numCappedQueries;
+            }
+            if (numAlignmentsAborted > 0) {
+                PBLOG_INFO << "Number of alignments aborted below the minimum identity: "
+                           << numAlignmentsAborted << " (reverse pass skipped in "
+                           << numReversePassesSkipped << ")";
             }
 
             ttQueryBlockMapping.Stop();
@@ -242,6 +324,18 @@ int OverlapHifiWorkflow::Runner(const PacBio::CLI_v2::Results& options)
     ttMap.Stop();
     PBLOG_INFO << "Mapped all query blocks in " << ttMap.GetSecs() << " sec / "
                << ttMap.GetCpuSecs() << " CPU sec.";
+    if (settings.MaxSeedHitsPerQuery > 0) {
+        PBLOG_INFO << "Total number of queries with capped seed hits: " << totalCappedQueries;
+    }
+    // The mapper only aborts alignments below the minimum identity without the traceback
+    // and without marking secondary alignments.
+    const bool earlyTermination = settings.UseTraceback == false &&
+                                  settings.MarkSecondary == false && settings.MinIdentity > 0.0;
+    if (earlyTermination) {
+        PBLOG_INFO << "Total number of alignments aborted below the minimum identity: "
+                   << totalAlignmentsAborted << " (reverse pass skipped in "
+                   << totalReversePassesSkipped << ")";
+    }
 
     return EXIT_SUCCESS;
 }
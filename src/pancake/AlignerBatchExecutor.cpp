@@ -0,0 +1,140 @@
+// Authors: Ivan Sovic
+
+#include <pacbio/pancake/AlignerBatchExecutor.h>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <future>
+#include <sstream>
+#include <stdexcept>
+
+namespace PacBio {
+namespace Pancake {
+
+AlignerBatchExecutor::AlignerBatchExecutor(const AlignerType& alignerType,
+                                           const AlignmentParameters& alnParams, int32_t numThreads)
+    : AlignerBatchExecutor(alignerType, alnParams, numThreads, nullptr)
+{
+    if (numThreads > 1) {
+        fafOwned_ = std::make_unique<PacBio::Parallel::FireAndForget>(numThreads);
+        faf_ = fafOwned_.get();
+    }
+}
+
+AlignerBatchExecutor::AlignerBatchExecutor(const AlignerType& alignerType,
+                                           const AlignmentParameters& alnParams, int32_t numThreads,
+                                           PacBio::Parallel::FireAndForget* faf)
+    : faf_(faf)
+{
+    if (numThreads < 1) {
+        std::ostringstream oss;
+        oss << "(AlignerBatchExecutor) The number of threads needs to be at least 1. numThreads = "
+            << numThreads;
+        throw std::runtime_error(oss.str());
+    }
+    for (int32_t i = 0; i < numThreads; ++i) {
+        aligners_.emplace_back(AlignerFactory(alignerType, alnParams));
+    }
+}
+
+AlignerBatchExecutor::~AlignerBatchExecutor()
+{
+    if (fafOwned_) {
+        fafOwned_->Finalize();
+    }
+}
+
+AlignmentResult AlignerBatchExecutor::Global(const char* qseq, int64_t qlen, const char* tseq,
+                                             int64_t tlen)
+{
+    return aligners_[0]->Global(qseq, qlen, tseq, tlen);
+}
+
+AlignmentResult AlignerBatchExecutor::Extend(const char* qseq, int64_t qlen, const char* tseq,
+                                             int64_t tlen)
+{
+    return aligners_[0]->Extend(qseq, qlen, tseq, tlen);
+}
+
+void AlignerBatchExecutor::GlobalInto(const char* qseq, int64_t qlen, const char* tseq,
+                                      int64_t tlen, AlignmentResult& result)
+{
+    aligners_[0]->GlobalInto(qseq, qlen, tseq, tlen, result);
+}
+
+void AlignerBatchExecutor::ExtendInto(const char* qseq, int64_t qlen, const char* tseq,
+                                      int64_t tlen, AlignmentResult& result)
+{
+    aligners_[0]->ExtendInto(qseq, qlen, tseq, tlen, result);
+}
+
+AlignmentResult AlignerBatchExecutor::GlobalScore(const char* qseq, int64_t qlen, const char* tseq,
+                                                  int64_t tlen)
+{
+    return aligners_[0]->GlobalScore(qseq, qlen, tseq, tlen);
+}
+
+AlignmentResult AlignerBatchExecutor::ExtendScore(const char* qseq, int64_t qlen, const char* tseq,
+                                                  int64_t tlen)
+{
+    return aligners_[0]->ExtendScore(qseq, qlen, tseq, tlen);
+}
+
+void AlignerBatchExecutor::AlignBatch(const std::vector<AlignmentJob>& jobs,
+                                      std::vector<AlignmentResult>& results)
+{
+    const int32_t numJobs = jobs.size();
+    const int32_t numWorkers = std::min(NumThreads(), numJobs);
+
+    if (faf_ == nullptr || numWorkers <= 1) {
+        aligners_[0]->AlignBatch(jobs, results);
+        return;
+    }
+
+    results.resize(jobs.size());
+    std::atomic<int32_t> nextJobId{0};
+
+    auto Worker = [&jobs, &results, &nextJobId](AlignerBasePtr& aligner, std::promise<void>& done) {
+        try {
+            for (int32_t jobId = nextJobId++; jobId < static_cast<int32_t>(jobs.size());
+                 jobId = nextJobId++) {
+                const auto& job = jobs[jobId];
+                if (job.mode == AlignmentMode::GLOBAL) {
+                    aligner->GlobalInto(job.qseq, job.qlen, job.tseq, job.tlen, results[jobId]);
+                } else {
+                    aligner->ExtendInto(job.qseq, job.qlen, job.tseq, job.tlen, results[jobId]);
+                }
+            }
+            done.set_value();
+        } catch (...) {
+            // Stop the other workers early, and rethrow in the calling thread.
+            nextJobId = jobs.size();
+            done.set_exception(std::current_exception());
+        }
+    };
+
+    std::vector<std::promise<void>> done(numWorkers);
+    std::vector<std::future<void>> futures;
+    for (int32_t i = 0; i < numWorkers; ++i) {
+        futures.emplace_back(done[i].get_future());
+        faf_->ProduceWith(Worker, std::ref(aligners_[i]), std::ref(done[i]));
+    }
+
+    // Wait for all workers before rethrowing, because they use the local state.
+    std::exception_ptr exc = nullptr;
+    for (auto& f : futures) {
+        try {
+            f.get();
+        } catch (...) {
+            if (exc == nullptr) {
+                exc = std::current_exception();
+            }
+        }
+    }
+    if (exc != nullptr) {
+        std::rethrow_exception(exc);
+    }
+}
+
+}  // namespace Pancake
+}  // namespace PacBio
@@ -53,6 +53,35 @@ AlignmentResult AlignerEdlib::Global(const char* qseq, int64_t qlen, const char*
     return ret;
 }
 
+AlignmentResult AlignerEdlib::GlobalScore(const char* qseq, int64_t qlen, const char* tseq,
+                                          int64_t tlen)
+{
+    // Only the edit distance, without the alignment path.
+    EdlibAlignResult edlibResult =
+        edlibAlign(qseq, qlen, tseq, tlen,
+                   edlibNewAlignConfig(-1, EDLIB_MODE_NW, EDLIB_TASK_DISTANCE, NULL, 0));
+
+    if (edlibResult.numLocations == 0) {
+        edlibFreeAlignResult(edlibResult);
+        return {};
+    }
+
+    AlignmentResult ret;
+    ret.score = ScoreEditDistance(edlibResult.editDistance, qlen, tlen, opt_.matchScore,
+                                  opt_.mismatchPenalty, opt_.gapOpen1, opt_.gapExtend1);
+    ret.valid = true;
+    ret.maxScore = ret.score;
+    ret.zdropped = false;
+    ret.lastQueryPos = qlen;
+    ret.lastTargetPos = tlen;
+    ret.maxQueryPos = qlen;
+    ret.maxTargetPos = tlen;
+
+    edlibFreeAlignResult(edlibResult);
+
+    return ret;
+}
+
 AlignmentResult AlignerEdlib::Extend(const char* /*qseq*/, int64_t /*qlen*/, const char* /*tseq*/,
                                      int64_t /*tlen*/)
 {
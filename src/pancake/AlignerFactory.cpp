@@ -15,6 +15,8 @@ std::string AlignerTypeToString(const AlignerType& alignerType)
         return "EDLIB";
     } else if (alignerType == AlignerType::SES1) {
         return "SES1";
+    } else if (alignerType == AlignerType::WFA) {
+        return "WFA";
     }
     return "Unknown";
 }
@@ -29,6 +31,8 @@ AlignerType AlignerTypeFromString(const std::string& alignerType)
         return AlignerType::SES1;
     } else if (alignerType == "SES2") {
         return AlignerType::SES2;
+    } else if (alignerType == "WFA") {
+        return AlignerType::WFA;
     }
     throw std::runtime_error("Unknown aligner type: '" + alignerType +
                              "' in AlignerTypeFromString.");
@@ -49,6 +53,9 @@ std::shared_ptr<AlignerBase> AlignerFactory(const AlignerType& alignerType,
     } else if (alignerType == AlignerType::SES2) {
         return CreateAlignerSES2(alnParams);
 
+    } else if (alignerType == AlignerType::WFA) {
+        return CreateAlignerWFA(alnParams);
+
     } else {
         throw std::runtime_error("AlignerType " + AlignerTypeToString(alignerType) +
                                  " not supported yet!");
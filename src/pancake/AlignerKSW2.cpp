@@ -11,7 +11,7 @@ mm_tbuf_t* mm_tbuf_init(void)
 {
     mm_tbuf_t* b;
     b = (mm_tbuf_t*)calloc(1, sizeof(mm_tbuf_t));
-    // if (!(mm_dbg_flag & 1)) b->km = km_init();              // This flag means: #define MM_DBG_NO_KALLOC     0x1
+    b->km = km_init();
     return b;
 }
 
@@ -34,38 +34,100 @@ AlignerKSW2::AlignerKSW2(const AlignmentParameters& opt)
     // From Minimap2: int sc_ambi; // score when one or both bases are "N"
     const int32_t scAmbi = 1;
     ksw_gen_simple_mat_(5, mat_, opt.matchScore, opt.mismatchPenalty, scAmbi);
+    memset(&ez_, 0, sizeof(ksw_extz_t));
 }
 
-AlignerKSW2::~AlignerKSW2() = default;
+AlignerKSW2::~AlignerKSW2() { kfree(buffer_->km, ez_.cigar); }
 
 AlignmentResult AlignerKSW2::Global(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen)
 {
-    const int32_t extra_flag = 0;
+    AlignmentResult ret;
+    GlobalInto(qseq, qlen, tseq, tlen, ret);
+    return ret;
+}
+
+AlignmentResult AlignerKSW2::Extend(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen)
+{
+    AlignmentResult ret;
+    ExtendInto(qseq, qlen, tseq, tlen, ret);
+    return ret;
+}
+
+void AlignerKSW2::GlobalInto(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen,
+                             AlignmentResult& ret)
+{
+    Global_(qseq, qlen, tseq, tlen, false, ret);
+}
+
+void AlignerKSW2::ExtendInto(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen,
+                             AlignmentResult& ret)
+{
+    Extend_(qseq, qlen, tseq, tlen, false, ret);
+}
+
+AlignmentResult AlignerKSW2::GlobalScore(const char* qseq, int64_t qlen, const char* tseq,
+                                         int64_t tlen)
+{
+    AlignmentResult ret;
+    Global_(qseq, qlen, tseq, tlen, true, ret);
+    return ret;
+}
 
+AlignmentResult AlignerKSW2::ExtendScore(const char* qseq, int64_t qlen, const char* tseq,
+                                         int64_t tlen)
+{
+    AlignmentResult ret;
+    Extend_(qseq, qlen, tseq, tlen, true, ret);
+    return ret;
+}
+
+void AlignerKSW2::Global_(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen,
+                          bool scoreOnly, AlignmentResult& ret)
+{
     // Bandwidth heuristic, as it is in Minimap2.
     const int32_t bw = (int)(opt_.alignBandwidth * 1.5 + 1.);
 
-    // Memory allocations required for KSW2.
-    ksw_extz_t ez;
-    memset(&ez, 0, sizeof(ksw_extz_t));
-
     // Convert the subsequence's alphabet from ACTG to [0123].
-    const std::vector<uint8_t> qseqInt = ConvertSeqAlphabet_(qseq, qlen, &BaseToTwobit[0]);
-    const std::vector<uint8_t> tseqInt = ConvertSeqAlphabet_(tseq, tlen, &BaseToTwobit[0]);
+    ConvertSeqAlphabet_(qseq, qlen, &BaseToTwobit[0], qseqInt_);
+    ConvertSeqAlphabet_(tseq, tlen, &BaseToTwobit[0], tseqInt_);
 
     // Compute the actual bandwidth. If this was a long join, we need to allow more room.
     const int32_t longestSpan = std::max(qlen, tlen);
     const int32_t spanDiff = std::abs(tlen - qlen);
 
-    // This is slighlty modified compared to how it is in Minimap2:
+    // Minimap2 uses the full band for long joins:
     // const int32_t actualBandwidth =
     //     (h2.CheckFlagLongJoin() || spanDiff > (bw / 2)) ? longestSpan : bw;
-    const int32_t actualBandwidth = (spanDiff > (bw / 2)) ? longestSpan : bw;
-
-    // First pass: with approximate Z-drop
-    mm_align_pair_(buffer_->km, qlen, &qseqInt[0], tlen, &tseqInt[0], mat_, actualBandwidth, -1, -1,
-                   extra_flag | KSW_EZ_APPROX_MAX, &ez, opt_.gapOpen1, opt_.gapExtend1,
-                   opt_.gapOpen2, opt_.gapExtend2);
+    // Instead, start from a band which just covers the span difference with some room
+    // on both sides, and double it only while the optimal path touches the band edge.
+    // The band is never narrower than needed to reach the end cell, even above the cap.
+    // The band edge can only be checked on a path, so a score-only alignment still does the
+    // traceback for every band which could be doubled, and stops at the same band as Global.
+    const int32_t minBandwidth = std::min(longestSpan, std::max(bw, spanDiff + bw / 2));
+    const int32_t maxBandwidth =
+        std::min(longestSpan, std::max(minBandwidth, opt_.alignMaxBandwidth));
+
+    int32_t actualBandwidth = minBandwidth;
+    size_t bandLevel = 0;
+    while (true) {
+        // Without the traceback, KSW2 does not store the traceback matrix at all.
+        const bool lastBand = actualBandwidth >= maxBandwidth;
+        const int32_t extra_flag = (scoreOnly && lastBand) ? KSW_EZ_SCORE_ONLY : 0;
+
+        // First pass: with approximate Z-drop
+        mm_align_pair_(buffer_->km, qlen, qseqInt_.data(), tlen, tseqInt_.data(), mat_,
+                       actualBandwidth, -1, -1, extra_flag | KSW_EZ_APPROX_MAX, &ez_, opt_.gapOpen1,
+                       opt_.gapExtend1, opt_.gapOpen2, opt_.gapExtend2);
+        if (lastBand || PathTouchesBandEdge_(ez_.cigar, ez_.n_cigar, actualBandwidth) == false) {
+            break;
+        }
+        actualBandwidth = std::min(maxBandwidth, actualBandwidth * 2);
+        ++bandLevel;
+    }
+    if (bandLevel >= bandLevelCounts_.size()) {
+        bandLevelCounts_.resize(bandLevel + 1, 0);
+    }
+    ++bandLevelCounts_[bandLevel];
 
     // // First pass: with approximate Z-drop
     // mm_align_pair_(buffer_->km, &mopt_, qlen, &qseqInt[0], tlen, &tseqInt[0], mat_, actualBandwidth,
@@ -80,81 +142,113 @@ AlignmentResult AlignerKSW2::Global(const char* qseq, int64_t qlen, const char*
     //                   actualBandwidth, -1, zdrop_code == 2 ? mopt_.zdrop_inv : mopt_.zdrop,
     //                   extra_flag, &ez);
     // }
-    auto currCigar = ConvertMinimap2CigarToPbbam_(ez.cigar, ez.n_cigar, qseqInt, tseqInt);
+    ConvertMinimap2CigarToPbbam_(ez_.cigar, scoreOnly ? 0 : ez_.n_cigar, qseqInt_, tseqInt_,
+                                 ret.cigar);
 
-    AlignmentResult ret;
-    ret.cigar = std::move(currCigar);
     // ret.valid = ez.reach_end;
     ret.valid = true;
     ret.lastQueryPos = qlen;
     ret.lastTargetPos = tlen;
     // ret.lastQueryPos = (ez.reach_end ? qlen : ez.max_q + 1);
     // ret.lastTargetPos = (ez.reach_end ? ez.mqe_t + 1 : ez.max_t + 1);
-    ret.maxQueryPos = ez.max_q;
-    ret.maxTargetPos = ez.max_t;
-    ret.score = ez.score;
-    ret.maxScore = ez.max;
-    ret.zdropped = ez.zdropped;
-
-    // Free KSW2 memory.
-    kfree(buffer_->km, ez.cigar);
+    ret.maxQueryPos = ez_.max_q;
+    ret.maxTargetPos = ez_.max_t;
+    ret.score = ez_.score;
+    ret.maxScore = ez_.max;
+    ret.zdropped = ez_.zdropped;
 
-    return ret;
+    ResetArenaIfLarge_();
 }
 
-AlignmentResult AlignerKSW2::Extend(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen)
+void AlignerKSW2::Extend_(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen,
+                          bool scoreOnly, AlignmentResult& ret)
 {
-    const int32_t extra_flag = 0;
+    const int32_t extra_flag = scoreOnly ? KSW_EZ_SCORE_ONLY : 0;
 
     // Bandwidth heuristic, as it is in Minimap2.
     const int32_t bw = (int)(opt_.alignBandwidth * 1.5 + 1.);
 
-    // Memory allocations required for KSW2.
-    ksw_extz_t ez;
-    memset(&ez, 0, sizeof(ksw_extz_t));
-
     // Convert the subsequence's alphabet from ACTG to [0123].
-    const std::vector<uint8_t> qseqInt = ConvertSeqAlphabet_(qseq, qlen, &BaseToTwobit[0]);
-    const std::vector<uint8_t> tseqInt = ConvertSeqAlphabet_(tseq, tlen, &BaseToTwobit[0]);
+    ConvertSeqAlphabet_(qseq, qlen, &BaseToTwobit[0], qseqInt_);
+    ConvertSeqAlphabet_(tseq, tlen, &BaseToTwobit[0], tseqInt_);
 
-    mm_align_pair_(buffer_->km, qlen, &qseqInt[0], tlen, &tseqInt[0], mat_, bw, opt_.endBonus,
-                   opt_.zdrop, extra_flag | KSW_EZ_EXTZ_ONLY | KSW_EZ_RIGHT, &ez, opt_.gapOpen1,
-                   opt_.gapExtend1, opt_.gapOpen2, opt_.gapExtend2);
+    mm_align_pair_(buffer_->km, qlen, qseqInt_.data(), tlen, tseqInt_.data(), mat_, bw,
+                   opt_.endBonus, opt_.zdrop, extra_flag | KSW_EZ_EXTZ_ONLY | KSW_EZ_RIGHT, &ez_,
+                   opt_.gapOpen1, opt_.gapExtend1, opt_.gapOpen2, opt_.gapExtend2);
 
-    auto currCigar = ConvertMinimap2CigarToPbbam_(ez.cigar, ez.n_cigar, qseqInt, tseqInt);
+    ConvertMinimap2CigarToPbbam_(ez_.cigar, ez_.n_cigar, qseqInt_, tseqInt_, ret.cigar);
 
-    AlignmentResult ret;
-    ret.cigar = std::move(currCigar);
-    ret.valid = ez.reach_end;
-    ret.lastQueryPos = (ez.reach_end ? qlen : ez.max_q + 1);
-    ret.lastTargetPos = (ez.reach_end ? ez.mqe_t + 1 : ez.max_t + 1);
-    ret.maxQueryPos = ez.max_q;
-    ret.maxTargetPos = ez.max_t;
-    ret.score = ez.score;
-    ret.maxScore = ez.max;
-    ret.zdropped = ez.zdropped;
-
-    // Free KSW2 memory.
-    kfree(buffer_->km, ez.cigar);
+    // KSW2 sets reach_end only when it does the traceback, so apply the same test here.
+    const bool reachEnd =
+        scoreOnly ? (!ez_.zdropped && ez_.mqe + opt_.endBonus > ez_.max) : ez_.reach_end;
 
-    return ret;
+    ret.valid = reachEnd;
+    ret.lastQueryPos = (reachEnd ? qlen : ez_.max_q + 1);
+    ret.lastTargetPos = (reachEnd ? ez_.mqe_t + 1 : ez_.max_t + 1);
+    ret.maxQueryPos = ez_.max_q;
+    ret.maxTargetPos = ez_.max_t;
+    ret.score = ez_.score;
+    ret.maxScore = ez_.max;
+    ret.zdropped = ez_.zdropped;
+
+    ResetArenaIfLarge_();
 }
 
-std::vector<uint8_t> AlignerKSW2::ConvertSeqAlphabet_(const char* seq, size_t seqlen,
-                                                      const int8_t* conv_table)
+void AlignerKSW2::ResetArenaIfLarge_()
 {
-    std::vector<uint8_t> ret(seqlen);
+    km_stat_t kmst;
+    km_stat(buffer_->km, &kmst);
+    if (kmst.capacity <= MAX_KALLOC_CAPACITY_) {
+        return;
+    }
+    // The KSW2 CIGAR buffer lives in the arena, so it goes away with it.
+    km_destroy(buffer_->km);
+    buffer_->km = km_init();
+    ez_.cigar = NULL;
+    ez_.m_cigar = 0;
+    ez_.n_cigar = 0;
+}
+
+bool AlignerKSW2::PathTouchesBandEdge_(const uint32_t* mm2Cigar, int32_t cigarLen,
+                                       int32_t bandwidth)
+{
+    // KSW2 keeps the cells with (-bandwidth < t - q <= bandwidth), so a path which
+    // comes within one diagonal of that range may have been clipped by the band.
+    // The diagonal only changes on gaps, so checking the ends of the gaps is enough.
+    int32_t diag = 0;
+    for (int32_t opId = 0; opId < cigarLen; ++opId) {
+        const uint32_t op = mm2Cigar[opId] & 0xf;
+        const int32_t count = mm2Cigar[opId] >> 4;
+        if (op == 1) {
+            diag -= count;
+        } else if (op == 2 || op == 3) {
+            diag += count;
+        } else {
+            continue;
+        }
+        if (std::abs(diag) >= bandwidth - 1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AlignerKSW2::ConvertSeqAlphabet_(const char* seq, size_t seqlen, const int8_t* conv_table,
+                                      std::vector<uint8_t>& ret)
+{
+    // Resizing within the capacity does not allocate.
+    ret.resize(seqlen);
     for (size_t i = 0; i < seqlen; i++) {
         ret[i] = (int8_t)conv_table[(uint8_t)seq[i]];
     }
-    return ret;
 }
 
-PacBio::Data::Cigar AlignerKSW2::ConvertMinimap2CigarToPbbam_(uint32_t* mm2Cigar, int32_t cigarLen,
-                                                              const std::vector<uint8_t>& qseq,
-                                                              const std::vector<uint8_t>& tseq)
+void AlignerKSW2::ConvertMinimap2CigarToPbbam_(const uint32_t* mm2Cigar, int32_t cigarLen,
+                                               const std::vector<uint8_t>& qseq,
+                                               const std::vector<uint8_t>& tseq,
+                                               PacBio::Data::Cigar& cigar)
 {
-    PacBio::Data::Cigar cigar;
+    cigar.clear();
 
     int32_t qPos = 0;
     int32_t tPos = 0;
@@ -204,7 +298,6 @@ PacBio::Data::Cigar AlignerKSW2::ConvertMinimap2CigarToPbbam_(uint32_t* mm2Cigar
             tPos += count;
         }
     }
-    return cigar;
 }
 
 void AlignerKSW2::mm_align_pair_(void* km, int qlen, const uint8_t* qseq, int tlen,
@@ -57,6 +57,33 @@ AlignmentResult AlignerSES2::Global(const char* qseq, int64_t qlen, const char*
     return ret;
 }
 
+AlignmentResult AlignerSES2::GlobalScore(const char* qseq, int64_t qlen, const char* tseq,
+                                         int64_t tlen)
+{
+    // Same limits as in Global, but without the traceback.
+    const double alignMaxDiff = 1.0;
+    const int32_t maxDiffs = std::max(10, static_cast<int32_t>(qlen * alignMaxDiff));
+    const int32_t actualBandwidth = qlen + tlen;
+
+    auto aln = Alignment::SES2AlignBanded<Alignment::SESAlignMode::Global,
+                                          Alignment::SESTrimmingMode::Disabled,
+                                          Alignment::SESTracebackMode::Disabled>(
+        qseq, qlen, tseq, tlen, maxDiffs, actualBandwidth, sesScratch_);
+
+    AlignmentResult ret;
+    ret.score = ScoreEditDistance(aln.numDiffs, qlen, tlen, opt_.matchScore, opt_.mismatchPenalty,
+                                  opt_.gapOpen1, opt_.gapExtend1);
+    ret.valid = aln.valid;
+    ret.maxScore = ret.score;
+    ret.zdropped = false;
+    ret.lastQueryPos = qlen;
+    ret.lastTargetPos = tlen;
+    ret.maxQueryPos = qlen;
+    ret.maxTargetPos = tlen;
+
+    return ret;
+}
+
 AlignmentResult AlignerSES2::Extend(const char* /*qseq*/, int64_t /*qlen*/, const char* /*tseq*/,
                                     int64_t /*tlen*/)
 {
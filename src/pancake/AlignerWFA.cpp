@@ -0,0 +1,448 @@
+// Authors: Ivan Sovic
+
+#include <pacbio/alignment/AlignmentTools.h>
+#include <pacbio/alignment/SesMatchExtension.h>
+#include <pacbio/pancake/AlignerWFA.h>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+namespace PacBio {
+namespace Pancake {
+
+namespace {
+
+// Offsets are target positions, so any negative value means "not reached". The null
+// value is far enough from zero that adding a few bases to it keeps it negative.
+const int32_t NULL_OFFSET = std::numeric_limits<int32_t>::min() / 2;
+const int32_t NEG_INF_SCORE = std::numeric_limits<int32_t>::min() / 2;
+
+// Components of a wavefront.
+const int32_t COMP_M = 0;
+const int32_t COMP_I1 = 1;
+const int32_t COMP_D1 = 2;
+const int32_t COMP_I2 = 3;
+const int32_t COMP_D2 = 4;
+
+}  // namespace
+
+std::shared_ptr<AlignerBase> CreateAlignerWFA(const AlignmentParameters& opt)
+{
+    return std::shared_ptr<AlignerBase>(new AlignerWFA(opt));
+}
+
+AlignerWFA::AlignerWFA(const AlignmentParameters& opt) : opt_(opt)
+{
+    // Penalties of the transformed scoring scheme, where matches are free. Both
+    // sides are multiplied by 2, so that the match score can be odd.
+    const int32_t a = opt.matchScore;
+    const int32_t mismatch = 2 * (a + opt.mismatchPenalty);
+    const int32_t gapOpen1 = 2 * opt.gapOpen1;
+    const int32_t gapExtend1 = 2 * opt.gapExtend1 + a;
+    const int32_t gapOpen2 = 2 * opt.gapOpen2;
+    const int32_t gapExtend2 = 2 * opt.gapExtend2 + a;
+
+    if (mismatch <= 0 || gapExtend1 <= 0 || gapExtend2 <= 0 || gapOpen1 < 0 || gapOpen2 < 0) {
+        std::ostringstream oss;
+        oss << "Alignment parameters are not supported by AlignerWFA: matchScore = "
+            << opt.matchScore << ", mismatchPenalty = " << opt.mismatchPenalty
+            << ", gapOpen1 = " << opt.gapOpen1 << ", gapExtend1 = " << opt.gapExtend1
+            << ", gapOpen2 = " << opt.gapOpen2 << ", gapExtend2 = " << opt.gapExtend2 << ".";
+        throw std::runtime_error(oss.str());
+    }
+
+    // Fewer penalty steps have to be computed if the penalties are divided by their GCD.
+    scale_ = std::gcd(std::gcd(std::gcd(mismatch, gapOpen1), std::gcd(gapExtend1, gapOpen2)),
+                      gapExtend2);
+    mismatch_ = mismatch / scale_;
+    gapOpen1_ = gapOpen1 / scale_;
+    gapExtend1_ = gapExtend1 / scale_;
+    gapOpen2_ = gapOpen2 / scale_;
+    gapExtend2_ = gapExtend2 / scale_;
+
+    // The second gap piece is only computed if it differs from the first one.
+    numComponents_ = (opt.gapOpen1 == opt.gapOpen2 && opt.gapExtend1 == opt.gapExtend2) ? 3 : 5;
+
+    // A wavefront can depend on another which is at most this many penalty steps before it.
+    maxStep_ = std::max({mismatch_, gapOpen1_ + gapExtend1_, gapOpen2_ + gapExtend2_});
+}
+
+AlignerWFA::~AlignerWFA() = default;
+
+AlignmentResult AlignerWFA::Global(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen)
+{
+    const int32_t queryLen = qlen;
+    const int32_t targetLen = tlen;
+
+    // The band heuristic from Minimap2: the full band for imbalanced spans. Since the
+    // wavefronts only grow up to the optimal penalty, a wide band costs little here.
+    const int32_t bw = (int)(opt_.alignBandwidth * 1.5 + 1.);
+    const int32_t longestSpan = std::max(queryLen, targetLen);
+    const int32_t spanDiff = std::abs(targetLen - queryLen);
+    const int32_t actualBandwidth = (spanDiff > (bw / 2)) ? longestSpan : bw;
+    const int32_t kMin = std::max(-queryLen, -actualBandwidth);
+    const int32_t kMax = std::min(targetLen, actualBandwidth);
+
+    wavefronts_.clear();
+    offsets_.clear();
+
+    // The band always contains both the start and the end diagonal, so the
+    // end is reached before the wavefronts run out.
+    const int32_t kEnd = targetLen - queryLen;
+    AlignmentEnd_ end;
+    int32_t lastActive = 0;
+    for (int32_t s = 0; (s - lastActive) <= maxStep_; ++s) {
+        if (ComputeWavefront_(s, qseq, queryLen, tseq, targetLen, kMin, kMax)) {
+            lastActive = s;
+        }
+        if (Get_(COMP_M, s, kEnd) == targetLen) {
+            end.s = s;
+            end.k = kEnd;
+            end.h = targetLen;
+            end.score = PenaltyToScore_(s, queryLen, targetLen);
+            break;
+        }
+    }
+
+    AlignmentResult ret;
+    if (end.s < 0) {
+        ret.valid = false;
+        return ret;
+    }
+    ret.cigar = Backtrack_(end);
+    ret.valid = true;
+    ret.lastQueryPos = queryLen;
+    ret.lastTargetPos = targetLen;
+    ret.maxQueryPos = queryLen - 1;
+    ret.maxTargetPos = targetLen - 1;
+    ret.score = end.score;
+    ret.maxScore = end.score;
+    ret.zdropped = false;
+    return ret;
+}
+
+AlignmentResult AlignerWFA::Extend(const char* qseq, int64_t qlen, const char* tseq, int64_t tlen)
+{
+    const int32_t queryLen = qlen;
+    const int32_t targetLen = tlen;
+
+    // Same band as in AlignerKSW2::Extend.
+    const int32_t bw = (int)(opt_.alignBandwidth * 1.5 + 1.);
+    const int32_t kMin = std::max(-queryLen, -bw);
+    const int32_t kMax = std::min(targetLen, bw);
+
+    wavefronts_.clear();
+    offsets_.clear();
+
+    // The best cell overall, and the best cell at the end of the query.
+    AlignmentEnd_ maxEnd;
+    maxEnd.s = 0;
+    AlignmentEnd_ mqeEnd;
+    mqeEnd.score = NEG_INF_SCORE;
+
+    bool reachedCorner = false;
+    bool prunedAny = false;
+    int32_t lastActive = 0;
+    for (int32_t s = 0; (s - lastActive) <= maxStep_; ++s) {
+        bool active = ComputeWavefront_(s, qseq, queryLen, tseq, targetLen, kMin, kMax);
+        if (active == false) {
+            continue;
+        }
+
+        // Wavefronts are only appended, so the memory of this one does not move anymore.
+        const Wavefront_& wf = wavefronts_[s];
+        const int32_t width = wf.hi - wf.lo + 1;
+        int32_t* wfData = offsets_.data() + wf.start;
+
+        for (int32_t k = wf.lo; k <= wf.hi; ++k) {
+            const int32_t h = wfData[k - wf.lo];
+            if (h < 0) {
+                continue;
+            }
+            const int32_t v = h - k;
+            const int32_t score = PenaltyToScore_(s, v, h);
+            if (score > maxEnd.score) {
+                maxEnd = {s, k, h, score};
+            }
+            if (v == queryLen && score > mqeEnd.score) {
+                mqeEnd = {s, k, h, score};
+            }
+            reachedCorner = reachedCorner || (v == queryLen && h == targetLen);
+        }
+        // Every other alignment would have a larger penalty at the same or an earlier cell.
+        if (reachedCorner) {
+            break;
+        }
+
+        // X-drop: diagonals which dropped too far below the maximum are not extended further.
+        // All components of the diagonal are dropped, so that the traceback stays consistent.
+        // The best cell at the end of the query is kept, because it may be traced back.
+        if (opt_.zdrop >= 0) {
+            active = false;
+            for (int32_t k = wf.lo; k <= wf.hi; ++k) {
+                const int32_t h = wfData[k - wf.lo];
+                if (h < 0 || (s == mqeEnd.s && k == mqeEnd.k)) {
+                    continue;
+                }
+                if (PenaltyToScore_(s, h - k, h) < (maxEnd.score - opt_.zdrop)) {
+                    for (int32_t comp = 0; comp < numComponents_; ++comp) {
+                        wfData[comp * width + k - wf.lo] = NULL_OFFSET;
+                    }
+                    prunedAny = true;
+                } else {
+                    active = true;
+                }
+            }
+        }
+        if (active) {
+            lastActive = s;
+        }
+
+        // No cell computed from here on can change the result.
+        const int32_t bound = PenaltyToScore_(s + 1, queryLen, targetLen);
+        if (bound <= maxEnd.score &&
+            (bound <= mqeEnd.score || (bound + opt_.endBonus) <= maxEnd.score)) {
+            break;
+        }
+    }
+
+    // Same as in KSW2: the alignment is extended to the end of the query if that scores
+    // better than the maximum minus the end bonus.
+    const bool reachEnd = mqeEnd.s >= 0 && (mqeEnd.score + opt_.endBonus) > maxEnd.score;
+    const AlignmentEnd_& end = reachEnd ? mqeEnd : maxEnd;
+
+    AlignmentResult ret;
+    ret.cigar = Backtrack_(end);
+    ret.valid = reachEnd;
+    ret.lastQueryPos = end.h - end.k;
+    ret.lastTargetPos = end.h;
+    ret.maxQueryPos = maxEnd.h - maxEnd.k - 1;
+    ret.maxTargetPos = maxEnd.h - 1;
+    ret.score = end.score;
+    ret.maxScore = maxEnd.score;
+    ret.zdropped = prunedAny && !reachedCorner;
+    return ret;
+}
+
+int32_t AlignerWFA::Get_(int32_t comp, int32_t s, int32_t k) const
+{
+    if (s < 0 || s >= static_cast<int32_t>(wavefronts_.size()) || comp >= numComponents_) {
+        return NULL_OFFSET;
+    }
+    const Wavefront_& wf = wavefronts_[s];
+    if (k < wf.lo || k > wf.hi) {
+        return NULL_OFFSET;
+    }
+    const int32_t width = wf.hi - wf.lo + 1;
+    return offsets_[wf.start + comp * width + k - wf.lo];
+}
+
+AlignerWFA::ComponentView_ AlignerWFA::View_(int32_t comp, int32_t s) const
+{
+    ComponentView_ ret;
+    if (s < 0 || s >= static_cast<int32_t>(wavefronts_.size()) || comp >= numComponents_) {
+        return ret;
+    }
+    const Wavefront_& wf = wavefronts_[s];
+    if (wf.lo > wf.hi) {
+        return ret;
+    }
+    const int32_t width = wf.hi - wf.lo + 1;
+    ret.data = offsets_.data() + wf.start + comp * width;
+    ret.lo = wf.lo;
+    ret.hi = wf.hi;
+    return ret;
+}
+
+int32_t AlignerWFA::PenaltyToScore_(int32_t s, int32_t qPos, int32_t tPos) const
+{
+    return (opt_.matchScore * (qPos + tPos) - s * scale_) / 2;
+}
+
+bool AlignerWFA::ComputeWavefront_(int32_t s, const char* qseq, int32_t qlen, const char* tseq,
+                                   int32_t tlen, int32_t kMin, int32_t kMax)
+{
+    Wavefront_ wf;
+
+    if (s == 0) {
+        wf.lo = 0;
+        wf.hi = 0;
+        wf.start = offsets_.size();
+        offsets_.resize(wf.start + numComponents_, NULL_OFFSET);
+        offsets_[wf.start + COMP_M] =
+            Alignment::CountMatchingPrefix(qseq, tseq, std::min(qlen, tlen));
+        wavefronts_.emplace_back(wf);
+        return true;
+    }
+
+    // The span of diagonals which can be reached from the source wavefronts.
+    const auto SourceSpan = [&](int32_t sourceS, int32_t widen) {
+        if (sourceS < 0 || wavefronts_[sourceS].lo > wavefronts_[sourceS].hi) {
+            return;
+        }
+        wf.lo = std::min(wf.lo, wavefronts_[sourceS].lo - widen);
+        wf.hi = std::max(wf.hi, wavefronts_[sourceS].hi + widen);
+    };
+    wf.lo = std::numeric_limits<int32_t>::max();
+    wf.hi = std::numeric_limits<int32_t>::min();
+    SourceSpan(s - mismatch_, 0);
+    SourceSpan(s - gapOpen1_ - gapExtend1_, 1);
+    SourceSpan(s - gapExtend1_, 1);
+    if (numComponents_ == 5) {
+        SourceSpan(s - gapOpen2_ - gapExtend2_, 1);
+        SourceSpan(s - gapExtend2_, 1);
+    }
+    wf.lo = std::max(wf.lo, kMin);
+    wf.hi = std::min(wf.hi, kMax);
+    if (wf.lo > wf.hi) {
+        wf.lo = 0;
+        wf.hi = -1;
+        wavefronts_.emplace_back(wf);
+        return false;
+    }
+
+    const int32_t width = wf.hi - wf.lo + 1;
+    wf.start = offsets_.size();
+    offsets_.resize(wf.start + numComponents_ * width, NULL_OFFSET);
+    wavefronts_.emplace_back(wf);
+
+    // Views are taken after the resize, because it can move the buffer.
+    const auto At = [](const ComponentView_& view, int32_t k) {
+        return (k >= view.lo && k <= view.hi) ? view.data[k - view.lo] : NULL_OFFSET;
+    };
+    const ComponentView_ srcMismatch = View_(COMP_M, s - mismatch_);
+    const ComponentView_ srcOpen1 = View_(COMP_M, s - gapOpen1_ - gapExtend1_);
+    const ComponentView_ srcIns1 = View_(COMP_I1, s - gapExtend1_);
+    const ComponentView_ srcDel1 = View_(COMP_D1, s - gapExtend1_);
+    const ComponentView_ srcOpen2 = View_(COMP_M, s - gapOpen2_ - gapExtend2_);
+    const ComponentView_ srcIns2 = View_(COMP_I2, s - gapExtend2_);
+    const ComponentView_ srcDel2 = View_(COMP_D2, s - gapExtend2_);
+
+    int32_t* outM = offsets_.data() + wf.start + COMP_M * width;
+    int32_t* outI1 = offsets_.data() + wf.start + COMP_I1 * width;
+    int32_t* outD1 = offsets_.data() + wf.start + COMP_D1 * width;
+    int32_t* outI2 = (numComponents_ == 5) ? offsets_.data() + wf.start + COMP_I2 * width : nullptr;
+    int32_t* outD2 = (numComponents_ == 5) ? offsets_.data() + wf.start + COMP_D2 * width : nullptr;
+
+    // An insertion moves along the query, and a deletion along the target. Cells
+    // outside of the sequences are dropped.
+    const auto Insertion = [&](int32_t h, int32_t k) {
+        return (h < 0 || (h - k) > qlen) ? NULL_OFFSET : h;
+    };
+    const auto Deletion = [&](int32_t h) { return (h < 0 || h > tlen) ? NULL_OFFSET : h; };
+
+    bool anyValid = false;
+    for (int32_t k = wf.lo; k <= wf.hi; ++k) {
+        const int32_t i = k - wf.lo;
+
+        const int32_t ins1 = Insertion(std::max(At(srcOpen1, k + 1), At(srcIns1, k + 1)), k);
+        const int32_t del1 = Deletion(std::max(At(srcOpen1, k - 1), At(srcDel1, k - 1)) + 1);
+        outI1[i] = ins1;
+        outD1[i] = del1;
+
+        int32_t h = std::max(ins1, del1);
+        if (numComponents_ == 5) {
+            const int32_t ins2 = Insertion(std::max(At(srcOpen2, k + 1), At(srcIns2, k + 1)), k);
+            const int32_t del2 = Deletion(std::max(At(srcOpen2, k - 1), At(srcDel2, k - 1)) + 1);
+            outI2[i] = ins2;
+            outD2[i] = del2;
+            h = std::max({h, ins2, del2});
+        }
+
+        const int32_t mismatch = At(srcMismatch, k) + 1;
+        if (mismatch >= 0 && mismatch <= tlen && (mismatch - k) <= qlen) {
+            h = std::max(h, mismatch);
+        }
+
+        if (h < 0) {
+            outM[i] = NULL_OFFSET;
+            continue;
+        }
+
+        // Extend along the diagonal while the bases match.
+        const int32_t v = h - k;
+        h += Alignment::CountMatchingPrefix(qseq + v, tseq + h, std::min(qlen - v, tlen - h));
+        outM[i] = h;
+        anyValid = true;
+    }
+
+    return anyValid;
+}
+
+PacBio::Data::Cigar AlignerWFA::Backtrack_(const AlignmentEnd_& end) const
+{
+    // The operations are collected from the end, and reversed at the end.
+    PacBio::Data::Cigar cigar;
+
+    int32_t comp = COMP_M;
+    int32_t s = end.s;
+    int32_t k = end.k;
+    int32_t h = end.h;
+
+    while (true) {
+        if (comp == COMP_M) {
+            if (s == 0) {
+                AppendToCigar(cigar, PacBio::Data::CigarOperationType::SEQUENCE_MATCH, h);
+                break;
+            }
+            // Recompute the offset before the match extension. A mismatch candidate which
+            // was dropped because it falls outside of the sequences is always beyond h,
+            // so it cannot be picked here.
+            int32_t mismatch = Get_(COMP_M, s - mismatch_, k);
+            mismatch = (mismatch >= 0) ? (mismatch + 1) : NULL_OFFSET;
+            mismatch = (mismatch <= h) ? mismatch : NULL_OFFSET;
+            int32_t h0 = std::max({mismatch, Get_(COMP_I1, s, k), Get_(COMP_D1, s, k)});
+            if (numComponents_ == 5) {
+                h0 = std::max({h0, Get_(COMP_I2, s, k), Get_(COMP_D2, s, k)});
+            }
+            AppendToCigar(cigar, PacBio::Data::CigarOperationType::SEQUENCE_MATCH, h - h0);
+            h = h0;
+            if (h0 == mismatch) {
+                AppendToCigar(cigar, PacBio::Data::CigarOperationType::SEQUENCE_MISMATCH, 1);
+                s -= mismatch_;
+                h -= 1;
+            } else if (h0 == Get_(COMP_I1, s, k)) {
+                comp = COMP_I1;
+            } else if (h0 == Get_(COMP_D1, s, k)) {
+                comp = COMP_D1;
+            } else if (h0 == Get_(COMP_I2, s, k)) {
+                comp = COMP_I2;
+            } else {
+                comp = COMP_D2;
+            }
+
+        } else if (comp == COMP_I1 || comp == COMP_I2) {
+            const int32_t gapOpen = (comp == COMP_I1) ? gapOpen1_ : gapOpen2_;
+            const int32_t gapExtend = (comp == COMP_I1) ? gapExtend1_ : gapExtend2_;
+            AppendToCigar(cigar, PacBio::Data::CigarOperationType::INSERTION, 1);
+            if (Get_(COMP_M, s - gapOpen - gapExtend, k + 1) == h) {
+                s -= gapOpen + gapExtend;
+                comp = COMP_M;
+            } else {
+                s -= gapExtend;
+            }
+            k += 1;
+
+        } else {
+            const int32_t gapOpen = (comp == COMP_D1) ? gapOpen1_ : gapOpen2_;
+            const int32_t gapExtend = (comp == COMP_D1) ? gapExtend1_ : gapExtend2_;
+            AppendToCigar(cigar, PacBio::Data::CigarOperationType::DELETION, 1);
+            if (Get_(COMP_M, s - gapOpen - gapExtend, k - 1) == (h - 1)) {
+                s -= gapOpen + gapExtend;
+                comp = COMP_M;
+            } else {
+                s -= gapExtend;
+            }
+            k -= 1;
+            h -= 1;
+        }
+    }
+
+    std::reverse(cigar.begin(), cigar.end());
+    return cigar;
+}
+
+}  // namespace Pancake
+}  // namespace PacBio
@@ -4,7 +4,9 @@
 #include <pacbio/pancake/AlignmentSeeded.h>
 #include <pacbio/pancake/OverlapWriterBase.h>
 #include <pbcopper/logging/Logging.h>
+#include <cstring>
 #include <iostream>
+#include <pacbio/alignment/Ses2AlignBanded.hpp>
 
 namespace PacBio {
 namespace Pancake {
@@ -166,22 +168,16 @@ std::vector<AlignmentRegion> ExtractAlignmentRegions(const std::vector<SeedHit>&
     return ret;
 }
 
-AlignmentResult AlignSingleRegion(const char* targetSeq, int32_t targetLen, const char* querySeqFwd,
-                                  const char* querySeqRev, int32_t queryLen,
-                                  AlignerBasePtr& alignerGlobal, AlignerBasePtr& alignerExt,
-                                  const AlignmentRegion& region)
+namespace {
+
+void ValidateRegion(const char* targetSeq, int32_t targetLen, const char* querySeqFwd,
+                    const char* querySeqRev, int32_t queryLen, const AlignmentRegion& region)
 {
-    const char* querySeqInStrand = region.queryRev ? querySeqRev : querySeqFwd;
-    const char* targetSeqInStrand = targetSeq;
-    int32_t qStart = region.qStart;
-    int32_t tStart = region.tStart;
+    const int32_t qStart = region.qStart;
+    const int32_t tStart = region.tStart;
     const int32_t qSpan = region.qSpan;
     const int32_t tSpan = region.tSpan;
 
-    if (qSpan == 0 && tSpan == 0) {
-        return {};
-    }
-
     if (qStart >= queryLen || (qStart + qSpan) > queryLen || tStart >= targetLen ||
         (tStart + tSpan) > targetLen || qSpan < 0 || tSpan < 0) {
         std::ostringstream oss;
@@ -199,6 +195,102 @@ AlignmentResult AlignSingleRegion(const char* targetSeq, int32_t targetLen, cons
             << ", regionId = " << region.regionId;
         throw std::runtime_error(oss.str());
     }
+}
+
+/*
+ * Tries to align a GLOBAL region without the global aligner: first by comparing the
+ * sequences, and then with a banded SES which gives up after maxDiffs edits.
+ * Returns false if neither applies, and the region then needs the global aligner.
+*/
+bool AlignRegionFastPath(const char* qseq, int32_t qlen, const char* tseq, int32_t tlen,
+                         int32_t maxDiffs, const AlignmentParameters& alnParams,
+                         const std::shared_ptr<Alignment::SESScratchSpace>& ss,
+                         AlignmentResult& alnRes, RegionAlignmentCounts& regionCounts)
+{
+    // SES considers an empty sequence to be aligned, so pure gaps go to the aligner.
+    if (maxDiffs < 0 || qlen == 0 || tlen == 0) {
+        return false;
+    }
+
+    alnRes.cigar.clear();
+
+    if (qlen == tlen && std::memcmp(qseq, tseq, qlen) == 0) {
+        alnRes.cigar.emplace_back(
+            Data::CigarOperation(Data::CigarOperationType::SEQUENCE_MATCH, qlen));
+        ++regionCounts.numExact;
+
+    } else if (std::abs(qlen - tlen) <= maxDiffs) {
+        // SES only finds alignments with fewer than its maxDiffs edits.
+        auto aln = Alignment::SES2AlignBanded<Alignment::SESAlignMode::Global,
+                                              Alignment::SESTrimmingMode::Disabled,
+                                              Alignment::SESTracebackMode::Enabled>(
+            qseq, qlen, tseq, tlen, maxDiffs + 1, maxDiffs + 1, ss);
+        if (aln.valid == false || aln.numDiffs > maxDiffs) {
+            return false;
+        }
+        alnRes.cigar = NormalizeCigar(qseq, qlen, tseq, tlen, aln.cigar);
+        ++regionCounts.numSES;
+
+    } else {
+        return false;
+    }
+
+    alnRes.lastQueryPos = qlen;
+    alnRes.lastTargetPos = tlen;
+    alnRes.maxQueryPos = qlen - 1;
+    alnRes.maxTargetPos = tlen - 1;
+    alnRes.valid = true;
+    alnRes.score =
+        ScoreCigarAlignment(alnRes.cigar, alnParams.matchScore, alnParams.mismatchPenalty,
+                            alnParams.gapOpen1, alnParams.gapExtend1);
+    alnRes.maxScore = alnRes.score;
+    alnRes.zdropped = false;
+    return true;
+}
+
+}  // namespace
+
+AlignmentResult AlignSingleRegion(const char* targetSeq, int32_t targetLen, const char* querySeqFwd,
+                                  const char* querySeqRev, int32_t queryLen,
+                                  AlignerBasePtr& alignerGlobal, AlignerBasePtr& alignerExt,
+                                  const AlignmentRegion& region)
+{
+    AlignmentResult alnRes;
+    AlignSingleRegion(targetSeq, targetLen, querySeqFwd, querySeqRev, queryLen, alignerGlobal,
+                      alignerExt, region, alnRes);
+    return alnRes;
+}
+
+void AlignSingleRegion(const char* targetSeq, int32_t targetLen, const char* querySeqFwd,
+                       const char* querySeqRev, int32_t queryLen, AlignerBasePtr& alignerGlobal,
+                       AlignerBasePtr& alignerExt, const AlignmentRegion& region,
+                       AlignmentResult& alnRes)
+{
+    RegionAlignmentCounts regionCounts;
+    AlignSingleRegion(targetSeq, targetLen, querySeqFwd, querySeqRev, queryLen, alignerGlobal,
+                      alignerExt, region, -1, AlignmentParameters(), nullptr, alnRes, regionCounts);
+}
+
+void AlignSingleRegion(const char* targetSeq, int32_t targetLen, const char* querySeqFwd,
+                       const char* querySeqRev, int32_t queryLen, AlignerBasePtr& alignerGlobal,
+                       AlignerBasePtr& alignerExt, const AlignmentRegion& region,
+                       int32_t fastPathMaxDiffs, const AlignmentParameters& alnParams,
+                       const std::shared_ptr<Alignment::SESScratchSpace>& sesScratch,
+                       AlignmentResult& alnRes, RegionAlignmentCounts& regionCounts)
+{
+    const char* querySeqInStrand = region.queryRev ? querySeqRev : querySeqFwd;
+    const char* targetSeqInStrand = targetSeq;
+    int32_t qStart = region.qStart;
+    int32_t tStart = region.tStart;
+    const int32_t qSpan = region.qSpan;
+    const int32_t tSpan = region.tSpan;
+
+    if (qSpan == 0 && tSpan == 0) {
+        alnRes = AlignmentResult();
+        return;
+    }
+
+    ValidateRegion(targetSeq, targetLen, querySeqFwd, querySeqRev, queryLen, region);
 
     // Prepare the reversed front sequence if required.
     std::string qSubSeq;
@@ -215,20 +307,20 @@ AlignmentResult AlignSingleRegion(const char* targetSeq, int32_t targetLen, cons
     }
 
     // Align.
-    AlignmentResult alnRes;
     if (region.type == RegionType::FRONT || region.type == RegionType::BACK) {
-        alnRes =
-            alignerExt->Extend(querySeqInStrand + qStart, qSpan, targetSeqInStrand + tStart, tSpan);
-    } else {
-        alnRes = alignerGlobal->Global(querySeqInStrand + qStart, qSpan, targetSeqInStrand + tStart,
-                                       tSpan);
+        alignerExt->ExtendInto(querySeqInStrand + qStart, qSpan, targetSeqInStrand + tStart, tSpan,
+                               alnRes);
+    } else if (AlignRegionFastPath(querySeqInStrand + qStart, qSpan, targetSeqInStrand + tStart,
+                                   tSpan, fastPathMaxDiffs, alnParams, sesScratch, alnRes,
+                                   regionCounts) == false) {
+        alignerGlobal->GlobalInto(querySeqInStrand + qStart, qSpan, targetSeqInStrand + tStart,
+                                  tSpan, alnRes);
+        ++regionCounts.numAligner;
     }
 
     if (region.type == RegionType::FRONT) {
         std::reverse(alnRes.cigar.begin(), alnRes.cigar.end());
     }
-
-    return alnRes;
 }
 
 AlignRegionsGenericResult AlignRegionsGeneric(const char* targetSeq, const int32_t targetLen,
@@ -236,17 +328,74 @@ AlignRegionsGenericResult AlignRegionsGeneric(const char* targetSeq, const int32
                                               const int32_t queryLen,
                                               const std::vector<AlignmentRegion>& regions,
                                               AlignerBasePtr& alignerGlobal,
-                                              AlignerBasePtr& alignerExt)
+                                              AlignerBasePtr& alignerExt, int32_t fastPathMaxDiffs,
+                                              const AlignmentParameters& alnParams)
+{
+    AlignRegionsGenericScratch scratch;
+    return AlignRegionsGeneric(targetSeq, targetLen, queryFwd, queryRev, queryLen, regions,
+                               alignerGlobal, alignerExt, fastPathMaxDiffs, alnParams, scratch);
+}
+
+AlignRegionsGenericResult AlignRegionsGeneric(
+    const char* targetSeq, const int32_t targetLen, const char* queryFwd, const char* queryRev,
+    const int32_t queryLen, const std::vector<AlignmentRegion>& regions,
+    AlignerBasePtr& alignerGlobal, AlignerBasePtr& alignerExt, int32_t fastPathMaxDiffs,
+    const AlignmentParameters& alnParams, AlignRegionsGenericScratch& scratch)
 {
     AlignRegionsGenericResult ret;
 
-    std::vector<AlignmentResult> alignedRegions;
+    // The internal regions do not depend on each other, so they are aligned as one batch.
+    // Regions taken by the fast paths are stored separately and skip the batch.
+    // The fast results are never shrunk, so that their CIGARs keep the storage.
+    auto& globalJobs = scratch.globalJobs;
+    auto& globalResults = scratch.globalResults;
+    auto& regionToJob = scratch.regionToJob;
+    auto& fastResults = scratch.fastResults;
+    auto& regionToFast = scratch.regionToFast;
+    globalJobs.clear();
+    regionToJob.assign(regions.size(), -1);
+    regionToFast.assign(regions.size(), -1);
+    int32_t numFast = 0;
+    for (size_t i = 0; i < regions.size(); ++i) {
+        const auto& region = regions[i];
+        if (region.type != RegionType::GLOBAL || (region.qSpan == 0 && region.tSpan == 0)) {
+            continue;
+        }
+        ValidateRegion(targetSeq, targetLen, queryFwd, queryRev, queryLen, region);
+        const char* querySeqInStrand = region.queryRev ? queryRev : queryFwd;
+        if (numFast == static_cast<int32_t>(fastResults.size())) {
+            fastResults.emplace_back(AlignmentResult());
+        }
+        if (AlignRegionFastPath(querySeqInStrand + region.qStart, region.qSpan,
+                                targetSeq + region.tStart, region.tSpan, fastPathMaxDiffs,
+                                alnParams, scratch.sesScratch, fastResults[numFast],
+                                ret.regionCounts)) {
+            regionToFast[i] = numFast;
+            ++numFast;
+            continue;
+        }
+        ++ret.regionCounts.numAligner;
+        regionToJob[i] = globalJobs.size();
+        globalJobs.emplace_back(AlignmentJob(querySeqInStrand + region.qStart, region.qSpan,
+                                             targetSeq + region.tStart, region.tSpan,
+                                             AlignmentMode::GLOBAL));
+    }
+    alignerGlobal->AlignBatch(globalJobs, globalResults);
+
+    // One result is reused for the flanks and the empty regions.
+    AlignmentResult& flankRes = scratch.flankResult;
 
     for (size_t i = 0; i < regions.size(); ++i) {
         const auto& region = regions[i];
 
-        auto alnRes = AlignSingleRegion(targetSeq, targetLen, queryFwd, queryRev, queryLen,
-                                        alignerGlobal, alignerExt, region);
+        if (regionToJob[i] < 0 && regionToFast[i] < 0) {
+            AlignSingleRegion(targetSeq, targetLen, queryFwd, queryRev, queryLen, alignerGlobal,
+                              alignerExt, region, flankRes);
+        }
+        const AlignmentResult& alnRes =
+            (regionToJob[i] >= 0)
+                ? globalResults[regionToJob[i]]
+                : ((regionToFast[i] >= 0) ? fastResults[regionToFast[i]] : flankRes);
 
         if (region.type == RegionType::FRONT) {
             ret.offsetFrontQuery = alnRes.lastQueryPos;
@@ -256,8 +405,16 @@ AlignRegionsGenericResult AlignRegionsGeneric(const char* targetSeq, const int32
             ret.offsetBackTarget = alnRes.lastTargetPos;
         }
 
-        // Store the results.
-        alignedRegions.emplace_back(std::move(alnRes));
+        // Merge the CIGAR chunk into the alignment.
+        const auto& currCigar = alnRes.cigar;
+        if (!currCigar.empty()) {
+            if (ret.cigar.empty() || ret.cigar.back().Type() != currCigar.front().Type()) {
+                ret.cigar.emplace_back(currCigar.front());
+            } else {
+                ret.cigar.back().Length(ret.cigar.back().Length() + currCigar.front().Length());
+            }
+            ret.cigar.insert(ret.cigar.end(), currCigar.begin() + 1, currCigar.end());
+        }
 
 #ifdef DEBUG_ALIGNMENT_SEEDED
         std::cerr << "[aln region i = " << i << " / " << regions.size() << "]"
@@ -276,20 +433,6 @@ AlignRegionsGenericResult AlignRegionsGeneric(const char* targetSeq, const int32
 #endif
     }
 
-    // Merge the CIGAR chunks.
-    for (const auto& alnRegion : alignedRegions) {
-        const auto& currCigar = alnRegion.cigar;
-        if (currCigar.empty()) {
-            continue;
-        }
-        if (ret.cigar.empty() || ret.cigar.back().Type() != currCigar.front().Type()) {
-            ret.cigar.emplace_back(currCigar.front());
-        } else {
-            ret.cigar.back().Length(ret.cigar.back().Length() + currCigar.front().Length());
-        }
-        ret.cigar.insert(ret.cigar.end(), currCigar.begin() + 1, currCigar.end());
-    }
-
     return ret;
 }
 
@@ -298,6 +441,21 @@ OverlapPtr AlignmentSeeded(const OverlapPtr& ovl, const std::vector<SeedHit>& so
                            const char* queryRev, const int32_t queryLen, int32_t minAlignmentSpan,
                            int32_t maxFlankExtensionDist, AlignerBasePtr& alignerGlobal,
                            AlignerBasePtr& alignerExt)
+{
+    AlignRegionsGenericScratch scratch;
+    RegionAlignmentCounts regionCounts;
+    return AlignmentSeeded(ovl, sortedHits, targetSeq, targetLen, queryFwd, queryRev, queryLen,
+                           minAlignmentSpan, maxFlankExtensionDist, alignerGlobal, alignerExt, -1,
+                           AlignmentParameters(), scratch, regionCounts);
+}
+
+OverlapPtr AlignmentSeeded(const OverlapPtr& ovl, const std::vector<SeedHit>& sortedHits,
+                           const char* targetSeq, const int32_t targetLen, const char* queryFwd,
+                           const char* queryRev, const int32_t queryLen, int32_t minAlignmentSpan,
+                           int32_t maxFlankExtensionDist, AlignerBasePtr& alignerGlobal,
+                           AlignerBasePtr& alignerExt, int32_t fastPathMaxDiffs,
+                           const AlignmentParameters& alnParams,
+                           AlignRegionsGenericScratch& scratch, RegionAlignmentCounts& regionCounts)
 {
     // Sanity checks.
     if (ovl->Arev) {
@@ -347,8 +505,10 @@ OverlapPtr AlignmentSeeded(const OverlapPtr& ovl, const std::vector<SeedHit>& so
         sortedHits, ovl->Alen, ovl->Blen, ovl->Brev, minAlignmentSpan, maxFlankExtensionDist, 1.3);
 
     // Run the alignment.
-    AlignRegionsGenericResult alns = AlignRegionsGeneric(
-        targetSeq, targetLen, queryFwd, queryRev, queryLen, regions, alignerGlobal, alignerExt);
+    AlignRegionsGenericResult alns =
+        AlignRegionsGeneric(targetSeq, targetLen, queryFwd, queryRev, queryLen, regions,
+                            alignerGlobal, alignerExt, fastPathMaxDiffs, alnParams, scratch);
+    regionCounts += alns.regionCounts;
 
     // Process the alignment results and make a new overlap.
     int32_t globalAlnQueryStart = 0;
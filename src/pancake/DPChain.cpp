@@ -12,15 +12,245 @@
 #include <lib/math.hpp>
 #include <sstream>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#define PANCAKE_DPCHAIN_AVX2
+#include <immintrin.h>
+#endif
+
 namespace PacBio {
 namespace Pancake {
 
 constexpr int32_t PlusInf = std::numeric_limits<int32_t>::max() - 10000;  // Leave a margin.
 
+namespace {
+
+/*
+ * Finds the maximum of every chain in the DP matrix and backtracks the chains
+ * from them. The DP arrays have the "Null" state at index 0, as in ChainHits.
+*/
+std::vector<ChainedHits> BacktrackChains(const SeedHit* hits, const std::vector<int32_t>& dp,
+                                         const std::vector<int32_t>& pred,
+                                         const std::vector<int32_t>& chain_id, int32_t num_chains,
+                                         int32_t minNumSeeds, int32_t minCovBases,
+                                         int32_t minDPScore)
+{
+    const int32_t n_hits = static_cast<int32_t>(dp.size()) - 1;
+    std::vector<ChainedHits> chains;
+
+    // Find the maximum of every chain for backtracking.
+    std::vector<int32_t> chain_maxima(num_chains, -PlusInf);
+    for (int32_t i = 1; i < (n_hits + 1); i++) {
+        if (chain_maxima[chain_id[i]] == -PlusInf || dp[i] >= dp[chain_maxima[chain_id[i]]]) {
+            chain_maxima[chain_id[i]] = i;
+        }
+    }
+
+    // Backtrack.
+    for (int32_t i = 0; i < static_cast<int32_t>(chain_maxima.size()); i++) {
+        // Trace back from the maxima.
+        int32_t node_id = chain_maxima[i];
+        int32_t score = dp[node_id];
+
+        if (score < minDPScore) {
+            continue;
+        }
+
+        std::vector<int32_t> nodes;
+        while (node_id > 0) {
+            nodes.emplace_back(node_id - 1);  // The "- 1" is because of the DP offset.
+            node_id = pred[node_id];
+        }
+        // Reverse the backtracked nodes.
+        std::reverse(nodes.begin(), nodes.end());
+
+        // Skip if needed.
+        if (nodes.empty() || static_cast<int32_t>(nodes.size()) < minNumSeeds) {
+            continue;
+        }
+
+        /////////////////////////
+        /// Create the chain. ///
+        /////////////////////////
+        ChainedHits chain;
+        int32_t currTargetId = hits[nodes.front()].targetId;
+        bool currTargetRev = hits[nodes.front()].targetRev;
+        if (chain.targetId == -1 || chain.targetId != currTargetId ||
+            chain.targetRev != currTargetRev) {
+            chain = ChainedHits(currTargetId, currTargetRev);
+        }
+
+        for (auto& node : nodes) {
+            chain.hits.emplace_back(hits[node]);
+        }
+
+        // Penalize the distance from the end of the query.
+        // Otherwise, shorted chains near the beginning would
+        // prevail longer ones in some cases.
+        // int32_t chain_dist_to_end = qseq.get_sequence_length() - chain->hits().back().QueryPos();
+        // int32_t chain_score = score - chain_dist_to_end * params->chain_penalty_gap;
+        // chain->score(chain_score);
+        chain.score = score;
+
+        CalcHitCoverage(chain.hits, 0, chain.hits.size(), chain.coveredBasesQuery,
+                        chain.coveredBasesTarget);
+
+        // int32_t qspan = chain.hits.back().queryPos - chain.hits.front().queryPos;
+        // double frac = (qspan == 0) ? 0 : ((double)chain.coveredBasesQuery) / ((double)qspan);
+
+        // Add the new chain.
+        if (chain.coveredBasesQuery >= minCovBases && chain.coveredBasesTarget >= minCovBases) {
+            chains.emplace_back(std::move(chain));
+        }
+        /////////////////////////
+    }
+
+    return chains;
+}
+
+/*
+ * A segment tree which holds a value for each of the positions [0, size), and
+ * answers the maximum value (and its ID) in a range of positions in O(log size).
+ * Ties are resolved in favor of the larger ID.
+*/
+class MaxSegmentTree
+{
+public:
+    MaxSegmentTree(int32_t size) : size_(std::max(1, size)), nodes_(2 * size_, EMPTY_NODE) {}
+
+    void Set(int32_t pos, double value, int32_t id)
+    {
+        int32_t node = pos + size_;
+        nodes_[node] = std::make_pair(value, id);
+        for (node >>= 1; node > 0; node >>= 1) {
+            nodes_[node] = std::max(nodes_[2 * node], nodes_[2 * node + 1]);
+        }
+    }
+
+    void Clear(int32_t pos) { Set(pos, EMPTY_NODE.first, EMPTY_NODE.second); }
+
+    // Returns the maximum in the range [begin, end), or an ID of -1 if the range is empty.
+    std::pair<double, int32_t> Query(int32_t begin, int32_t end) const
+    {
+        std::pair<double, int32_t> ret = EMPTY_NODE;
+        for (begin += size_, end += size_; begin < end; begin >>= 1, end >>= 1) {
+            if (begin & 1) {
+                ret = std::max(ret, nodes_[begin++]);
+            }
+            if (end & 1) {
+                ret = std::max(ret, nodes_[--end]);
+            }
+        }
+        return ret;
+    }
+
+private:
+    static constexpr std::pair<double, int32_t> EMPTY_NODE{-std::numeric_limits<double>::infinity(),
+                                                           -1};
+    int32_t size_;
+    std::vector<std::pair<double, int32_t>> nodes_;
+};
+
+}  // namespace
+
+#ifdef PANCAKE_DPCHAIN_AVX2
+namespace {
+
+// Number of predecessors evaluated at once by the vectorized scan.
+constexpr int32_t CHAIN_SIMD_LANES = 8;
+
+// Values of the flags computed for each predecessor by EvaluatePredecessorsAVX2.
+constexpr int32_t CHAIN_PRED_SKIP = 1;  // Not a valid predecessor, continue the scan.
+constexpr int32_t CHAIN_PRED_STOP = 2;  // Stop the scan.
+
+bool CPUSupportsAVX2()
+{
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+/*
+ * Evaluates CHAIN_SIMD_LANES consecutive predecessors of the hit (xi, yi, targetIdRevI).
+ * The input arrays point to the first of the predecessors, and the dpScores are
+ * the DP values of the same predecessors.
+ * The scores and the flags are computed exactly as in the scalar loop of ChainHits,
+ * including the truncation of the linear gap penalty and the log2 of the gap.
+ * A flag has CHAIN_PRED_STOP set if the scalar loop would break at this
+ * predecessor, and CHAIN_PRED_SKIP if it would continue.
+*/
+__attribute__((target("avx2"))) void EvaluatePredecessorsAVX2(
+    const int32_t* queryPos, const int32_t* targetPos, const int32_t* targetIdRev,
+    const int32_t* querySpan, const int32_t* dpScores, int32_t xi, int32_t yi, int32_t targetIdRevI,
+    int32_t seedJoinDist, int32_t diagMargin, double linFactor, int32_t* retScores,
+    int32_t* retFlags)
+{
+    const __m256i xj = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(queryPos));
+    const __m256i yj = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(targetPos));
+    const __m256i tj = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(targetIdRev));
+    const __m256i spanj = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(querySpan));
+    const __m256i dpj = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dpScores));
+
+    const __m256i vxi = _mm256_set1_epi32(xi);
+    const __m256i vyi = _mm256_set1_epi32(yi);
+    const __m256i vJoinDist = _mm256_set1_epi32(seedJoinDist);
+
+    const __m256i distX = _mm256_sub_epi32(vxi, xj);
+    const __m256i distY = _mm256_sub_epi32(vyi, yj);
+    const __m256i gap = _mm256_abs_epi32(_mm256_sub_epi32(distX, distY));
+
+    // Conditions on which the scalar loop breaks.
+    const __m256i stop =
+        _mm256_or_si256(_mm256_xor_si256(_mm256_cmpeq_epi32(tj, _mm256_set1_epi32(targetIdRevI)),
+                                         _mm256_set1_epi32(-1)),
+                        _mm256_cmpgt_epi32(distY, vJoinDist));
+
+    // Conditions on which the scalar loop continues.
+    __m256i skip =
+        _mm256_xor_si256(_mm256_and_si256(_mm256_cmpgt_epi32(vxi, xj), _mm256_cmpgt_epi32(vyi, yj)),
+                         _mm256_set1_epi32(-1));
+    skip = _mm256_or_si256(skip, _mm256_cmpgt_epi32(gap, _mm256_set1_epi32(diagMargin)));
+    skip = _mm256_or_si256(skip, _mm256_cmpgt_epi32(distX, vJoinDist));
+
+    const __m256i flags =
+        _mm256_or_si256(_mm256_and_si256(stop, _mm256_set1_epi32(CHAIN_PRED_STOP)),
+                        _mm256_and_si256(skip, _mm256_set1_epi32(CHAIN_PRED_SKIP)));
+
+    // The gap is converted to double in two halves. The linear part is truncated
+    // like the scalar conversion, and the exponent of the (exact) double is the log2.
+    const __m128i gapLo = _mm256_castsi256_si128(gap);
+    const __m128i gapHi = _mm256_extracti128_si256(gap, 1);
+    const __m256d gapLoD = _mm256_cvtepi32_pd(gapLo);
+    const __m256d gapHiD = _mm256_cvtepi32_pd(gapHi);
+    const __m256d vLinFactor = _mm256_set1_pd(linFactor);
+    const __m256i linPart =
+        _mm256_set_m128i(_mm256_cvttpd_epi32(_mm256_mul_pd(gapHiD, vLinFactor)),
+                         _mm256_cvttpd_epi32(_mm256_mul_pd(gapLoD, vLinFactor)));
+
+    const __m256i packLow32 = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    const __m256i bias = _mm256_set1_epi64x(1023);
+    const __m256i expLo = _mm256_permutevar8x32_epi32(
+        _mm256_sub_epi64(_mm256_srli_epi64(_mm256_castpd_si256(gapLoD), 52), bias), packLow32);
+    const __m256i expHi = _mm256_permutevar8x32_epi32(
+        _mm256_sub_epi64(_mm256_srli_epi64(_mm256_castpd_si256(gapHiD), 52), bias), packLow32);
+    __m256i logPart =
+        _mm256_set_m128i(_mm256_castsi256_si128(expHi), _mm256_castsi256_si128(expLo));
+    logPart = _mm256_andnot_si256(_mm256_cmpeq_epi32(gap, _mm256_setzero_si256()), logPart);
+
+    const __m256i edgeScore = _mm256_add_epi32(linPart, _mm256_srai_epi32(logPart, 1));
+    const __m256i spanScore =
+        _mm256_min_epi32(spanj, _mm256_min_epi32(_mm256_abs_epi32(distX), _mm256_abs_epi32(distY)));
+    const __m256i scores = _mm256_sub_epi32(_mm256_add_epi32(dpj, spanScore), edgeScore);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(retScores), scores);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(retFlags), flags);
+}
+
+}  // namespace
+#endif
+
 std::vector<ChainedHits> ChainHits(const SeedHit* hits, int32_t hitsSize, int32_t chainMaxSkip,
                                    int32_t chainMaxPredecessors, int32_t seedJoinDist,
                                    int32_t diagMargin, int32_t minNumSeeds, int32_t minCovBases,
-                                   int32_t minDPScore)
+                                   int32_t minDPScore, bool useSIMD)
 {
     /*
      * Hits need to be sorted in this order of priority:
@@ -53,6 +283,29 @@ std::vector<ChainedHits> ChainHits(const SeedHit* hits, int32_t hitsSize, int32_
 
     const double lin_factor = 0.01 * avgQuerySpan;
 
+#ifdef PANCAKE_DPCHAIN_AVX2
+    // The vectorized scan needs the hits as a structure of arrays.
+    const bool use_avx2 = useSIMD && CPUSupportsAVX2();
+    std::vector<int32_t> soa_query_pos;
+    std::vector<int32_t> soa_target_pos;
+    std::vector<int32_t> soa_target_id_rev;
+    std::vector<int32_t> soa_query_span;
+    if (use_avx2) {
+        soa_query_pos.resize(n_hits);
+        soa_target_pos.resize(n_hits);
+        soa_target_id_rev.resize(n_hits);
+        soa_query_span.resize(n_hits);
+        for (int32_t i = 0; i < n_hits; i++) {
+            soa_query_pos[i] = hits[i].queryPos;
+            soa_target_pos[i] = hits[i].targetPos;
+            soa_target_id_rev[i] = (hits[i].targetId << 1) | hits[i].targetRev;
+            soa_query_span[i] = hits[i].querySpan;
+        }
+    }
+#else
+    (void)useSIMD;
+#endif
+
     for (int32_t i = 1; i < (n_hits + 1); i++) {
         int32_t x_i_start = hits[i - 1].queryPos;
         int32_t y_i_start = hits[i - 1].targetPos;
@@ -70,10 +323,70 @@ std::vector<ChainedHits> ChainHits(const SeedHit* hits, int32_t hitsSize, int32_
 
         int32_t num_processed = 0;
 
+        // Updates the best predecessor. Returns false if the scan should stop.
+        auto UpdatePredecessor = [&](int32_t j, int32_t score_ij) {
+            if (score_ij >= new_dp_val) {
+                new_dp_pred = j;
+                new_dp_val = score_ij;
+                new_dp_chain = chain_id[j];
+
+                // This is the main difference to how I previously calculated the scan_depth.
+                num_skipped_predecessors -= 1;
+                num_skipped_predecessors = std::max(0, num_skipped_predecessors);
+
+            } else {
+                num_skipped_predecessors += 1;
+                if (num_skipped_predecessors > chainMaxSkip) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
         int32_t min_j = 0;
         // int32_t min_j = std::max(0, i - 1000);
         min_j = (chainMaxPredecessors <= 0) ? 0 : std::max(0, (i - 1 - chainMaxPredecessors));
-        for (int32_t j = (i - 1); j > min_j; j--) {
+        int32_t j = (i - 1);
+
+#ifdef PANCAKE_DPCHAIN_AVX2
+        // Evaluate blocks of predecessors in lanes, and then walk over the lanes in the
+        // same order as the scalar loop, so that the chainMaxSkip heuristic is preserved.
+        bool scan_stopped = false;
+        if (use_avx2) {
+            const int32_t target_id_rev_i = soa_target_id_rev[i - 1];
+            alignas(32) int32_t lane_scores[CHAIN_SIMD_LANES];
+            alignas(32) int32_t lane_flags[CHAIN_SIMD_LANES];
+            for (; (j - CHAIN_SIMD_LANES) >= min_j && scan_stopped == false;
+                 j -= CHAIN_SIMD_LANES) {
+                // Lane 0 holds the predecessor (j - CHAIN_SIMD_LANES + 1), the last lane holds j.
+                const int32_t first_j = j - CHAIN_SIMD_LANES + 1;
+                EvaluatePredecessorsAVX2(&soa_query_pos[first_j - 1], &soa_target_pos[first_j - 1],
+                                         &soa_target_id_rev[first_j - 1],
+                                         &soa_query_span[first_j - 1], &dp[first_j], x_i_start,
+                                         y_i_start, target_id_rev_i, seedJoinDist, diagMargin,
+                                         lin_factor, lane_scores, lane_flags);
+                for (int32_t lane = (CHAIN_SIMD_LANES - 1); lane >= 0; lane--) {
+                    if (lane_flags[lane] & CHAIN_PRED_STOP) {
+                        scan_stopped = true;
+                        break;
+                    }
+                    if (lane_flags[lane] & CHAIN_PRED_SKIP) {
+                        continue;
+                    }
+                    num_processed += 1;
+                    if (UpdatePredecessor(first_j + lane, lane_scores[lane]) == false) {
+                        scan_stopped = true;
+                        break;
+                    }
+                }
+            }
+        }
+        if (scan_stopped) {
+            j = min_j;
+        }
+#endif
+
+        for (; j > min_j; j--) {
 #ifdef EXPERIMENTAL_QUERY_MASK
             bool is_tandem = hits[j - 1].QueryMask() & MINIMIZER_HIT_TANDEM_FLAG;
 #endif
@@ -123,21 +436,8 @@ std::vector<ChainedHits> ChainHits(const SeedHit* hits, int32_t hitsSize, int32_
                 std::min(x_j_span, static_cast<int32_t>(std::min(abs(dist_x), abs(dist_y))));
             int32_t score_ij = dp[j] + x_j_score - edge_score;
 
-            if (score_ij >= new_dp_val) {
-                new_dp_pred = j;
-                new_dp_val = score_ij;
-                new_dp_chain = chain_id[j];
-
-                // This is the main difference to how I previously calculated the scan_depth.
-                num_skipped_predecessors -= 1;
-                num_skipped_predecessors = std::max(0, num_skipped_predecessors);
-
-            } else {
-                num_skipped_predecessors += 1;
-                if (num_skipped_predecessors > chainMaxSkip) {
-                    // std::cerr << "Bump! num_skipped_predecessors = " << num_skipped_predecessors << ", chainMaxSkip = " << chainMaxSkip << std::endl;
-                    break;
-                }
+            if (UpdatePredecessor(j, score_ij) == false) {
+                break;
             }
         }
 
@@ -149,81 +449,181 @@ std::vector<ChainedHits> ChainHits(const SeedHit* hits, int32_t hitsSize, int32_
         }
     }
 
-    // Find the maximum of every chain for backtracking.
-    std::vector<int32_t> chain_maxima(num_chains, -PlusInf);
-    for (int32_t i = 1; i < (n_hits + 1); i++) {
-        if (chain_maxima[chain_id[i]] == -PlusInf || dp[i] >= dp[chain_maxima[chain_id[i]]]) {
-            chain_maxima[chain_id[i]] = i;
-        }
+#ifdef DEBUG_DP_VERBOSE_
+    printf("The DP:\n");
+    for (int32_t i = 0; i < dp.size(); i++) {
+        printf("[%d] dp[i] = %d, pred[i] = %d, chain_id[i] = %d\n", i, dp[i], pred[i], chain_id[i]);
     }
+#endif
 
-    // Backtrack.
-    for (int32_t i = 0; i < static_cast<int32_t>(chain_maxima.size()); i++) {
-        // Trace back from the maxima.
-        int32_t node_id = chain_maxima[i];
-        int32_t score = dp[node_id];
+    return BacktrackChains(hits, dp, pred, chain_id, num_chains, minNumSeeds, minCovBases,
+                           minDPScore);
+}
 
-        if (score < minDPScore) {
-            continue;
-        }
+std::vector<ChainedHits> ChainHitsRMQ(const SeedHit* hits, int32_t hitsSize,
+                                      int32_t maxInnerPredecessors, int32_t seedJoinDist,
+                                      int32_t diagMargin, int32_t minNumSeeds, int32_t minCovBases,
+                                      int32_t minDPScore)
+{
+    /*
+     * Hits need to be sorted in this order of priority:
+     *      target_id, target_rev, target_pos, query_pos
+    */
 
-        std::vector<int32_t> nodes;
-        while (node_id > 0) {
-            nodes.emplace_back(node_id - 1);  // The "- 1" is because of the DP offset.
-            node_id = pred[node_id];
-        }
-        // Reverse the backtracked nodes.
-        std::reverse(nodes.begin(), nodes.end());
+    const int32_t n_hits = hitsSize;
 
-        // Skip if needed.
-        if (nodes.empty() || static_cast<int32_t>(nodes.size()) < minNumSeeds) {
-            continue;
-        }
+    if (n_hits == 0) {
+        return {};
+    }
 
-        /////////////////////////
-        /// Create the chain. ///
-        /////////////////////////
-        ChainedHits chain;
-        int32_t currTargetId = hits[nodes.front()].targetId;
-        bool currTargetRev = hits[nodes.front()].targetRev;
-        if (chain.targetId == -1 || chain.targetId != currTargetId ||
-            chain.targetRev != currTargetRev) {
-            chain = ChainedHits(currTargetId, currTargetRev);
-        }
+    // Zeroth element will be the "Null" state, same as in ChainHits.
+    std::vector<int32_t> dp(n_hits + 1, 0);
+    std::vector<int32_t> pred(n_hits + 1, 0);
+    std::vector<int32_t> chain_id(n_hits + 1, -1);
+    int32_t num_chains = 0;
 
-        for (auto& node : nodes) {
-            chain.hits.emplace_back(hits[node]);
+    double avgQuerySpan = 0.0;
+    for (int32_t i = 0; i < n_hits; i++) {
+        avgQuerySpan += hits[i].querySpan;
+    }
+    avgQuerySpan = avgQuerySpan / static_cast<double>(n_hits);
+
+    const double lin_factor = 0.01 * avgQuerySpan;
+
+    // Scores the hit j (DP index) as the predecessor of the hit i with the same
+    // function as ChainHits. Returns false if j is not a valid predecessor.
+    auto ScorePredecessor = [&](int32_t i, int32_t j, int32_t& score_ij) {
+        const SeedHit& hit_i = hits[i - 1];
+        const SeedHit& hit_j = hits[j - 1];
+        const int32_t dist_x = hit_i.queryPos - hit_j.queryPos;
+        const int32_t dist_y = hit_i.targetPos - hit_j.targetPos;
+        const int32_t gap_dist = (dist_x < dist_y) ? (dist_y - dist_x) : (dist_x - dist_y);
+        if (dist_x <= 0 || dist_y <= 0 || dist_x > seedJoinDist || dist_y > seedJoinDist ||
+            gap_dist > diagMargin) {
+            return false;
+        }
+        const int32_t lin_part = (gap_dist * lin_factor);
+        const int32_t log_part = ((gap_dist == 0) ? 0 : raptor::utility::ilog2_32(gap_dist));
+        const int32_t edge_score = lin_part + (log_part >> 1);
+        const int32_t x_j_score =
+            std::min(static_cast<int32_t>(hit_j.querySpan), std::min(abs(dist_x), abs(dist_y)));
+        score_ij = dp[j] + x_j_score - edge_score;
+        return true;
+    };
+
+    // The value stored in the tree for a predecessor j. The distance to the successor
+    // is approximated with a linear penalty on the sum of both coordinates, which
+    // makes the value independent of the successor.
+    auto TreeValue = [&](int32_t j) {
+        const SeedHit& hit_j = hits[j - 1];
+        return static_cast<double>(dp[j]) +
+               lin_factor * (static_cast<double>(hit_j.queryPos) + hit_j.targetPos);
+    };
+
+    // Each target and strand is chained separately.
+    int32_t group_begin = 1;
+    while (group_begin < (n_hits + 1)) {
+        int32_t group_end = group_begin + 1;
+        while (group_end < (n_hits + 1) &&
+               hits[group_end - 1].targetId == hits[group_begin - 1].targetId &&
+               hits[group_end - 1].targetRev == hits[group_begin - 1].targetRev) {
+            ++group_end;
         }
+        const int32_t group_size = group_end - group_begin;
 
-        // Penalize the distance from the end of the query.
-        // Otherwise, shorted chains near the beginning would
-        // prevail longer ones in some cases.
-        // int32_t chain_dist_to_end = qseq.get_sequence_length() - chain->hits().back().QueryPos();
-        // int32_t chain_score = score - chain_dist_to_end * params->chain_penalty_gap;
-        // chain->score(chain_score);
-        chain.score = score;
+        // Tree leaves are the hits ordered by the diagonal, so that a range query
+        // covers exactly the predecessors within diagMargin of the diagonal.
+        std::vector<std::pair<int32_t, int32_t>> diag_order(group_size);
+        for (int32_t i = group_begin; i < group_end; i++) {
+            diag_order[i - group_begin] = std::make_pair(hits[i - 1].Diagonal(), i);
+        }
+        std::sort(diag_order.begin(), diag_order.end());
+        std::vector<int32_t> leaf(group_size);
+        for (int32_t k = 0; k < group_size; k++) {
+            leaf[diag_order[k].second - group_begin] = k;
+        }
+        auto LeafOfDiagonal = [&diag_order](int32_t diag) -> int32_t {
+            return std::lower_bound(diag_order.begin(), diag_order.end(),
+                                    std::make_pair(diag, std::numeric_limits<int32_t>::min())) -
+                   diag_order.begin();
+        };
+        std::vector<int32_t> excluded;
+
+        MaxSegmentTree tree(group_size);
+        int32_t next_insert = group_begin;
+        int32_t next_remove = group_begin;
+
+        for (int32_t i = group_begin; i < group_end; i++) {
+            const int32_t y_i_start = hits[i - 1].targetPos;
+
+            // Only the hits with a smaller target position can be predecessors.
+            for (; next_insert < i && hits[next_insert - 1].targetPos < y_i_start; next_insert++) {
+                tree.Set(leaf[next_insert - group_begin], TreeValue(next_insert), next_insert);
+            }
+            // Drop the hits which are too far behind on the target.
+            for (; next_remove < next_insert &&
+                   (y_i_start - hits[next_remove - 1].targetPos) > seedJoinDist;
+                 next_remove++) {
+                tree.Clear(leaf[next_remove - group_begin]);
+            }
 
-        CalcHitCoverage(chain.hits, 0, chain.hits.size(), chain.coveredBasesQuery,
-                        chain.coveredBasesTarget);
+            int32_t new_dp_val = hits[i - 1].querySpan;
+            int32_t new_dp_pred = 0;
+            int32_t new_dp_chain = num_chains;
+            auto UpdatePredecessor = [&](int32_t j) {
+                int32_t score_ij = 0;
+                if (ScorePredecessor(i, j, score_ij) && score_ij >= new_dp_val) {
+                    new_dp_pred = j;
+                    new_dp_val = score_ij;
+                    new_dp_chain = chain_id[j];
+                }
+            };
+
+            // The best predecessor within the diagonal margin, found with the RMQ.
+            // The tree holds only the hits within seedJoinDist behind on the target, and
+            // the diagonal range bounds the query distance to within diagMargin of that.
+            // The candidates which still fail the query distance check are taken out
+            // until a valid one is found, and put back afterwards.
+            const int32_t diag_i = hits[i - 1].Diagonal();
+            const int32_t leaf_begin = LeafOfDiagonal(diag_i - diagMargin);
+            const int32_t leaf_end = LeafOfDiagonal(diag_i + diagMargin + 1);
+            int32_t best_j = -1;
+            int32_t best_score = 0;
+            while ((best_j = tree.Query(leaf_begin, leaf_end).second) > 0 &&
+                   ScorePredecessor(i, best_j, best_score) == false) {
+                tree.Clear(leaf[best_j - group_begin]);
+                excluded.emplace_back(best_j);
+            }
+            for (const int32_t j : excluded) {
+                tree.Set(leaf[j - group_begin], TreeValue(j), j);
+            }
+            excluded.clear();
+            if (best_j > 0) {
+                UpdatePredecessor(best_j);
+            }
 
-        // int32_t qspan = chain.hits.back().queryPos - chain.hits.front().queryPos;
-        // double frac = (qspan == 0) ? 0 : ((double)chain.coveredBasesQuery) / ((double)qspan);
+            // The approximate penalty can miss a better close predecessor,
+            // so a small number of the nearest ones are evaluated exactly.
+            const int32_t min_j = std::max(next_remove, next_insert - maxInnerPredecessors);
+            for (int32_t j = (next_insert - 1); j >= min_j; j--) {
+                if (j != best_j) {
+                    UpdatePredecessor(j);
+                }
+            }
 
-        // Add the new chain.
-        if (chain.coveredBasesQuery >= minCovBases && chain.coveredBasesTarget >= minCovBases) {
-            chains.emplace_back(std::move(chain));
+            dp[i] = new_dp_val;
+            pred[i] = new_dp_pred;
+            chain_id[i] = new_dp_chain;
+            if (new_dp_chain == num_chains) {
+                num_chains += 1;
+            }
         }
-        /////////////////////////
-    }
 
-#ifdef DEBUG_DP_VERBOSE_
-    printf("The DP:\n");
-    for (int32_t i = 0; i < dp.size(); i++) {
-        printf("[%d] dp[i] = %d, pred[i] = %d, chain_id[i] = %d\n", i, dp[i], pred[i], chain_id[i]);
+        group_begin = group_end;
     }
-#endif
 
-    return chains;
+    return BacktrackChains(hits, dp, pred, chain_id, num_chains, minNumSeeds, minCovBases,
+                           minDPScore);
 }
 
 inline int32_t ComputeGap(const SeedHit& hitStart, const SeedHit& hitEnd)
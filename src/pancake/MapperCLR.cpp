@@ -4,6 +4,7 @@
 #include <pacbio/alignment/AlignmentTools.h>
 #include <pacbio/alignment/DiffCounts.h>
 #include <pacbio/alignment/SesDistanceBanded.h>
+#include <pacbio/pancake/AlignerBatchExecutor.h>
 #include <pacbio/pancake/AlignmentSeeded.h>
 #include <pacbio/pancake/MapperCLR.h>
 #include <pacbio/pancake/Minimizers.h>
@@ -30,11 +31,37 @@ namespace Pancake {
 // #define PANCAKE_WRITE_SCATTERPLOT
 // #define PANCAKE_MAP_CLR_DEBUG_ALIGN
 
-MapperCLR::MapperCLR(const MapperCLRSettings& settings)
+namespace {
+// The runtime of ChainHits depends on the density of the hits, so large sets of
+// hits are chained with the RMQ chaining instead.
+std::vector<ChainedHits> ChainHitsWithRMQThreshold(
+    const SeedHit* hits, int32_t hitsSize, int32_t chainMaxSkip, int32_t chainMaxPredecessors,
+    int32_t maxGap, int32_t chainBandwidth, int32_t minNumSeeds, int32_t minCoveredBases,
+    int32_t minDPScore, int32_t chainRMQMinHits, int32_t chainRMQMaxInnerPredecessors)
+{
+    if (chainRMQMinHits > 0 && hitsSize >= chainRMQMinHits) {
+        return ChainHitsRMQ(hits, hitsSize, chainRMQMaxInnerPredecessors, maxGap, chainBandwidth,
+                            minNumSeeds, minCoveredBases, minDPScore);
+    }
+    return ChainHits(hits, hitsSize, chainMaxSkip, chainMaxPredecessors, maxGap, chainBandwidth,
+                     minNumSeeds, minCoveredBases, minDPScore);
+}
+}  // namespace
+
+MapperCLR::MapperCLR(const MapperCLRSettings& settings) : MapperCLR(settings, nullptr) {}
+
+MapperCLR::MapperCLR(const MapperCLRSettings& settings, PacBio::Parallel::FireAndForget* alignPool)
     : settings_{settings}, alignerGlobal_(nullptr), alignerExt_(nullptr)
 {
     alignerGlobal_ = AlignerFactory(settings.alignerTypeGlobal, settings.alnParamsGlobal);
     alignerExt_ = AlignerFactory(settings.alignerTypeExt, settings.alnParamsExt);
+    if (settings.alignThreads > 1 && alignPool != nullptr) {
+        alignerGlobalParallel_ = std::make_shared<AlignerBatchExecutor>(
+            settings.alignerTypeGlobal, settings.alnParamsGlobal, settings.alignThreads, alignPool);
+    } else if (settings.alignThreads > 1) {
+        alignerGlobalParallel_ = std::make_shared<AlignerBatchExecutor>(
+            settings.alignerTypeGlobal, settings.alnParamsGlobal, settings.alignThreads);
+    }
 }
 
 MapperCLR::~MapperCLR() = default;
@@ -189,19 +216,14 @@ MapperCLRResult MapperCLR::Map(const std::vector<std::string>& targetSeqs,
         return {};
     }
 
-    // Collect seed hits.
+    // Collect seed hits, sorted by target, strand and diagonal.
     TicToc ttCollectHits;
     std::vector<SeedHit> hits;
-    index.CollectHits(&querySeeds[0], querySeeds.size(), queryLen, hits, freqCutoff);
+    index.CollectHitsIntoDiagonalBuckets(&querySeeds[0], querySeeds.size(), queryLen, hits,
+                                         freqCutoff, std::max(1, settings_.chainBandwidth),
+                                         diagonalBucketScratch_, settings_.maxQuerySeedOccurrences);
     ttCollectHits.Stop();
 
-    // Sort the seed hits.
-    TicToc ttSortHits;
-    std::sort(hits.begin(), hits.end(), [](const auto& a, const auto& b) {
-        return PackSeedHitWithDiagonalToTuple(a) < PackSeedHitWithDiagonalToTuple(b);
-    });
-    ttSortHits.Stop();
-
     // Group seed hits by diagonal.
     TicToc ttDiagonalGroup;
     auto groups = DiagonalGroup(hits, settings_.chainBandwidth, true);
@@ -212,7 +234,8 @@ MapperCLRResult MapperCLR::Map(const std::vector<std::string>& targetSeqs,
     std::vector<std::unique_ptr<ChainedRegion>> allChainedRegions = ChainAndMakeOverlap_(
         index, hits, groups, queryId, queryLen, settings_.chainMaxSkip,
         settings_.chainMaxPredecessors, settings_.maxGap, settings_.chainBandwidth,
-        settings_.minNumSeeds, settings_.minCoveredBases, settings_.minDPScore, settings_.useLIS);
+        settings_.minNumSeeds, settings_.minCoveredBases, settings_.minDPScore, settings_.useLIS,
+        settings_.chainRMQMinHits, settings_.chainRMQMaxInnerPredecessors);
     ttChain.Stop();
     DebugWriteChainedRegion(allChainedRegions, "1-chain-and-make-overlap", queryId, queryLen);
 
@@ -224,7 +247,8 @@ MapperCLRResult MapperCLR::Map(const std::vector<std::string>& targetSeqs,
     allChainedRegions =
         ReChainSeedHits_(allChainedRegions, index, queryId, queryLen, settings_.chainMaxSkip,
                          settings_.chainMaxPredecessors, settings_.maxGap, settings_.chainBandwidth,
-                         settings_.minNumSeeds, settings_.minCoveredBases, settings_.minDPScore);
+                         settings_.minNumSeeds, settings_.minCoveredBases, settings_.minDPScore,
+                         settings_.chainRMQMinHits, settings_.chainRMQMaxInnerPredecessors);
     ttRechain.Stop();
     DebugWriteChainedRegion(allChainedRegions, "2-rechain-hits", queryId, queryLen);
 
@@ -318,12 +342,21 @@ MapperCLRResult MapperCLR::Map(const std::vector<std::string>& targetSeqs,
             const auto& ovl = result.mappings[i]->mapping;
             const auto& tSeqFwd = targetSeqs[ovl->Bid];
 
+            // The internal regions of long mappings are aligned on multiple threads.
+            // The executor has its own aligners, so the results are the same either way.
+            AlignerBasePtr& alignerGlobal =
+                (alignerGlobalParallel_ != nullptr &&
+                 (ovl->Aend - ovl->Astart) >= settings_.alignParallelMinQuerySpan)
+                    ? alignerGlobalParallel_
+                    : alignerGlobal_;
+
             // Use a custom aligner to align.
             TicToc ttAlignmentSeeded;
-            auto newOvl =
-                AlignmentSeeded(ovl, chain.hits, tSeqFwd.c_str(), tSeqFwd.size(), &querySeq[0],
-                                &querySeqRev[0], queryLen, settings_.minAlignmentSpan,
-                                settings_.maxFlankExtensionDist, alignerGlobal_, alignerExt_);
+            auto newOvl = AlignmentSeeded(
+                ovl, chain.hits, tSeqFwd.c_str(), tSeqFwd.size(), &querySeq[0], &querySeqRev[0],
+                queryLen, settings_.minAlignmentSpan, settings_.maxFlankExtensionDist,
+                alignerGlobal, alignerExt_, settings_.alignFastPathMaxDiffs,
+                settings_.alnParamsGlobal, alignRegionsScratch_, regionAlignmentCounts_);
             ttAlignmentSeeded.Stop();
             std::swap(result.mappings[i]->mapping, newOvl);
 
@@ -441,7 +474,8 @@ std::vector<std::unique_ptr<ChainedRegion>> MapperCLR::ReChainSeedHits_(
     const std::vector<std::unique_ptr<ChainedRegion>>& chainedRegions,
     const PacBio::Pancake::SeedIndex& index, int32_t queryId, int32_t queryLen,
     int32_t chainMaxSkip, int32_t chainMaxPredecessors, int32_t maxGap, int32_t chainBandwidth,
-    int32_t minNumSeeds, int32_t minCoveredBases, int32_t minDPScore)
+    int32_t minNumSeeds, int32_t minCoveredBases, int32_t minDPScore, int32_t chainRMQMinHits,
+    int32_t chainRMQMaxInnerPredecessors)
 {
     std::vector<std::unique_ptr<ChainedRegion>> newChainedRegions;
 
@@ -466,9 +500,10 @@ std::vector<std::unique_ptr<ChainedRegion>> MapperCLR::ReChainSeedHits_(
 
     for (const auto& group : groups) {
         // DP Chaining of the filtered hits to remove outliers.
-        std::vector<ChainedHits> chains = ChainHits(
+        std::vector<ChainedHits> chains = ChainHitsWithRMQThreshold(
             &hits2[group.start], group.end - group.start, chainMaxSkip, chainMaxPredecessors,
-            maxGap, chainBandwidth, minNumSeeds, minCoveredBases, minDPScore);
+            maxGap, chainBandwidth, minNumSeeds, minCoveredBases, minDPScore, chainRMQMinHits,
+            chainRMQMaxInnerPredecessors);
 
         // Accumulate chains and their mapped regions.
         for (size_t i = 0; i < chains.size(); ++i) {
@@ -497,7 +532,8 @@ std::vector<std::unique_ptr<ChainedRegion>> MapperCLR::ChainAndMakeOverlap_(
     const PacBio::Pancake::SeedIndex& index, const std::vector<SeedHit>& hits,
     const std::vector<PacBio::Pancake::Range>& hitGroups, int32_t queryId, int32_t queryLen,
     int32_t chainMaxSkip, int32_t chainMaxPredecessors, int32_t maxGap, int32_t chainBandwidth,
-    int32_t minNumSeeds, int32_t minCoveredBases, int32_t minDPScore, bool useLIS)
+    int32_t minNumSeeds, int32_t minCoveredBases, int32_t minDPScore, bool useLIS,
+    int32_t chainRMQMinHits, int32_t chainRMQMaxInnerPredecessors)
 {
     // Comparison function to sort the seed hits for LIS.
     // IMPORTANT: This needs to sort by target, and if target coords are identical then by query.
@@ -544,8 +580,10 @@ std::vector<std::unique_ptr<ChainedRegion>> MapperCLR::ChainAndMakeOverlap_(
                 istl::LIS(groupHits, 0, groupHits.size(), ComparisonLIS);
 
             // DP Chaining of the filtered hits to remove outliers.
-            chains = ChainHits(&lisHits[0], lisHits.size(), chainMaxSkip, chainMaxPredecessors,
-                               maxGap, chainBandwidth, minNumSeeds, minCoveredBases, minDPScore);
+            chains = ChainHitsWithRMQThreshold(&lisHits[0], lisHits.size(), chainMaxSkip,
+                                               chainMaxPredecessors, maxGap, chainBandwidth,
+                                               minNumSeeds, minCoveredBases, minDPScore,
+                                               chainRMQMinHits, chainRMQMaxInnerPredecessors);
 
 #ifdef PANCAKE_MAP_CLR_DEBUG_2
             std::cerr << "  - Hits before LIS:\n";
@@ -560,8 +598,10 @@ std::vector<std::unique_ptr<ChainedRegion>> MapperCLR::ChainAndMakeOverlap_(
             }
 #endif
         } else {
-            chains = ChainHits(&groupHits[0], groupHits.size(), chainMaxSkip, chainMaxPredecessors,
-                               maxGap, chainBandwidth, minNumSeeds, minCoveredBases, minDPScore);
+            chains = ChainHitsWithRMQThreshold(&groupHits[0], groupHits.size(), chainMaxSkip,
+                                               chainMaxPredecessors, maxGap, chainBandwidth,
+                                               minNumSeeds, minCoveredBases, minDPScore,
+                                               chainRMQMinHits, chainRMQMaxInnerPredecessors);
 #ifdef PANCAKE_MAP_CLR_DEBUG_2
             std::cerr << "  - not using LIS.\n";
 #endif
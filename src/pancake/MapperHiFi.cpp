@@ -16,10 +16,12 @@
 #include <algorithm>
 #include <iostream>
 #include <lib/istl/lis.hpp>
+#include <numeric>
 #include <pacbio/alignment/Ses2AlignBanded.hpp>
 #include <pacbio/alignment/Ses2DistanceBanded.hpp>
 #include <pacbio/alignment/SesAlignBanded.hpp>
 #include <sstream>
+#include <tuple>
 
 namespace PacBio {
 namespace Pancake {
@@ -56,7 +58,7 @@ MapperResult Mapper::Map(const PacBio::Pancake::SeqDBReaderCachedBlock& targetSe
                          const PacBio::Pancake::SeedIndex& index,
                          const PacBio::Pancake::FastaSequenceCached& querySeq,
                          const PacBio::Pancake::SequenceSeedsCached& querySeeds, int64_t freqCutoff,
-                         bool generateFlippedOverlap) const
+                         bool generateFlippedOverlap, std::shared_ptr<MapperScratch> scratch) const
 {
 #ifdef PANCAKE_DEBUG
     PBLOG_INFO << "Mapping query ID = " << querySeq.Id() << ", header = " << querySeq.Name();
@@ -66,24 +68,33 @@ MapperResult Mapper::Map(const PacBio::Pancake::SeqDBReaderCachedBlock& targetSe
         return {};
     }
 
+    if (scratch == nullptr) {
+        scratch = scratch_;
+    }
+
     TicToc ttCollectHits;
-    std::vector<SeedHit> hits;
-    index.CollectHits(querySeeds.Seeds(), querySeeds.Size(), querySeq.Size(), hits, freqCutoff);
+    // Bound the number of hits for highly repetitive queries by lowering the
+    // frequency cutoff for this query only.
+    bool hitsCapped = false;
+    const int64_t queryFreqCutoff = index.ComputeQueryFreqCutoff(
+        querySeeds.Seeds(), querySeeds.Size(), freqCutoff, settings_.MaxSeedHitsPerQuery,
+        hitsCapped, settings_.MaxQuerySeedOccurrences);
+    // The hits are collected directly into diagonal buckets, which produces them
+    // already sorted by target, strand and diagonal.
+    auto& hits = scratch->hits;
+    const int32_t bucketWidth = std::max<int64_t>(1, settings_.ChainBandwidth);
+    index.CollectHitsIntoDiagonalBuckets(querySeeds.Seeds(), querySeeds.Size(), querySeq.Size(),
+                                         hits, queryFreqCutoff, bucketWidth, scratch->bucketScratch,
+                                         settings_.MaxQuerySeedOccurrences);
     ttCollectHits.Stop();
 
-    TicToc ttSortHits;
-    std::sort(hits.begin(), hits.end(), [](const auto& a, const auto& b) {
-        return PackSeedHitWithDiagonalToTuple(a) < PackSeedHitWithDiagonalToTuple(b);
-    });
-    ttSortHits.Stop();
-
     // PBLOG_INFO << "Hits: " << hits.size();
 
     TicToc ttChain;
     auto overlaps =
         FormAnchors2_(hits, querySeq, index, settings_.ChainBandwidth, settings_.MinNumSeeds,
                       settings_.MinChainSpan, index.GetSeedParams().KmerSize * 3,
-                      settings_.SkipSelfHits, settings_.SkipSymmetricOverlaps);
+                      settings_.SkipSelfHits, settings_.SkipSymmetricOverlaps, *scratch);
     ttChain.Stop();
 #ifdef PANCAKE_DEBUG
     PBLOG_INFO << "Formed diagonal anchors: " << overlaps.size();
@@ -100,8 +111,17 @@ MapperResult Mapper::Map(const PacBio::Pancake::SeqDBReaderCachedBlock& targetSe
     PBLOG_INFO << "Overlaps after tandem filtering: " << overlaps.size();
 #endif
 
-    const std::string reverseQuerySeq =
-        PacBio::Pancake::ReverseComplement(querySeq.Bases(), querySeq.Size(), 0, querySeq.Size());
+    auto& reverseQuerySeq = scratch->reverseQuerySeq;
+    PacBio::Pancake::ReverseComplement(querySeq.Bases(), querySeq.Size(), 0, querySeq.Size(),
+                                       reverseQuerySeq);
+
+    // Overlaps which cannot reach MinIdentity can be abandoned during alignment, because
+    // FilterOverlaps_ would remove them anyway. This is only exact when the identity is not
+    // recomputed from the traceback, and when secondary marking does not see all overlaps.
+    const float earlyTermMinIdentity =
+        (settings_.UseTraceback || settings_.MarkSecondary) ? 0.0f : settings_.MinIdentity;
+    int32_t numAlignmentsAborted = 0;
+    int32_t numReversePassesSkipped = 0;
 
     TicToc ttAlign;
     overlaps = AlignOverlaps_(
@@ -110,7 +130,7 @@ MapperResult Mapper::Map(const PacBio::Pancake::SeqDBReaderCachedBlock& targetSe
         settings_.NoIndelsInIdentity, settings_.MaskHomopolymers, settings_.MaskSimpleRepeats,
         settings_.MaskHomopolymerSNPs, settings_.MaskHomopolymersArbitrary, settings_.TrimAlignment,
         settings_.TrimWindowSize, settings_.TrimWindowMatchFraction, settings_.TrimToFirstMatch,
-        sesScratch_);
+        earlyTermMinIdentity, *scratch, numAlignmentsAborted, numReversePassesSkipped);
     ttAlign.Stop();
 
     TicToc ttMarkSecondary;
@@ -151,7 +171,7 @@ MapperResult Mapper::Map(const PacBio::Pancake::SeqDBReaderCachedBlock& targetSe
         std::vector<OverlapPtr> flippedOverlaps = GenerateFlippedOverlaps_(
             targetSeqs, querySeq, reverseQuerySeq, overlaps, settings_.NoSNPsInIdentity,
             settings_.NoIndelsInIdentity, settings_.MaskHomopolymers, settings_.MaskSimpleRepeats,
-            settings_.MaskHomopolymerSNPs, settings_.MaskHomopolymersArbitrary);
+            settings_.MaskHomopolymerSNPs, settings_.MaskHomopolymersArbitrary, *scratch);
         for (size_t i = 0; i < flippedOverlaps.size(); ++i) {
             overlaps.emplace_back(std::move(flippedOverlaps[i]));
         }
@@ -173,10 +193,8 @@ MapperResult Mapper::Map(const PacBio::Pancake::SeqDBReaderCachedBlock& targetSe
     }
     PBLOG_INFO << "Num anchors: " << overlaps.size();
     PBLOG_INFO << "Collected " << hits.size() << " hits.";
-    PBLOG_INFO << "Time - collecting hits: " << ttCollectHits.GetMillisecs() << " ms / "
+    PBLOG_INFO << "Time - collecting and sorting hits: " << ttCollectHits.GetMillisecs() << " ms / "
                << ttCollectHits.GetCpuMillisecs() << " CPU ms";
-    PBLOG_INFO << "Time - sorting: " << ttSortHits.GetMillisecs() << " ms / "
-               << ttSortHits.GetCpuMillisecs() << " CPU ms";
     PBLOG_INFO << "Time - chaining: " << ttChain.GetMillisecs() << " ms / "
                << ttChain.GetCpuMillisecs() << " CPU ms";
     PBLOG_INFO << "Time - tandem filter: " << ttFilterTandem.GetMillisecs() << " ms / "
@@ -191,6 +209,9 @@ MapperResult Mapper::Map(const PacBio::Pancake::SeqDBReaderCachedBlock& targetSe
 
     MapperResult result;
     std::swap(result.overlaps, overlaps);
+    result.hitsCapped = hitsCapped;
+    result.numAlignmentsAborted = numAlignmentsAborted;
+    result.numReversePassesSkipped = numReversePassesSkipped;
     return result;
 }
 
@@ -415,12 +436,63 @@ void RefineBadEnds(const std::vector<SeedHit>& chainedHits, int32_t beginId, int
     }
 }
 
+namespace {
+/*
+ * Orders the IDs of the hits in [beginId, endId) by (targetPos, queryPos, ID).
+ * The hits of a diagonal group are sorted by diagonal first, so each diagonal is
+ * already an ordered run. Only the runs are merged, pairwise, which is cheaper than
+ * sorting the whole group when the group spans few diagonals.
+*/
+void OrderGroupHitIds(const std::vector<SeedHit>& hits, int32_t beginId, int32_t endId,
+                      std::vector<int32_t>& retIds, std::vector<int32_t>& tmpIds,
+                      std::vector<int32_t>& runStarts)
+{
+    auto Less = [&hits](const int32_t a, const int32_t b) {
+        return std::make_tuple(hits[a].targetPos, hits[a].queryPos, a) <
+               std::make_tuple(hits[b].targetPos, hits[b].queryPos, b);
+    };
+
+    const int32_t n = endId - beginId;
+    retIds.resize(n);
+    std::iota(retIds.begin(), retIds.end(), beginId);
+
+    // Find the maximal ordered runs.
+    runStarts.clear();
+    runStarts.emplace_back(0);
+    for (int32_t i = 1; i < n; ++i) {
+        if (Less(retIds[i], retIds[i - 1])) {
+            runStarts.emplace_back(i);
+        }
+    }
+    runStarts.emplace_back(n);
+
+    // Merge the neighbouring runs until one run is left.
+    tmpIds.resize(n);
+    while (runStarts.size() > 2) {
+        const int32_t numRuns = runStarts.size() - 1;
+        int32_t numMerged = 0;
+        for (int32_t r = 0; r < numRuns; r += 2) {
+            const int32_t start = runStarts[r];
+            const int32_t mid = runStarts[r + 1];
+            const int32_t end = (r + 2) <= numRuns ? runStarts[r + 2] : mid;
+            std::merge(retIds.begin() + start, retIds.begin() + mid, retIds.begin() + mid,
+                       retIds.begin() + end, tmpIds.begin() + start, Less);
+            runStarts[numMerged++] = start;
+        }
+        runStarts[numMerged++] = n;
+        runStarts.resize(numMerged);
+        std::swap(retIds, tmpIds);
+    }
+}
+}  // namespace
+
 std::vector<OverlapPtr> Mapper::FormAnchors2_(const std::vector<SeedHit>& sortedHits,
                                               const PacBio::Pancake::FastaSequenceCached& querySeq,
                                               const PacBio::Pancake::SeedIndex& index,
                                               int32_t chainBandwidth, int32_t minNumSeeds,
                                               int32_t minChainSpan, int32_t minMatch,
-                                              bool skipSelfHits, bool skipSymmetricOverlaps)
+                                              bool skipSelfHits, bool skipSymmetricOverlaps,
+                                              MapperScratch& scratch)
 {
 #ifdef PANCAKE_DEBUG
     std::cerr << "[Function: " << __FUNCTION__ << "]\n";
@@ -430,31 +502,36 @@ std::vector<OverlapPtr> Mapper::FormAnchors2_(const std::vector<SeedHit>& sorted
         return {};
     }
 
-    auto WrapMakeOverlap = [](const std::vector<SeedHit>& _sortedHits, const int32_t beginId,
-                              const int32_t endId,
-                              const PacBio::Pancake::FastaSequenceCached& _querySeq,
-                              const PacBio::Pancake::SeedIndex& _index, int32_t _chainBandwidth,
-                              int32_t kmerSize, int32_t _minMatch) -> OverlapPtr {
+    auto WrapMakeOverlap = [&scratch](
+        const std::vector<SeedHit>& _sortedHits, const int32_t beginId, const int32_t endId,
+        const PacBio::Pancake::FastaSequenceCached& _querySeq,
+        const PacBio::Pancake::SeedIndex& _index, int32_t _chainBandwidth, int32_t kmerSize,
+        int32_t _minMatch) -> OverlapPtr {
         if (endId <= beginId) {
             return nullptr;
         }
 
-        static std::function<bool(const SeedHit& a, const SeedHit& b)> ComparisonLIS = [](
-            const SeedHit& a, const SeedHit& b) {
-            // This needs to always return the upper-left element as the smaller one.
-            return a.targetPos < b.targetPos && a.queryPos < b.queryPos;
-        };
-
-        // Extract the subset so we can sort it.
-        std::vector<SeedHit> groupHits(_sortedHits.begin() + beginId, _sortedHits.begin() + endId);
-
-        std::sort(groupHits.begin(), groupHits.end(), [](const SeedHit& a, const SeedHit& b) {
-            return std::pair(a.targetPos, a.queryPos) < std::pair(b.targetPos, b.queryPos);
-        });
+        // Order the hits of the group by coordinates. Only the IDs of the hits are
+        // ordered, so that the hits do not need to be copied.
+        auto& groupHitIds = scratch.groupHitIds;
+        OrderGroupHitIds(_sortedHits, beginId, endId, groupHitIds, scratch.groupHitIdsTmp,
+                         scratch.groupRunStarts);
 
         // Longest Increasing Subsequence of the diagonal bin.
-        std::vector<PacBio::Pancake::SeedHit> lisHits =
-            istl::LIS(groupHits, 0, groupHits.size(), ComparisonLIS);
+        auto ComparisonLIS = [&_sortedHits](const int32_t a, const int32_t b) {
+            // This needs to always return the upper-left element as the smaller one.
+            return _sortedHits[a].targetPos < _sortedHits[b].targetPos &&
+                   _sortedHits[a].queryPos < _sortedHits[b].queryPos;
+        };
+        auto& lisHitIds = scratch.lisHitIds;
+        istl::LIS(groupHitIds, 0, groupHitIds.size(), ComparisonLIS, scratch.lisDp, scratch.lisPred,
+                  lisHitIds);
+
+        auto& lisHits = scratch.lisHits;
+        lisHits.resize(lisHitIds.size());
+        for (size_t i = 0; i < lisHitIds.size(); ++i) {
+            lisHits[i] = _sortedHits[lisHitIds[i]];
+        }
 
         int32_t finalFirst = 0;
         int32_t finalLast = 0;
@@ -678,12 +755,13 @@ std::vector<OverlapPtr> Mapper::FilterTandemOverlaps_(const std::vector<OverlapP
 
 std::vector<OverlapPtr> Mapper::AlignOverlaps_(
     const PacBio::Pancake::SeqDBReaderCachedBlock& targetSeqs,
-    const PacBio::Pancake::FastaSequenceCached& querySeq, const std::string reverseQuerySeq,
+    const PacBio::Pancake::FastaSequenceCached& querySeq, const std::string& reverseQuerySeq,
     const std::vector<OverlapPtr>& overlaps, double alignBandwidth, double alignMaxDiff,
     bool useTraceback, bool noSNPs, bool noIndels, bool maskHomopolymers, bool maskSimpleRepeats,
     bool maskHomopolymerSNPs, bool maskHomopolymersArbitrary, bool trimAlignment,
     int32_t trimWindowSize, double trimMatchFraction, bool trimToFirstMatch,
-    std::shared_ptr<PacBio::Pancake::Alignment::SESScratchSpace> sesScratch)
+    float earlyTermMinIdentity, MapperScratch& scratch, int32_t& retNumAborted,
+    int32_t& retNumReverseSkipped)
 {
     std::vector<OverlapPtr> ret;
 
@@ -693,11 +771,17 @@ std::vector<OverlapPtr> Mapper::AlignOverlaps_(
                    << OverlapWriterBase::PrintOverlapAsM4(overlaps[i], "", "", true, false);
 #endif
         const auto& targetSeq = targetSeqs.GetSequence(overlaps[i]->Bid);
+        const char* targetSeqRevCmp = targetSeqs.GetReverseComplement(overlaps[i]->Bid);
+        bool reverseSkipped = false;
         OverlapPtr newOverlap = AlignOverlap_(
-            targetSeq, querySeq, reverseQuerySeq, overlaps[i], alignBandwidth, alignMaxDiff,
-            useTraceback, noSNPs, noIndels, maskHomopolymers, maskSimpleRepeats,
+            targetSeq, targetSeqRevCmp, querySeq, reverseQuerySeq, overlaps[i], alignBandwidth,
+            alignMaxDiff, useTraceback, noSNPs, noIndels, maskHomopolymers, maskSimpleRepeats,
             maskHomopolymerSNPs, maskHomopolymersArbitrary, trimAlignment, trimWindowSize,
-            trimMatchFraction, trimToFirstMatch, sesScratch);
+            trimMatchFraction, trimToFirstMatch, earlyTermMinIdentity, scratch, reverseSkipped);
+        if (newOverlap == nullptr && overlaps[i] != nullptr) {
+            ++retNumAborted;
+            retNumReverseSkipped += reverseSkipped;
+        }
         if (newOverlap != nullptr) {
             ret.emplace_back(std::move(newOverlap));
 #ifdef PANCAKE_DEBUG_ALN
@@ -716,20 +800,23 @@ std::vector<OverlapPtr> Mapper::AlignOverlaps_(
 
 std::vector<OverlapPtr> Mapper::GenerateFlippedOverlaps_(
     const PacBio::Pancake::SeqDBReaderCachedBlock& targetSeqs,
-    const PacBio::Pancake::FastaSequenceCached& querySeq, const std::string reverseQuerySeq,
+    const PacBio::Pancake::FastaSequenceCached& querySeq, const std::string& reverseQuerySeq,
     const std::vector<OverlapPtr>& overlaps, bool noSNPs, bool noIndels, bool maskHomopolymers,
-    bool maskSimpleRepeats, bool maskHomopolymerSNPs, bool maskHomopolymersArbitrary)
+    bool maskSimpleRepeats, bool maskHomopolymerSNPs, bool maskHomopolymersArbitrary,
+    MapperScratch& scratch)
 {
     std::vector<OverlapPtr> ret;
 
     for (size_t i = 0; i < overlaps.size(); ++i) {
         const auto& targetSeq = targetSeqs.GetSequence(overlaps[i]->Bid);
+        const char* targetSeqRevCmp = targetSeqs.GetReverseComplement(overlaps[i]->Bid);
         const auto& ovl = overlaps[i];
 
         OverlapPtr newOverlapFlipped = CreateFlippedOverlap(ovl);
-        NormalizeAndExtractVariantsInPlace_(newOverlapFlipped, targetSeq, querySeq, reverseQuerySeq,
-                                            noSNPs, noIndels, maskHomopolymers, maskSimpleRepeats,
-                                            maskHomopolymerSNPs, maskHomopolymersArbitrary);
+        NormalizeAndExtractVariantsInPlace_(newOverlapFlipped, targetSeq, targetSeqRevCmp, querySeq,
+                                            reverseQuerySeq, noSNPs, noIndels, maskHomopolymers,
+                                            maskSimpleRepeats, maskHomopolymerSNPs,
+                                            maskHomopolymersArbitrary, scratch.targetSubseq);
 
         if (newOverlapFlipped == nullptr) {
             throw std::runtime_error(
@@ -743,17 +830,19 @@ std::vector<OverlapPtr> Mapper::GenerateFlippedOverlaps_(
     return ret;
 }
 
-std::string Mapper::FetchTargetSubsequence_(const PacBio::Pancake::FastaSequenceCached& targetSeq,
-                                            int32_t seqStart, int32_t seqEnd, bool revCmp)
+void Mapper::FetchTargetSubsequence_(const PacBio::Pancake::FastaSequenceCached& targetSeq,
+                                     int32_t seqStart, int32_t seqEnd, bool revCmp,
+                                     std::string& retSeq)
 {
-    return FetchTargetSubsequence_(targetSeq.Bases(), targetSeq.Size(), seqStart, seqEnd, revCmp);
+    FetchTargetSubsequence_(targetSeq.Bases(), targetSeq.Size(), seqStart, seqEnd, revCmp, retSeq);
 }
 
-std::string Mapper::FetchTargetSubsequence_(const char* seq, int32_t seqLen, int32_t seqStart,
-                                            int32_t seqEnd, bool revCmp)
+void Mapper::FetchTargetSubsequence_(const char* seq, int32_t seqLen, int32_t seqStart,
+                                     int32_t seqEnd, bool revCmp, std::string& retSeq)
 {
+    retSeq.clear();
     if (seqEnd == seqStart) {
-        return {};
+        return;
     }
     if (seqStart < 0 || seqEnd < 0 || seqStart > seqLen || seqEnd > seqLen || seqEnd < seqStart) {
         std::ostringstream oss;
@@ -764,27 +853,79 @@ std::string Mapper::FetchTargetSubsequence_(const char* seq, int32_t seqLen, int
         throw std::runtime_error(oss.str());
     }
     seqEnd = (seqEnd == 0) ? seqLen : seqEnd;
-    std::string ret(seq + seqStart, seqEnd - seqStart);
     if (revCmp) {
-        ret = PacBio::Pancake::ReverseComplement(ret, 0, ret.size());
+        PacBio::Pancake::ReverseComplement(seq, seqLen, seqStart, seqEnd, retSeq);
+    } else {
+        retSeq.assign(seq + seqStart, seqEnd - seqStart);
     }
-    return ret;
+}
+
+std::pair<const char*, int32_t> Mapper::FetchTargetWindow_(const char* seq, const char* seqRevCmp,
+                                                           int32_t seqLen, int32_t seqStart,
+                                                           int32_t seqEnd, bool revCmp,
+                                                           std::string& buffer)
+{
+    if (revCmp && seqRevCmp == nullptr) {
+        FetchTargetSubsequence_(seq, seqLen, seqStart, seqEnd, revCmp, buffer);
+        return {buffer.c_str(), static_cast<int32_t>(buffer.size())};
+    }
+    if (seqStart < 0 || seqEnd < 0 || seqStart > seqLen || seqEnd > seqLen || seqEnd < seqStart) {
+        std::ostringstream oss;
+        oss << "Invalid seqStart or seqEnd in a call to FetchTargetWindow_. seqStart = " << seqStart
+            << ", seqEnd = " << seqEnd << ", seqLen = " << seqLen << ", revCmp = " << revCmp << ".";
+        throw std::runtime_error(oss.str());
+    }
+    if (revCmp) {
+        // The window [seqStart, seqEnd) on the forward strand begins at (seqLen - seqEnd)
+        // in the reverse complement.
+        return {seqRevCmp + (seqLen - seqEnd), seqEnd - seqStart};
+    }
+    return {seq + seqStart, seqEnd - seqStart};
+}
+
+int32_t Mapper::IdentityDiffBudget_(int32_t span, float minIdentity)
+{
+    // Uses the same float arithmetic as the identity computation in AlignOverlap_
+    // and the check in FilterOverlaps_, so that the budget is exact.
+    auto Passes = [span, minIdentity](int32_t diffs) {
+        const float spanF = span;
+        const float identity =
+            ((spanF != 0.0f) ? ((spanF - static_cast<float>(diffs)) / spanF) : -0.0f);
+        return !(100 * identity < minIdentity);
+    };
+    int32_t budget = static_cast<int32_t>(span * (1.0 - minIdentity / 100.0));
+    budget = std::max(-1, std::min(span, budget));
+    while (budget >= 0 && !Passes(budget)) {
+        --budget;
+    }
+    while (budget < span && Passes(budget + 1)) {
+        ++budget;
+    }
+    return budget;
 }
 
 OverlapPtr Mapper::AlignOverlap_(
-    const PacBio::Pancake::FastaSequenceCached& targetSeq,
-    const PacBio::Pancake::FastaSequenceCached& querySeq, const std::string reverseQuerySeq,
+    const PacBio::Pancake::FastaSequenceCached& targetSeq, const char* targetSeqRevCmp,
+    const PacBio::Pancake::FastaSequenceCached& querySeq, const std::string& reverseQuerySeq,
     const OverlapPtr& ovl, double alignBandwidth, double alignMaxDiff, bool useTraceback,
     bool noSNPs, bool noIndels, bool maskHomopolymers, bool maskSimpleRepeats,
     bool maskHomopolymerSNPs, bool maskHomopolymersArbitrary, bool trimAlignment,
     int32_t trimWindowSize, double trimMatchFraction, bool trimToFirstMatch,
-    std::shared_ptr<PacBio::Pancake::Alignment::SESScratchSpace> sesScratch)
+    float earlyTermMinIdentity, MapperScratch& scratch, bool& retReverseSkipped)
 {
+    retReverseSkipped = false;
 
     if (ovl == nullptr) {
         return nullptr;
     }
 
+    // The final identity is (span - diffs) / span, where span is the larger of the query
+    // and target spans. The pass limits are lowered to the number of diffs which could
+    // still pass the identity filter, but never below the bandwidth, so that the alignments
+    // which stay within the limit are identical. If a pass runs out of the lowered limit,
+    // the overlap would have failed the filter with the original limit as well.
+    const bool earlyTerm = earlyTermMinIdentity > 0.0f;
+
 #ifdef PANCAKE_DEBUG_ALN
     PBLOG_INFO << "Initial: " << OverlapWriterBase::PrintOverlapAsM4(ovl, "", "", true, false);
 #endif
@@ -802,7 +943,7 @@ OverlapPtr Mapper::AlignOverlap_(
         const int32_t qSpan = qEnd - qStart;
         const int32_t tStartFwd = ovl->Brev ? (ovl->Blen - ovl->Bend) : ovl->Bstart;
         const int32_t tEndFwd = ovl->Brev ? (ovl->Blen - ovl->Bstart) : ovl->Bend;
-        std::string tseq;
+        std::pair<const char*, int32_t> tseq;
         if (ovl->Brev) {
             // Extract reverse complemented target sequence.
             // The reverse complement begins at the last mapped position (tEndFwd),
@@ -814,7 +955,8 @@ OverlapPtr Mapper::AlignOverlap_(
             int32_t minHangLen = std::min(ovl->Alen - ovl->Aend, tStartFwd);
             int32_t extractBegin = std::max(0, tStartFwd - minHangLen * 2);
             int32_t extractEnd = tEndFwd;
-            tseq = FetchTargetSubsequence_(targetSeq, extractBegin, extractEnd, ovl->Brev);
+            tseq = FetchTargetWindow_(targetSeq.Bases(), targetSeqRevCmp, targetSeq.Size(),
+                                      extractBegin, extractEnd, ovl->Brev, scratch.targetSubseq);
         } else {
             // Take the sequence starting from the start position, and reaching
             // until the end of the query (or target, which ever is the shorter).
@@ -823,21 +965,27 @@ OverlapPtr Mapper::AlignOverlap_(
             int32_t minHangLen = std::min(ovl->Blen - tEndFwd, ovl->Alen - ovl->Aend);
             int32_t extractBegin = tStartFwd;
             int32_t extractEnd = std::min(ovl->Blen, tEndFwd + minHangLen * 2);
-            tseq = FetchTargetSubsequence_(targetSeq, extractBegin, extractEnd, ovl->Brev);
+            tseq = FetchTargetWindow_(targetSeq.Bases(), targetSeqRevCmp, targetSeq.Size(),
+                                      extractBegin, extractEnd, ovl->Brev, scratch.targetSubseq);
         }
-        const int32_t tSpan = tseq.size();
-        const int32_t dMax =
+        const int32_t tSpan = tseq.second;
+        const int32_t dMaxFull =
             std::max(MIN_DIFFS_CAP, static_cast<int32_t>(ovl->Alen * alignMaxDiff));
         const int32_t bandwidth =
             std::max(MIN_BANDWIDTH_CAP,
                      static_cast<int32_t>(std::min(ovl->Blen, ovl->Alen) * alignBandwidth));
+        // The overlap cannot span more than the longer of the two sequences.
+        const int32_t budget =
+            IdentityDiffBudget_(std::max(ovl->Alen, ovl->Blen), earlyTermMinIdentity);
+        const int32_t dMax =
+            earlyTerm ? std::min(dMaxFull, std::max(bandwidth + 1, budget + 1)) : dMaxFull;
 
         if (useTraceback) {
-            sesResultRight = AlignWithTraceback(querySeq.Bases() + qStart, qSpan, tseq.c_str(),
-                                                tSpan, dMax, bandwidth, sesScratch);
+            sesResultRight = AlignWithTraceback(querySeq.Bases() + qStart, qSpan, tseq.first, tSpan,
+                                                dMax, bandwidth, scratch.sesScratch);
         } else {
-            sesResultRight = AlignNoTraceback(querySeq.Bases() + qStart, qSpan, tseq.c_str(), tSpan,
-                                              dMax, bandwidth, sesScratch);
+            sesResultRight = AlignNoTraceback(querySeq.Bases() + qStart, qSpan, tseq.first, tSpan,
+                                              dMax, bandwidth, scratch.sesScratch);
         }
 
         ret->Aend = sesResultRight.lastQueryPos;
@@ -847,6 +995,16 @@ OverlapPtr Mapper::AlignOverlap_(
         ret->EditDistance = sesResultRight.numDiffs;
         ret->Score = -(std::min(ret->ASpan(), ret->BSpan()) - ret->EditDistance);
 
+        // The reverse pass can only add diffs, and the final span is at most the
+        // current end coordinates.
+        if (earlyTerm &&
+            ((!sesResultRight.valid && dMax < dMaxFull) ||
+             sesResultRight.numDiffs >
+                 IdentityDiffBudget_(std::max(ret->Aend, ret->Bend), earlyTermMinIdentity))) {
+            retReverseSkipped = true;
+            return nullptr;
+        }
+
 #ifdef PANCAKE_DEBUG_ALN
         PBLOG_INFO << "dMax = " << dMax << ", bandwidth = " << bandwidth;
         PBLOG_INFO << "Right: diffs = " << sesResultRight.numDiffs;
@@ -865,31 +1023,43 @@ OverlapPtr Mapper::AlignOverlap_(
         const int32_t qSpan = qEnd - qStart;
         const int32_t tStartFwd = ret->Brev ? (ret->Blen - ret->Bend) : ret->Bstart;
         const int32_t tEndFwd = ret->Brev ? (ret->Blen - ret->Bstart) : ret->Bend;
-        std::string tseq;
+        std::pair<const char*, int32_t> tseq;
         if (ovl->Brev) {
             int32_t minHangLen = std::min(ovl->Blen - tEndFwd, qStart);
             int32_t extractBegin = tEndFwd;
             int32_t extractEnd = std::min(ret->Blen, tEndFwd + minHangLen * 2);
-            tseq = FetchTargetSubsequence_(targetSeq, extractBegin, extractEnd, !ret->Brev);
+            tseq = FetchTargetWindow_(targetSeq.Bases(), targetSeqRevCmp, targetSeq.Size(),
+                                      extractBegin, extractEnd, !ret->Brev, scratch.targetSubseq);
         } else {
             int32_t minHangLen = std::min(ovl->Astart, tStartFwd);
             int32_t extractBegin = std::max(0, tStartFwd - minHangLen * 2);
             int32_t extractEnd = tStartFwd;
-            tseq = FetchTargetSubsequence_(targetSeq, extractBegin, extractEnd, !ret->Brev);
+            tseq = FetchTargetWindow_(targetSeq.Bases(), targetSeqRevCmp, targetSeq.Size(),
+                                      extractBegin, extractEnd, !ret->Brev, scratch.targetSubseq);
         }
-        const int32_t tSpan = tseq.size();
-        const int32_t dMax = std::max(MIN_DIFFS_CAP, static_cast<int32_t>(ovl->Alen * alignMaxDiff -
-                                                                          sesResultRight.numDiffs));
+        const int32_t tSpan = tseq.second;
+        const int32_t dMaxFull =
+            std::max(MIN_DIFFS_CAP,
+                     static_cast<int32_t>(ovl->Alen * alignMaxDiff - sesResultRight.numDiffs));
         const int32_t bandwidth =
             std::max(MIN_BANDWIDTH_CAP,
                      static_cast<int32_t>(std::min(ovl->Blen, ovl->Alen) * alignBandwidth));
+        const int32_t budget =
+            IdentityDiffBudget_(std::max(ret->Aend, ret->Bend), earlyTermMinIdentity) -
+            sesResultRight.numDiffs;
+        const int32_t dMax =
+            earlyTerm ? std::min(dMaxFull, std::max(bandwidth + 1, budget + 1)) : dMaxFull;
 
         if (useTraceback) {
-            sesResultLeft = AlignWithTraceback(reverseQuerySeq.c_str() + qStart, qSpan,
-                                               tseq.c_str(), tSpan, dMax, bandwidth, sesScratch);
+            sesResultLeft = AlignWithTraceback(reverseQuerySeq.c_str() + qStart, qSpan, tseq.first,
+                                               tSpan, dMax, bandwidth, scratch.sesScratch);
         } else {
-            sesResultLeft = AlignNoTraceback(reverseQuerySeq.c_str() + qStart, qSpan, tseq.c_str(),
-                                             tSpan, dMax, bandwidth, sesScratch);
+            sesResultLeft = AlignNoTraceback(reverseQuerySeq.c_str() + qStart, qSpan, tseq.first,
+                                             tSpan, dMax, bandwidth, scratch.sesScratch);
+        }
+
+        if (earlyTerm && !sesResultLeft.valid && dMax < dMaxFull) {
+            return nullptr;
         }
 
         ret->Astart = ovl->Astart - sesResultLeft.lastQueryPos;
@@ -934,9 +1104,10 @@ OverlapPtr Mapper::AlignOverlap_(
         std::swap(ret->Cigar, newCigar);
     }
 
-    NormalizeAndExtractVariantsInPlace_(ret, targetSeq, querySeq, reverseQuerySeq, noSNPs, noIndels,
-                                        maskHomopolymers, maskSimpleRepeats, maskHomopolymerSNPs,
-                                        maskHomopolymersArbitrary);
+    NormalizeAndExtractVariantsInPlace_(ret, targetSeq, targetSeqRevCmp, querySeq, reverseQuerySeq,
+                                        noSNPs, noIndels, maskHomopolymers, maskSimpleRepeats,
+                                        maskHomopolymerSNPs, maskHomopolymersArbitrary,
+                                        scratch.targetSubseq);
 
 #ifdef PANCAKE_DEBUG_ALN
     PBLOG_INFO << "Final: " << OverlapWriterBase::PrintOverlapAsM4(ret, "", "", true, false);
@@ -947,9 +1118,10 @@ OverlapPtr Mapper::AlignOverlap_(
 
 void Mapper::NormalizeAndExtractVariantsInPlace_(
     OverlapPtr& ovl, const PacBio::Pancake::FastaSequenceCached& targetSeq,
-    const PacBio::Pancake::FastaSequenceCached& querySeq, const std::string /*reverseQuerySeq*/,
-    bool noSNPs, bool noIndels, bool maskHomopolymers, bool maskSimpleRepeats,
-    bool maskHomopolymerSNPs, bool maskHomopolymersArbitrary)
+    const char* targetSeqRevCmp, const PacBio::Pancake::FastaSequenceCached& querySeq,
+    const std::string& reverseQuerySeq, bool noSNPs, bool noIndels, bool maskHomopolymers,
+    bool maskSimpleRepeats, bool maskHomopolymerSNPs, bool maskHomopolymersArbitrary,
+    std::string& targetSubseq)
 {
     // Extract the variant strings.
     if (ovl->Cigar.empty()) {
@@ -958,11 +1130,13 @@ void Mapper::NormalizeAndExtractVariantsInPlace_(
 
     const char* Aseq = querySeq.Bases();
     const char* Bseq = targetSeq.Bases();
+    const char* BseqRevCmp = targetSeqRevCmp;
     int32_t Blen = targetSeq.Size();
 
     if (ovl->IsFlipped) {
         Aseq = targetSeq.Bases();
         Bseq = querySeq.Bases();
+        BseqRevCmp = reverseQuerySeq.c_str();
         Blen = querySeq.Size();
     }
 
@@ -972,12 +1146,13 @@ void Mapper::NormalizeAndExtractVariantsInPlace_(
     PacBio::Pancake::Alignment::DiffCounts diffsPerBase;
     PacBio::Pancake::Alignment::DiffCounts diffsPerEvent;
 
-    auto tseq = FetchTargetSubsequence_(Bseq, Blen, ovl->BstartFwd(), ovl->BendFwd(), ovl->Brev);
+    const std::pair<const char*, int32_t> tseq = FetchTargetWindow_(
+        Bseq, BseqRevCmp, Blen, ovl->BstartFwd(), ovl->BendFwd(), ovl->Brev, targetSubseq);
 
     const char* querySub = Aseq + ovl->Astart;
     int32_t querySubLen = ovl->ASpan();
-    const char* targetSub = tseq.c_str();
-    int32_t targetSubLen = tseq.size();
+    const char* targetSub = tseq.first;
+    int32_t targetSubLen = tseq.second;
     auto& cigar = ovl->Cigar;
 
     // If the B-read is reversed, then we need to reverse and left-align the CIGAR string
@@ -1007,7 +1182,7 @@ void Mapper::NormalizeAndExtractVariantsInPlace_(
 
 // void NormalizeAndExtractVariantsInPlaceDeprecated_(
 //     OverlapPtr& ovl, const PacBio::Pancake::FastaSequenceCached& targetSeq,
-//     const PacBio::Pancake::FastaSequenceCached& querySeq, const std::string reverseQuerySeq,
+//     const PacBio::Pancake::FastaSequenceCached& querySeq, const std::string& reverseQuerySeq,
 //     bool noSNPs, bool noIndels, bool maskHomopolymers, bool maskSimpleRepeats)
 // {
 //     // Extract the variant strings.
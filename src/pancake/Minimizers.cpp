@@ -12,6 +12,7 @@
 #include <pacbio/pancake/Minimizers.h>
 #include <pacbio/pancake/Seed.h>
 #include <pacbio/util/CommonTypes.h>
+#include <algorithm>
 #include <deque>
 #include <iostream>
 
@@ -327,6 +328,185 @@ void GenerateMinimizers(std::vector<PacBio::Pancake::Int128t>& retSeeds,
     }
 }
 
+namespace {
+// Expects the <key, ordinal> pairs of the query seeds sorted by key and then by
+// ordinal, and marks the ordinals of the kept occurrences of every key.
+void MarkSubsampledQuerySeeds(const std::vector<std::pair<int64_t, int64_t>>& sortedQuery,
+                              const int32_t maxOccurrences, std::vector<uint8_t>& retKeep)
+{
+    const int64_t n = sortedQuery.size();
+    retKeep.assign(n, 1);
+    int64_t groupStart = 0;
+    while (groupStart < n) {
+        int64_t groupEnd = groupStart + 1;
+        while (groupEnd < n && sortedQuery[groupEnd].first == sortedQuery[groupStart].first) {
+            ++groupEnd;
+        }
+        const int64_t count = groupEnd - groupStart;
+        if (count > maxOccurrences) {
+            // Keep the j-th occurrence only when floor(j * maxOccurrences / count) changes,
+            // which keeps exactly maxOccurrences evenly spaced occurrences.
+            for (int64_t j = 1; j < count; ++j) {
+                const int64_t prevBin = ((j - 1) * maxOccurrences) / count;
+                const int64_t currBin = (j * maxOccurrences) / count;
+                if (currBin == prevBin) {
+                    retKeep[sortedQuery[groupStart + j].second] = 0;
+                }
+            }
+        }
+        groupStart = groupEnd;
+    }
+}
+}  // namespace
+
+void SubsampleRepetitiveQuerySeeds(std::vector<uint8_t>& retKeep,
+                                   const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                                   const int64_t querySeedsSize, const int32_t maxOccurrences)
+{
+    std::vector<std::pair<int64_t, int64_t>> sortedQuery;
+    SubsampleRepetitiveQuerySeeds(retKeep, sortedQuery, querySeeds, querySeedsSize, maxOccurrences);
+}
+
+void SubsampleRepetitiveQuerySeeds(std::vector<uint8_t>& retKeep,
+                                   std::vector<std::pair<int64_t, int64_t>>& sortedQuery,
+                                   const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                                   const int64_t querySeedsSize, const int32_t maxOccurrences)
+{
+    retKeep.assign(std::max<int64_t>(0, querySeedsSize), 1);
+    if (maxOccurrences <= 0 || querySeedsSize <= 0) {
+        return;
+    }
+    sortedQuery.resize(querySeedsSize);
+    for (int64_t i = 0; i < querySeedsSize; ++i) {
+        const uint64_t key = PacBio::Pancake::SeedDB::Seed(querySeeds[i]).key;
+        sortedQuery[i] = std::make_pair(static_cast<int64_t>(key), i);
+    }
+    std::sort(sortedQuery.begin(), sortedQuery.end());
+    MarkSubsampledQuerySeeds(sortedQuery, maxOccurrences, retKeep);
+}
+
+void FindSeedRangesMergeJoin(std::vector<std::pair<int64_t, int64_t>>& retRanges,
+                             std::vector<uint8_t>& retKeep,
+                             std::vector<std::pair<int64_t, int64_t>>& sortedQuery,
+                             const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                             const int64_t querySeedsSize,
+                             const PacBio::Pancake::SeedDB::SeedRaw* targetSeeds,
+                             const int64_t targetSeedsSize, const int32_t maxQueryKeyOccurrences)
+{
+    retRanges.assign(std::max<int64_t>(0, querySeedsSize), std::make_pair(0, 0));
+    retKeep.clear();
+
+    if (querySeedsSize <= 0 || targetSeedsSize <= 0) {
+        return;
+    }
+
+    // The target seeds are radix sorted as signed 128-bit integers, so the keys
+    // need to be compared as signed values to follow the same ordering.
+    auto TargetKey = [&](int64_t pos) -> int64_t {
+        return static_cast<int64_t>(PacBio::Pancake::SeedDB::Seed::DecodeKey(targetSeeds[pos]));
+    };
+
+    // Returns the first position at or after `from` with the target key >= key (or > key,
+    // if inclusive). Exponential steps first, then a binary search within the last step.
+    auto Gallop = [&](int64_t from, int64_t key, bool inclusive) -> int64_t {
+        auto Before = [&](int64_t pos) {
+            const int64_t targetKey = TargetKey(pos);
+            return inclusive ? (targetKey <= key) : (targetKey < key);
+        };
+        int64_t low = from;
+        int64_t high = from;
+        int64_t step = 1;
+        while (high < targetSeedsSize && Before(high)) {
+            low = high + 1;
+            high += step;
+            step <<= 1;
+        }
+        high = std::min(high, targetSeedsSize);
+        while (low < high) {
+            const int64_t mid = low + (high - low) / 2;
+            if (Before(mid)) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        return low;
+    };
+
+    // Sort the query keys, but keep the original ordinal so that the hits
+    // can be reported in the query order.
+    sortedQuery.resize(querySeedsSize);
+    for (int64_t i = 0; i < querySeedsSize; ++i) {
+        // Same key as used for the hash lookup in CollectSeedHits.
+        const uint64_t key = PacBio::Pancake::SeedDB::Seed::SignExtendKey(
+            PacBio::Pancake::SeedDB::Seed(querySeeds[i]).key);
+        sortedQuery[i] = std::make_pair(static_cast<int64_t>(key), i);
+    }
+    std::sort(sortedQuery.begin(), sortedQuery.end());
+
+    // Collapse the keys which repeat many times within the query.
+    if (maxQueryKeyOccurrences > 0) {
+        MarkSubsampledQuerySeeds(sortedQuery, maxQueryKeyOccurrences, retKeep);
+    }
+
+    // Merge-join: for every query seed find the range of target seeds with the same key.
+    int64_t targetPos = 0;
+    for (int64_t i = 0; i < querySeedsSize; ++i) {
+        const int64_t key = sortedQuery[i].first;
+        const int64_t ordinal = sortedQuery[i].second;
+        if (i > 0 && key == sortedQuery[i - 1].first) {
+            retRanges[ordinal] = retRanges[sortedQuery[i - 1].second];
+            continue;
+        }
+        if (targetPos >= targetSeedsSize) {
+            continue;
+        }
+        const int64_t start = Gallop(targetPos, key, false);
+        const int64_t end = Gallop(start, key, true);
+        retRanges[ordinal] = std::make_pair(start, end);
+        targetPos = end;
+    }
+}
+
+bool CollectSeedHitsMergeJoin(std::vector<SeedHit>& hits,
+                              const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                              const int64_t querySeedsSize, const int32_t /*queryLen*/,
+                              const PacBio::Pancake::SeedDB::SeedRaw* targetSeeds,
+                              const int64_t targetSeedsSize,
+                              const std::vector<int32_t>& targetLengths, const int32_t /*kmerSize*/,
+                              const int32_t /*spacing*/, const int64_t freqCutoff,
+                              const int32_t maxQueryKeyOccurrences)
+{
+    hits.clear();
+
+    if (querySeedsSize <= 0 || targetSeedsSize <= 0) {
+        return false;
+    }
+
+    std::vector<std::pair<int64_t, int64_t>> ranges;
+    std::vector<uint8_t> keep;
+    std::vector<std::pair<int64_t, int64_t>> sortedQuery;
+    FindSeedRangesMergeJoin(ranges, keep, sortedQuery, querySeeds, querySeedsSize, targetSeeds,
+                            targetSeedsSize, maxQueryKeyOccurrences);
+
+    // Construct the hits in the order of query seeds.
+    for (int64_t seedId = 0; seedId < querySeedsSize; ++seedId) {
+        if (keep.empty() == false && keep[seedId] == 0) {
+            continue;
+        }
+        const int64_t start = ranges[seedId].first;
+        const int64_t end = ranges[seedId].second;
+        // Skip missing and very frequent seeds.
+        if (start == end || (freqCutoff > 0 && (end - start) > freqCutoff)) {
+            continue;
+        }
+        const auto decodedQuery = PacBio::Pancake::SeedDB::Seed(querySeeds[seedId]);
+        AppendSeedHits(hits, decodedQuery, targetSeeds, start, end, targetLengths);
+    }
+
+    return hits.size() > 0;
+}
+
 }  // namespace SeedDB
 }  // namespace Pancake
 }  // namespace PacBio
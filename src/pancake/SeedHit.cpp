@@ -1,6 +1,9 @@
 // Authors: Ivan Sovic
 
+#include <lib/kxsort/kxsort.h>
 #include <pacbio/pancake/SeedHit.h>
+#include <algorithm>
+#include <limits>
 #include <sstream>
 
 namespace PacBio {
@@ -44,5 +47,54 @@ void CalcHitCoverage(const std::vector<SeedHit>& hits, int32_t hitsBegin, int32_
     }
 }
 
+namespace {
+// Flips the sign bit, so that the unsigned ordering of the result matches
+// the signed ordering of the input.
+inline UInt128t SignedToOrderedUnsigned(int32_t val)
+{
+    return static_cast<uint32_t>(val) ^ 0x80000000U;
+}
+}  // namespace
+
+void SortSeedHitsByDiagonal(std::vector<SeedHit>& hits)
+{
+    std::vector<UInt128t> keysBuffer;
+    std::vector<SeedHit> hitsBuffer;
+    SortSeedHitsByDiagonal(hits, keysBuffer, hitsBuffer);
+}
+
+void SortSeedHitsByDiagonal(std::vector<SeedHit>& hits, std::vector<UInt128t>& keysBuffer,
+                            std::vector<SeedHit>& hitsBuffer)
+{
+    if (hits.size() < 2) {
+        return;
+    }
+
+    // The index of each hit needs to fit into the low 32 bits of the key.
+    if (hits.size() > std::numeric_limits<uint32_t>::max()) {
+        std::sort(hits.begin(), hits.end(), [](const auto& a, const auto& b) {
+            return PackSeedHitWithDiagonalToTuple(a) < PackSeedHitWithDiagonalToTuple(b);
+        });
+        return;
+    }
+
+    keysBuffer.resize(hits.size());
+    for (size_t i = 0; i < hits.size(); ++i) {
+        const auto& hit = hits[i];
+        const int32_t targetIdRev = (hit.targetId << 1) | hit.targetRev;
+        keysBuffer[i] = (SignedToOrderedUnsigned(targetIdRev) << 96) |
+                        (SignedToOrderedUnsigned(hit.targetPos - hit.queryPos) << 64) |
+                        (SignedToOrderedUnsigned(hit.targetPos) << 32) | static_cast<UInt128t>(i);
+    }
+
+    kx::radix_sort(keysBuffer.begin(), keysBuffer.end());
+
+    hitsBuffer.resize(hits.size());
+    for (size_t i = 0; i < keysBuffer.size(); ++i) {
+        hitsBuffer[i] = hits[static_cast<uint32_t>(keysBuffer[i])];
+    }
+    std::swap(hits, hitsBuffer);
+}
+
 }  // namespace Pancake
 }  // namespace PacBio
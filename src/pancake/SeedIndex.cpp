@@ -8,12 +8,52 @@
 #include <pbcopper/logging/Logging.h>
 #include <algorithm>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <sstream>
+#include <tuple>
 
 namespace PacBio {
 namespace Pancake {
 
+namespace {
+// Packs the target ID, strand and the diagonal bucket of a hit into a key which sorts
+// in the same order as the hits sorted by SortSeedHitsByDiagonal.
+inline uint64_t DiagonalBucketKey(const SeedHit& hit, int32_t bucketWidth)
+{
+    const int32_t targetIdRev = (hit.targetId << 1) | hit.targetRev;
+    const int32_t diag = hit.Diagonal();
+    // Floor division, so that the buckets keep the ordering of the negative diagonals.
+    const int32_t bucket =
+        (diag >= 0) ? (diag / bucketWidth) : -((bucketWidth - 1 - diag) / bucketWidth);
+    return (static_cast<uint64_t>(static_cast<uint32_t>(targetIdRev) ^ 0x80000000U) << 32) |
+           (static_cast<uint32_t>(bucket) ^ 0x80000000U);
+}
+
+// Stable sort of the hits within a bucket, by diagonal and target position.
+void SortDiagonalBucket(std::vector<SeedHit>& hits, int64_t begin, int64_t end)
+{
+    auto Compare = [](const SeedHit& a, const SeedHit& b) {
+        return std::make_pair(a.Diagonal(), a.targetPos) <
+               std::make_pair(b.Diagonal(), b.targetPos);
+    };
+    // Most buckets are small, and an insertion sort does not need to allocate.
+    const int64_t INSERTION_SORT_MAX_SIZE = 32;
+    if ((end - begin) > INSERTION_SORT_MAX_SIZE) {
+        std::stable_sort(hits.begin() + begin, hits.begin() + end, Compare);
+        return;
+    }
+    for (int64_t i = begin + 1; i < end; ++i) {
+        const SeedHit hit = hits[i];
+        int64_t j = i;
+        for (; j > begin && Compare(hit, hits[j - 1]); --j) {
+            hits[j] = hits[j - 1];
+        }
+        hits[j] = hit;
+    }
+}
+}  // namespace
+
 SeedIndex::SeedIndex(std::shared_ptr<PacBio::Pancake::SeedDBIndexCache>& seedDBCache,
                      std::vector<PacBio::Pancake::SeedDB::SeedRaw>&& seeds)
     : seeds_(std::move(seeds)), seedParams_(seedDBCache->seedParams)
@@ -44,48 +84,116 @@ SeedIndex::SeedIndex(const PacBio::Pancake::SeedDB::SeedDBParameters& seedParams
     BuildHash_();
 }
 
+SeedIndex::SeedIndex(std::shared_ptr<PacBio::Pancake::SeedDBIndexCache>& seedDBCache,
+                     const PacBio::Pancake::SeedDB::SeedRaw* sortedSeeds, int64_t numSeeds)
+    : seedsData_(sortedSeeds)
+    , numSeeds_(numSeeds)
+    , useHash_(false)
+    , seedParams_(seedDBCache->seedParams)
+{
+    if (numSeeds_ < 0 || (numSeeds_ > 0 && seedsData_ == nullptr)) {
+        std::ostringstream oss;
+        oss << "Invalid external seed array provided to SeedIndex. numSeeds = " << numSeeds_;
+        throw std::runtime_error(oss.str());
+    }
+
+    sequenceLengths_.resize(seedDBCache->seedLines.size());
+    for (size_t i = 0; i < seedDBCache->seedLines.size(); ++i) {
+        sequenceLengths_[i] = seedDBCache->seedLines[i].numBases;
+    }
+
+    IndexSortedSeeds_();
+}
+
 SeedIndex::~SeedIndex() = default;
 
 void SeedIndex::BuildHash_()
 {
-    // Stop early.
-    if (seeds_.empty()) {
-        return;
-    }
-
     // Sort by key first.
     TicToc ttSort;
     kx::radix_sort(seeds_.begin(), seeds_.end());
     ttSort.Stop();
 
+    seedsData_ = seeds_.data();
+    numSeeds_ = seeds_.size();
+
+    IndexSortedSeeds_();
+}
+
+void SeedIndex::IndexSortedSeeds_()
+{
+    // Clear the frequency statistics.
+    freqHistogram_.clear();
+    numValidKeys_ = 0;
+    sumFreqs_ = 0;
+
     // Clear the storage for the hash.
     hash_.clear();
 
+    // Stop early.
+    if (numSeeds_ == 0) {
+        return;
+    }
+
+    if (useHash_) {
 #ifdef SEED_INDEX_USING_DENSEHASH
-    hash_.resize(seeds_.size());
+        hash_.resize(numSeeds_);
 #elif defined SEED_INDEX_USING_SPARSEHASH
-    hash_.resize(seeds_.size());
+        hash_.resize(numSeeds_);
 #elif defined SEED_INDEX_USING_UNORDERED_MAP
-    hash_.reserve(seeds_.size());
+        hash_.reserve(numSeeds_);
 #endif
+    }
+
+    // Dense histogram of seed frequencies: freqCounts[freq] = number of keys.
+    std::vector<int64_t> freqCounts;
+    auto AddKey = [&](uint64_t key, int64_t start, int64_t end) {
+        if (useHash_) {
+            hash_[key] = std::make_pair(start, end);
+        }
+        const int64_t freq = end - start;
+        if (freq >= static_cast<int64_t>(freqCounts.size())) {
+            freqCounts.resize(freq + 1, 0);
+        }
+        ++freqCounts[freq];
+    };
 
     // Fill out the hash table.
     int64_t start = 0;
     int64_t end = 0;
-    uint64_t prevKey = PacBio::Pancake::SeedDB::Seed::DecodeKey(seeds_[0]);
-    for (size_t i = 0; i < seeds_.size(); ++i) {
-        uint64_t key = PacBio::Pancake::SeedDB::Seed::DecodeKey(seeds_[i]);
+    uint64_t prevKey = PacBio::Pancake::SeedDB::Seed::DecodeKey(seedsData_[0]);
+    for (int64_t i = 0; i < numSeeds_; ++i) {
+        uint64_t key = PacBio::Pancake::SeedDB::Seed::DecodeKey(seedsData_[i]);
         if (key == prevKey) {
             ++end;
         } else {
-            hash_[prevKey] = std::make_pair(start, end);
+            // External seeds are not sorted here, so verify the order.
+            if (useHash_ == false && static_cast<int64_t>(key) < static_cast<int64_t>(prevKey)) {
+                std::ostringstream oss;
+                oss << "The external seed array provided to SeedIndex is not sorted. Seed at "
+                       "position "
+                    << i << " has a smaller key than the previous seed.";
+                throw std::runtime_error(oss.str());
+            }
+            AddKey(prevKey, start, end);
             start = i;
             end = i + 1;
         }
         prevKey = key;
     }
     if (end > start) {
-        hash_[prevKey] = std::make_pair(start, end);
+        AddKey(prevKey, start, end);
+    }
+
+    // Keep only the non-empty histogram bins. There are very few distinct frequencies
+    // compared to the number of keys, so the statistics can be computed quickly.
+    for (int64_t freq = 1; freq < static_cast<int64_t>(freqCounts.size()); ++freq) {
+        if (freqCounts[freq] == 0) {
+            continue;
+        }
+        freqHistogram_.emplace_back(freq, freqCounts[freq]);
+        numValidKeys_ += freqCounts[freq];
+        sumFreqs_ += freq * freqCounts[freq];
     }
 }
 
@@ -107,76 +215,327 @@ void SeedIndex::ComputeFrequencyStats(double percentileCutoff, int64_t& retFreqM
     }
 
     // Empty input.
-    if (hash_.empty()) {
+    if (numSeeds_ == 0) {
         return;
     }
 
-    // Collect all frequencies as a vector.
-    std::vector<int64_t> freqs;
-    double sumFreqs = 0.0;
-    int64_t numValidKeys = 0;
-    freqs.reserve(hash_.size());
-    for (auto it = hash_.begin(); it != hash_.end(); ++it) {
-        int64_t start = std::get<0>(it->second);
-        int64_t end = std::get<1>(it->second);
-        int64_t span = end - start;
-        if (span == 0) {
-            continue;
-        }
-        freqs.emplace_back(span);
-        sumFreqs += static_cast<double>(span);
-        ++numValidKeys;
-    }
-
     // Sanity check that there actually are enough valid keys in the hash.
-    if (numValidKeys <= 0) {
+    if (numValidKeys_ <= 0) {
         throw std::runtime_error("Invalid number of valid keys! numValidKeys = " +
-                                 std::to_string(numValidKeys));
+                                 std::to_string(numValidKeys_));
     }
 
-    // Sort the vector for percentile calculation.
-    kx::radix_sort(freqs.begin(), freqs.end());
+    // Returns the frequency at the given position of the sorted list of all key frequencies.
+    auto FrequencyAtSortedId = [this](int64_t sortedId) -> int64_t {
+        int64_t cumulativeCount = 0;
+        for (const auto& bin : freqHistogram_) {
+            cumulativeCount += bin.second;
+            if (sortedId < cumulativeCount) {
+                return bin.first;
+            }
+        }
+        return freqHistogram_.back().first;
+    };
 
     // Find the percentile cutoff ID.
-    const double numKeysDouble = numValidKeys;
+    const double numKeysDouble = numValidKeys_;
     const int64_t cutoffId = std::max(0.0, std::floor(numKeysDouble * (1.0 - percentileCutoff)));
 
     // Return values.
-    retFreqMax = freqs.back();
-    retFreqCutoff = (cutoffId >= numValidKeys) ? (freqs[numValidKeys - 1] + 1) : freqs[cutoffId];
-    retFreqAvg = sumFreqs / numKeysDouble;
-    retFreqMedian = (static_cast<double>(freqs[numValidKeys / 2]) +
-                     static_cast<double>(freqs[(numValidKeys - 1) / 2])) /
+    retFreqMax = freqHistogram_.back().first;
+    retFreqCutoff = (cutoffId >= numValidKeys_) ? (retFreqMax + 1) : FrequencyAtSortedId(cutoffId);
+    retFreqAvg = static_cast<double>(sumFreqs_) / numKeysDouble;
+    retFreqMedian = (static_cast<double>(FrequencyAtSortedId(numValidKeys_ / 2)) +
+                     static_cast<double>(FrequencyAtSortedId((numValidKeys_ - 1) / 2))) /
                     2.0;
 }
 
+bool SeedIndex::FindKeyRange_(uint64_t key, int64_t& retStart, int64_t& retEnd) const
+{
+    retStart = retEnd = 0;
+    // The index keys are sign-extended, but the key of a decoded query seed is not.
+    key = PacBio::Pancake::SeedDB::Seed::SignExtendKey(key);
+    if (useHash_) {
+        auto it = hash_.find(key);
+        if (it == hash_.end()) {
+            return false;
+        }
+        retStart = std::get<0>(it->second);
+        retEnd = std::get<1>(it->second);
+    } else {
+        // The seeds are sorted as signed 128-bit integers, so compare signed keys.
+        const int64_t signedKey = static_cast<int64_t>(key);
+        auto LessThanKey = [](const PacBio::Pancake::SeedDB::SeedRaw& seed, int64_t k) {
+            return static_cast<int64_t>(PacBio::Pancake::SeedDB::Seed::DecodeKey(seed)) < k;
+        };
+        auto KeyLessThan = [](int64_t k, const PacBio::Pancake::SeedDB::SeedRaw& seed) {
+            return k < static_cast<int64_t>(PacBio::Pancake::SeedDB::Seed::DecodeKey(seed));
+        };
+        const auto* first = seedsData_;
+        const auto* last = seedsData_ + numSeeds_;
+        retStart = std::lower_bound(first, last, signedKey, LessThanKey) - first;
+        retEnd = std::upper_bound(first + retStart, last, signedKey, KeyLessThan) - first;
+    }
+    return retEnd > retStart;
+}
+
 int64_t SeedIndex::GetSeeds(uint64_t key,
                             std::vector<PacBio::Pancake::SeedDB::SeedRaw>& seeds) const
 {
     seeds.clear();
-    auto it = hash_.find(key);
-    if (it == hash_.end()) {
+    int64_t start = 0;
+    int64_t end = 0;
+    if (FindKeyRange_(key, start, end) == false) {
         return 0;
     }
-    int64_t start = std::get<0>(it->second);
-    int64_t end = std::get<1>(it->second);
-    seeds.insert(seeds.end(), seeds_.begin() + start, seeds_.begin() + end);
+    seeds.insert(seeds.end(), seedsData_ + start, seedsData_ + end);
     return (end - start);
 }
 
+int64_t SeedIndex::ComputeQueryFreqCutoff(const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                                          int64_t querySeedsSize, int64_t freqCutoff,
+                                          int64_t maxHits, bool& retCapped,
+                                          int32_t maxQueryKeyOccurrences) const
+{
+    retCapped = false;
+    if (maxHits <= 0) {
+        return freqCutoff;
+    }
+
+    std::vector<uint8_t> keep;
+    if (maxQueryKeyOccurrences > 0) {
+        PacBio::Pancake::SeedDB::SubsampleRepetitiveQuerySeeds(keep, querySeeds, querySeedsSize,
+                                                               maxQueryKeyOccurrences);
+    }
+
+    // Frequencies of all query keys which would produce hits with the global cutoff.
+    std::vector<int64_t> freqs;
+    freqs.reserve(querySeedsSize);
+    int64_t numHits = 0;
+    for (int64_t i = 0; i < querySeedsSize; ++i) {
+        if (keep.empty() == false && keep[i] == 0) {
+            continue;
+        }
+        const auto decodedQuery = PacBio::Pancake::SeedDB::Seed(querySeeds[i]);
+        int64_t start = 0;
+        int64_t end = 0;
+        if (FindKeyRange_(decodedQuery.key, start, end) == false) {
+            continue;
+        }
+        const int64_t freq = end - start;
+        if (freqCutoff > 0 && freq > freqCutoff) {
+            continue;
+        }
+        freqs.emplace_back(freq);
+        numHits += freq;
+    }
+
+    if (numHits <= maxHits) {
+        return freqCutoff;
+    }
+    retCapped = true;
+
+    // Drop the keys from the most frequent one down, until the hits fit the budget.
+    // All keys of the same frequency are dropped together, and the least frequent
+    // keys of the query are always kept.
+    std::sort(freqs.begin(), freqs.end(), std::greater<int64_t>());
+    size_t groupStart = 0;
+    while (numHits > maxHits) {
+        size_t groupEnd = groupStart;
+        while (groupEnd < freqs.size() && freqs[groupEnd] == freqs[groupStart]) {
+            ++groupEnd;
+        }
+        if (groupEnd == freqs.size()) {
+            break;
+        }
+        numHits -= freqs[groupStart] * static_cast<int64_t>(groupEnd - groupStart);
+        groupStart = groupEnd;
+    }
+
+    return freqs[groupStart];
+}
+
 bool SeedIndex::CollectHits(const std::vector<PacBio::Pancake::SeedDB::SeedRaw>& querySeeds,
-                            int32_t queryLen, std::vector<SeedHit>& hits, int64_t freqCutoff) const
+                            int32_t queryLen, std::vector<SeedHit>& hits, int64_t freqCutoff,
+                            int32_t maxQueryKeyOccurrences) const
+{
+    return CollectHits(&querySeeds[0], querySeeds.size(), queryLen, hits, freqCutoff,
+                       maxQueryKeyOccurrences);
+}
+
+bool SeedIndex::UseMergeJoin_(int64_t querySeedsSize) const
 {
-    return CollectHits(&querySeeds[0], querySeeds.size(), queryLen, hits, freqCutoff);
+    // Dense queries (relative to the index size) touch a large portion of the
+    // index anyway, so a sequential merge-join is cheaper than random hash probes.
+    // Indices over external seeds do not have a hash at all.
+    return useHash_ == false ||
+           (querySeedsSize > 0 &&
+            querySeedsSize * SEED_INDEX_MERGE_JOIN_MAX_TARGET_TO_QUERY_RATIO >= numSeeds_);
 }
 
 bool SeedIndex::CollectHits(const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
                             int64_t querySeedsSize, int32_t queryLen, std::vector<SeedHit>& hits,
-                            int64_t freqCutoff) const
+                            int64_t freqCutoff, int32_t maxQueryKeyOccurrences) const
 {
+    if (UseMergeJoin_(querySeedsSize)) {
+        return CollectHitsMergeJoin(querySeeds, querySeedsSize, queryLen, hits, freqCutoff,
+                                    maxQueryKeyOccurrences);
+    }
+    return CollectHitsHash(querySeeds, querySeedsSize, queryLen, hits, freqCutoff,
+                           maxQueryKeyOccurrences);
+}
+
+bool SeedIndex::CollectHitsHash(const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                                int64_t querySeedsSize, int32_t queryLen,
+                                std::vector<SeedHit>& hits, int64_t freqCutoff,
+                                int32_t maxQueryKeyOccurrences) const
+{
+    if (useHash_ == false) {
+        throw std::runtime_error(
+            "The hash lookup is not available in a SeedIndex built over external seeds.");
+    }
     return PacBio::Pancake::SeedDB::CollectSeedHits<SeedHashType>(
-        hits, querySeeds, querySeedsSize, queryLen, hash_, &seeds_[0], seeds_.size(),
-        sequenceLengths_, seedParams_.KmerSize, seedParams_.Spacing, freqCutoff);
+        hits, querySeeds, querySeedsSize, queryLen, hash_, seedsData_, numSeeds_, sequenceLengths_,
+        seedParams_.KmerSize, seedParams_.Spacing, freqCutoff, maxQueryKeyOccurrences);
+}
+
+bool SeedIndex::CollectHitsMergeJoin(const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                                     int64_t querySeedsSize, int32_t queryLen,
+                                     std::vector<SeedHit>& hits, int64_t freqCutoff,
+                                     int32_t maxQueryKeyOccurrences) const
+{
+    return PacBio::Pancake::SeedDB::CollectSeedHitsMergeJoin(
+        hits, querySeeds, querySeedsSize, queryLen, seedsData_, numSeeds_, sequenceLengths_,
+        seedParams_.KmerSize, seedParams_.Spacing, freqCutoff, maxQueryKeyOccurrences);
+}
+
+bool SeedIndex::CollectHitsIntoDiagonalBuckets(const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                                               int64_t querySeedsSize, int32_t queryLen,
+                                               std::vector<SeedHit>& hits, int64_t freqCutoff,
+                                               int32_t diagonalBucketWidth,
+                                               int32_t maxQueryKeyOccurrences) const
+{
+    DiagonalBucketScratch scratch;
+    return CollectHitsIntoDiagonalBuckets(querySeeds, querySeedsSize, queryLen, hits, freqCutoff,
+                                          diagonalBucketWidth, scratch, maxQueryKeyOccurrences);
+}
+
+bool SeedIndex::CollectHitsIntoDiagonalBuckets(const PacBio::Pancake::SeedDB::SeedRaw* querySeeds,
+                                               int64_t querySeedsSize, int32_t /*queryLen*/,
+                                               std::vector<SeedHit>& hits, int64_t freqCutoff,
+                                               int32_t diagonalBucketWidth,
+                                               DiagonalBucketScratch& scratch,
+                                               int32_t maxQueryKeyOccurrences) const
+{
+    hits.clear();
+
+    if (diagonalBucketWidth <= 0) {
+        std::ostringstream oss;
+        oss << "The diagonalBucketWidth needs to be a positive value. diagonalBucketWidth = "
+            << diagonalBucketWidth;
+        throw std::runtime_error(oss.str());
+    }
+
+    // Look up the index range of each query seed only once, with the same lookup as in
+    // CollectHits. The merge-join also collapses the keys which repeat many times within
+    // the query; for the hash lookup this is done separately.
+    const bool useMergeJoin = UseMergeJoin_(querySeedsSize);
+    if (useMergeJoin) {
+        PacBio::Pancake::SeedDB::FindSeedRangesMergeJoin(
+            scratch.queryRanges, scratch.keep, scratch.sortedQuery, querySeeds, querySeedsSize,
+            seedsData_, numSeeds_, maxQueryKeyOccurrences);
+    } else if (maxQueryKeyOccurrences > 0) {
+        PacBio::Pancake::SeedDB::SubsampleRepetitiveQuerySeeds(
+            scratch.keep, scratch.sortedQuery, querySeeds, querySeedsSize, maxQueryKeyOccurrences);
+    } else {
+        scratch.keep.clear();
+    }
+
+    // The ranges are kept in the query order, so that the hits are visited in the same
+    // order as in CollectHits.
+    auto& ranges = scratch.ranges;
+    ranges.clear();
+    int64_t numHits = 0;
+    for (int64_t seedId = 0; seedId < querySeedsSize; ++seedId) {
+        if (scratch.keep.empty() == false && scratch.keep[seedId] == 0) {
+            continue;
+        }
+        int64_t start = 0;
+        int64_t end = 0;
+        if (useMergeJoin) {
+            start = scratch.queryRanges[seedId].first;
+            end = scratch.queryRanges[seedId].second;
+        } else {
+            const uint64_t key = PacBio::Pancake::SeedDB::Seed(querySeeds[seedId]).key;
+            FindKeyRange_(key, start, end);
+        }
+        // Skip missing and very frequent seeds.
+        if (start == end || (freqCutoff > 0 && (end - start) > freqCutoff)) {
+            continue;
+        }
+        ranges.emplace_back(seedId, start, end);
+        numHits += end - start;
+    }
+
+    if (numHits == 0) {
+        return false;
+    }
+
+    // First pass: decode the hits in the collection order, assign a dense ID to each
+    // bucket, and count the hits in each bucket.
+    auto& unsortedHits = scratch.unsortedHits;
+    auto& hitBucketIds = scratch.hitBucketIds;
+    auto& bucketIds = scratch.bucketIds;
+    auto& bucketOffsets = scratch.bucketOffsets;
+    unsortedHits.resize(numHits);
+    hitBucketIds.resize(numHits);
+    bucketIds.clear();
+    bucketOffsets.clear();
+    int64_t hitId = 0;
+    for (const auto& range : ranges) {
+        const auto decodedQuery = PacBio::Pancake::SeedDB::Seed(querySeeds[std::get<0>(range)]);
+        for (int64_t i = std::get<1>(range); i < std::get<2>(range); ++i, ++hitId) {
+            const auto hit =
+                PacBio::Pancake::SeedDB::MakeSeedHit(decodedQuery, seedsData_[i], sequenceLengths_);
+            const auto it = bucketIds.emplace(DiagonalBucketKey(hit, diagonalBucketWidth),
+                                              static_cast<int32_t>(bucketOffsets.size()));
+            if (it.second) {
+                bucketOffsets.emplace_back(0);
+            }
+            unsortedHits[hitId] = hit;
+            hitBucketIds[hitId] = it.first->second;
+            ++bucketOffsets[it.first->second];
+        }
+    }
+
+    // Order the buckets, and convert the counts into the start offsets of the buckets.
+    auto& sortedBuckets = scratch.sortedBuckets;
+    sortedBuckets.assign(bucketIds.begin(), bucketIds.end());
+    std::sort(sortedBuckets.begin(), sortedBuckets.end());
+    int64_t offset = 0;
+    for (const auto& bucket : sortedBuckets) {
+        const int64_t count = bucketOffsets[bucket.second];
+        bucketOffsets[bucket.second] = offset;
+        offset += count;
+    }
+
+    // Second pass: place each hit into its bucket. The hits within a bucket stay
+    // in the collection order.
+    hits.resize(numHits);
+    for (int64_t i = 0; i < numHits; ++i) {
+        hits[bucketOffsets[hitBucketIds[i]]++] = unsortedHits[i];
+    }
+
+    // Sort the hits only within the buckets. After the second pass, each offset points
+    // to the end of its bucket.
+    int64_t begin = 0;
+    for (const auto& bucket : sortedBuckets) {
+        const int64_t end = bucketOffsets[bucket.second];
+        SortDiagonalBucket(hits, begin, end);
+        begin = end;
+    }
+
+    return true;
 }
 
 }  // namespace Pancake
@@ -5,6 +5,8 @@
 #include <pacbio/pancake/Twobit.h>
 #include <pacbio/util/RunLengthEncoding.h>
 #include <pacbio/util/Util.h>
+#include <pbcopper/parallel/FireAndForget.h>
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -65,8 +67,24 @@ void SeqDBReaderCachedBlock::LoadSequences(const std::vector<std::string>& seqNa
     return LoadBlockCompressed_(parts);
 }
 
+void SeqDBReaderCachedBlock::LoadExternalRecords(const std::vector<FastaSequenceCached>& records)
+{
+    // Release the memory of any previously loaded block.
+    std::vector<uint8_t>().swap(data_);
+    ClearReverseComplements_();
+    records_ = records;
+    headerToOrdinalId_.clear();
+    seqIdToOrdinalId_.clear();
+    for (int32_t i = 0; i < static_cast<int32_t>(records_.size()); ++i) {
+        headerToOrdinalId_[records_[i].Name()] = i;
+        seqIdToOrdinalId_[records_[i].Id()] = i;
+    }
+}
+
 void SeqDBReaderCachedBlock::LoadBlockCompressed_(const std::vector<ContiguousFilePart>& parts)
 {
+    ClearReverseComplements_();
+
     // Count the data size.
     int64_t totalBases = 0;
     int64_t totalRecords = 0;
@@ -137,6 +155,8 @@ void SeqDBReaderCachedBlock::LoadBlockCompressed_(const std::vector<ContiguousFi
 
 void SeqDBReaderCachedBlock::LoadBlockUncompressed_(const std::vector<ContiguousFilePart>& parts)
 {
+    ClearReverseComplements_();
+
     // Count the data size.
     int64_t totalBases = 0;
     int64_t totalRecords = 0;
@@ -254,6 +274,69 @@ void SeqDBReaderCachedBlock::GetSequence(FastaSequenceCached& record, const std:
     record = records_[ordinalId];
 }
 
+void SeqDBReaderCachedBlock::ComputeReverseComplements(int32_t numThreads)
+{
+    ClearReverseComplements_();
+
+    // Lay out the reverse complements in the same order as the records.
+    const int32_t numRecords = records_.size();
+    std::vector<int64_t> offsets(numRecords + 1, 0);
+    for (int32_t i = 0; i < numRecords; ++i) {
+        offsets[i + 1] = offsets[i] + records_[i].Size();
+    }
+    dataRevCmp_.resize(offsets[numRecords]);
+    recordsRevCmp_.resize(numRecords);
+    for (int32_t i = 0; i < numRecords; ++i) {
+        recordsRevCmp_[i] = dataRevCmp_.data() + offsets[i];
+    }
+
+    auto Worker = [this, &offsets](int32_t startId, int32_t endId) {
+        for (int32_t i = startId; i < endId; ++i) {
+            const char* seq = records_[i].Bases();
+            const int64_t seqLen = records_[i].Size();
+            char* ret = dataRevCmp_.data() + offsets[i];
+            for (int64_t j = 0; j < seqLen; ++j) {
+                ret[j] = PacBio::Pancake::BaseToBaseComplement[static_cast<int32_t>(
+                    seq[seqLen - 1 - j])];
+            }
+        }
+    };
+
+    // Split the records roughly evenly between the threads.
+    const int32_t actualThreadCount = std::max(1, std::min(numThreads, numRecords));
+    const int32_t minimumRecordsPerThread = numRecords / actualThreadCount;
+    const int32_t remainingRecords = numRecords % actualThreadCount;
+    PacBio::Parallel::FireAndForget faf(actualThreadCount);
+    int32_t submittedCount = 0;
+    for (int32_t i = 0; i < actualThreadCount; ++i) {
+        const int32_t numToSubmit = minimumRecordsPerThread + ((i < remainingRecords) ? 1 : 0);
+        faf.ProduceWith(Worker, submittedCount, submittedCount + numToSubmit);
+        submittedCount += numToSubmit;
+    }
+    faf.Finalize();
+}
+
+const char* SeqDBReaderCachedBlock::GetReverseComplement(int32_t seqId) const
+{
+    if (recordsRevCmp_.empty()) {
+        return nullptr;
+    }
+    auto it = seqIdToOrdinalId_.find(seqId);
+    if (it == seqIdToOrdinalId_.end()) {
+        std::ostringstream oss;
+        oss << "(SeqDBReaderCachedBlock) Invalid seqId, not found in the preloaded data. seqId = "
+            << seqId << ", records_.size() = " << records_.size();
+        throw std::runtime_error(oss.str());
+    }
+    return recordsRevCmp_[it->second];
+}
+
+void SeqDBReaderCachedBlock::ClearReverseComplements_()
+{
+    std::vector<char>().swap(dataRevCmp_);
+    std::vector<const char*>().swap(recordsRevCmp_);
+}
+
 void SeqDBReaderCachedBlock::CompressHomopolymers_()
 {
     std::vector<int32_t> runLengths;
@@ -0,0 +1,256 @@
+// Authors: Ivan Sovic
+
+#include <fcntl.h>
+#include <pacbio/pancake/SharedTargetBlock.h>
+#include <pacbio/util/Util.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+namespace PacBio {
+namespace Pancake {
+
+namespace {
+
+int64_t AlignOffset(int64_t offset, int64_t alignment)
+{
+    return ((offset + alignment - 1) / alignment) * alignment;
+}
+
+void WriteBytes(FILE* fp, const void* data, int64_t numBytes, const std::string& filename)
+{
+    if (numBytes <= 0) {
+        return;
+    }
+    const int64_t numWritten = fwrite(data, sizeof(uint8_t), numBytes, fp);
+    if (numWritten != numBytes) {
+        std::ostringstream oss;
+        oss << "(SharedTargetBlock) Could not write data to file '" << filename
+            << "'. numBytes = " << numBytes << ", numWritten = " << numWritten;
+        throw std::runtime_error(oss.str());
+    }
+}
+
+void WritePadding(FILE* fp, int64_t currOffset, int64_t targetOffset, const std::string& filename)
+{
+    const std::vector<uint8_t> padding(targetOffset - currOffset, 0);
+    WriteBytes(fp, padding.data(), padding.size(), filename);
+}
+
+/*
+ * Removes a temporary file when going out of scope, unless Release() was called first.
+*/
+class TempFileGuard
+{
+public:
+    TempFileGuard(const std::string& filename) : filename_(filename) {}
+    ~TempFileGuard()
+    {
+        if (released_ == false) {
+            std::remove(filename_.c_str());
+        }
+    }
+    TempFileGuard(const TempFileGuard&) = delete;
+    TempFileGuard& operator=(const TempFileGuard&) = delete;
+
+    void Release() { released_ = true; }
+
+private:
+    std::string filename_;
+    bool released_ = false;
+};
+
+}  // namespace
+
+SharedTargetBlock::SharedTargetBlock(const std::string& filename) : filename_(filename)
+{
+    fd_ = open(filename.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        throw std::runtime_error("(SharedTargetBlock) Could not open file '" + filename + "'!");
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        Unmap_();
+        throw std::runtime_error("(SharedTargetBlock) Could not stat file '" + filename + "'!");
+    }
+    dataSize_ = st.st_size;
+
+    if (dataSize_ < static_cast<int64_t>(sizeof(SharedTargetBlockHeader))) {
+        Unmap_();
+        throw std::runtime_error("(SharedTargetBlock) File '" + filename +
+                                 "' is too small to be a shared target block.");
+    }
+
+    void* ptr = mmap(nullptr, dataSize_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (ptr == MAP_FAILED) {
+        Unmap_();
+        throw std::runtime_error("(SharedTargetBlock) Could not mmap file '" + filename + "'!");
+    }
+    data_ = static_cast<const uint8_t*>(ptr);
+
+    std::memcpy(&header_, data_, sizeof(SharedTargetBlockHeader));
+
+    // Validate the header.
+    const int64_t recordsEnd =
+        header_.recordsOffset +
+        header_.numRecords * static_cast<int64_t>(sizeof(SharedTargetBlockRecord));
+    const int64_t seedsEnd =
+        header_.seedsOffset +
+        header_.numSeeds * static_cast<int64_t>(sizeof(PacBio::Pancake::SeedDB::SeedRaw));
+    const bool isValid =
+        std::memcmp(header_.magic, SHARED_TARGET_BLOCK_MAGIC, sizeof(header_.magic)) == 0 &&
+        header_.version == SHARED_TARGET_BLOCK_VERSION && header_.fileSize == dataSize_ &&
+        header_.numRecords >= 0 && header_.numSeeds >= 0 && recordsEnd <= header_.namesOffset &&
+        header_.namesOffset <= header_.basesOffset && header_.basesOffset <= header_.seedsOffset &&
+        (header_.seedsOffset % static_cast<int64_t>(sizeof(PacBio::Pancake::SeedDB::SeedRaw))) ==
+            0 &&
+        seedsEnd == dataSize_;
+    if (isValid == false) {
+        std::ostringstream oss;
+        oss << "(SharedTargetBlock) File '" << filename
+            << "' is not a valid shared target block, or it was written by an incompatible "
+               "version. version = "
+            << header_.version << ", fileSize = " << header_.fileSize
+            << ", actual size = " << dataSize_;
+        Unmap_();
+        throw std::runtime_error(oss.str());
+    }
+
+    seeds_ = reinterpret_cast<const PacBio::Pancake::SeedDB::SeedRaw*>(data_ + header_.seedsOffset);
+
+    // Construct the records. Bases point directly into the mapped data.
+    const auto* fileRecords =
+        reinterpret_cast<const SharedTargetBlockRecord*>(data_ + header_.recordsOffset);
+    records_.resize(header_.numRecords);
+    for (int64_t i = 0; i < header_.numRecords; ++i) {
+        const auto& fr = fileRecords[i];
+        if (fr.nameLen < 0 || fr.numBases < 0 ||
+            fr.nameOffset + fr.nameLen > header_.basesOffset - header_.namesOffset ||
+            fr.basesOffset + fr.numBases > header_.seedsOffset - header_.basesOffset) {
+            std::ostringstream oss;
+            oss << "(SharedTargetBlock) Invalid record " << i << " in file '" << filename << "'.";
+            Unmap_();
+            throw std::runtime_error(oss.str());
+        }
+        const char* name =
+            reinterpret_cast<const char*>(data_ + header_.namesOffset + fr.nameOffset);
+        const char* bases =
+            reinterpret_cast<const char*>(data_ + header_.basesOffset + fr.basesOffset);
+        records_[i] =
+            FastaSequenceCached{std::string(name, fr.nameLen), bases, fr.numBases, fr.seqId};
+    }
+}
+
+SharedTargetBlock::~SharedTargetBlock() { Unmap_(); }
+
+void SharedTargetBlock::Unmap_()
+{
+    if (data_ != nullptr) {
+        munmap(const_cast<uint8_t*>(data_), dataSize_);
+        data_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    seeds_ = nullptr;
+}
+
+PacBio::Pancake::SeedDB::SeedDBParameters SharedTargetBlock::SeedParams() const
+{
+    PacBio::Pancake::SeedDB::SeedDBParameters ret;
+    ret.KmerSize = header_.kmerSize;
+    ret.MinimizerWindow = header_.minimizerWindow;
+    ret.Spacing = header_.spacing;
+    ret.UseHPC = header_.useHPC;
+    ret.UseHPCForSeedsOnly = header_.useHPCForSeedsOnly;
+    ret.MaxHPCLen = header_.maxHPCLen;
+    ret.UseRC = header_.useRC;
+    return ret;
+}
+
+void SharedTargetBlock::Write(const std::string& filename, int32_t targetBlockId,
+                              const PacBio::Pancake::SeqDBReaderCachedBlock& seqReader,
+                              bool seqsUseHPC, const PacBio::Pancake::SeedIndex& index)
+{
+    const auto& records = seqReader.records();
+    const auto& seedParams = index.GetSeedParams();
+
+    // Prepare the record table.
+    std::vector<SharedTargetBlockRecord> fileRecords(records.size());
+    int64_t namesSize = 0;
+    int64_t basesSize = 0;
+    for (size_t i = 0; i < records.size(); ++i) {
+        fileRecords[i].seqId = records[i].Id();
+        fileRecords[i].nameLen = records[i].Name().size();
+        fileRecords[i].nameOffset = namesSize;
+        fileRecords[i].basesOffset = basesSize;
+        fileRecords[i].numBases = records[i].Size();
+        namesSize += fileRecords[i].nameLen;
+        basesSize += fileRecords[i].numBases;
+    }
+
+    // Prepare the header.
+    SharedTargetBlockHeader header;
+    std::memcpy(header.magic, SHARED_TARGET_BLOCK_MAGIC, sizeof(header.magic));
+    header.version = SHARED_TARGET_BLOCK_VERSION;
+    header.targetBlockId = targetBlockId;
+    header.kmerSize = seedParams.KmerSize;
+    header.minimizerWindow = seedParams.MinimizerWindow;
+    header.spacing = seedParams.Spacing;
+    header.maxHPCLen = seedParams.MaxHPCLen;
+    header.useHPC = seedParams.UseHPC;
+    header.useHPCForSeedsOnly = seedParams.UseHPCForSeedsOnly;
+    header.useRC = seedParams.UseRC;
+    header.seqsUseHPC = seqsUseHPC;
+    header.numRecords = fileRecords.size();
+    header.numSeeds = index.GetNumSeeds();
+    header.recordsOffset = sizeof(SharedTargetBlockHeader);
+    header.namesOffset = header.recordsOffset +
+                         header.numRecords * static_cast<int64_t>(sizeof(SharedTargetBlockRecord));
+    header.basesOffset = header.namesOffset + namesSize;
+    header.seedsOffset =
+        AlignOffset(header.basesOffset + basesSize, sizeof(PacBio::Pancake::SeedDB::SeedRaw));
+    header.fileSize =
+        header.seedsOffset +
+        header.numSeeds * static_cast<int64_t>(sizeof(PacBio::Pancake::SeedDB::SeedRaw));
+
+    // Write to a temporary file first, so that a partially written file is never visible.
+    std::ostringstream ossTmp;
+    ossTmp << filename << ".tmp." << getpid();
+    const std::string tmpFilename = ossTmp.str();
+    // Removes the temporary file if anything below throws.
+    TempFileGuard tmpGuard(tmpFilename);
+    {
+        auto fp = PacBio::Pancake::OpenFile(tmpFilename, "wb");
+        WriteBytes(fp.get(), &header, sizeof(header), tmpFilename);
+        WriteBytes(fp.get(), fileRecords.data(),
+                   fileRecords.size() * sizeof(SharedTargetBlockRecord), tmpFilename);
+        for (const auto& record : records) {
+            WriteBytes(fp.get(), record.Name().data(), record.Name().size(), tmpFilename);
+        }
+        for (const auto& record : records) {
+            WriteBytes(fp.get(), record.Bases(), record.Size(), tmpFilename);
+        }
+        WritePadding(fp.get(), header.basesOffset + basesSize, header.seedsOffset, tmpFilename);
+        WriteBytes(fp.get(), index.GetSortedSeeds(),
+                   header.numSeeds * sizeof(PacBio::Pancake::SeedDB::SeedRaw), tmpFilename);
+        if (fflush(fp.get()) != 0) {
+            throw std::runtime_error("(SharedTargetBlock) Could not flush file '" + tmpFilename +
+                                     "'.");
+        }
+    }
+
+    if (std::rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+        throw std::runtime_error("(SharedTargetBlock) Could not rename '" + tmpFilename + "' to '" +
+                                 filename + "'.");
+    }
+    tmpGuard.Release();
+}
+
+}  // namespace Pancake
+}  // namespace PacBio
@@ -0,0 +1,51 @@
+// Author: Ivan Sovic
+
+#ifndef PANCAKE_TEST_HELPERS_H
+#define PANCAKE_TEST_HELPERS_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <utility>
+
+namespace PacBio {
+namespace Pancake {
+namespace Test {
+
+/*
+ * Generates a query and a target which differs from it by random mismatches,
+ * insertions and deletions, with the given error rate in percent. Each insertion
+ * is between 1 and maxInsertionLen bases long.
+*/
+inline std::pair<std::string, std::string> HelperRandomPair(std::mt19937& gen, int32_t len,
+                                                            int32_t errorRate,
+                                                            int32_t maxInsertionLen = 1)
+{
+    const std::string bases("ACGT");
+    std::string query;
+    for (int32_t i = 0; i < len; ++i) {
+        query += bases[gen() % 4];
+    }
+    std::string target;
+    for (const char c : query) {
+        const int32_t r = gen() % 100;
+        if (r < errorRate) {
+            target += bases[gen() % 4];
+        } else if (r < 2 * errorRate) {
+            const int32_t insLen = (maxInsertionLen > 1) ? (1 + gen() % maxInsertionLen) : 1;
+            for (int32_t i = 0; i < insLen; ++i) {
+                target += bases[gen() % 4];
+            }
+            target += c;
+        } else if (r >= 3 * errorRate) {
+            target += c;
+        }
+    }
+    return std::make_pair(query, target);
+}
+
+}  // namespace Test
+}  // namespace Pancake
+}  // namespace PacBio
+
+#endif  // PANCAKE_TEST_HELPERS_H
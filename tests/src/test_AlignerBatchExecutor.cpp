@@ -0,0 +1,129 @@
+// Authors: Ivan Sovic
+
+#include <PancakeTestHelpers.h>
+#include <gtest/gtest.h>
+#include <pacbio/pancake/AlignerBatchExecutor.h>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace PacBio {
+namespace Pancake {
+namespace Test {
+
+/*
+ * Mixed global and extension jobs on random pairs, and their results when aligned
+ * one by one.
+*/
+void HelperMakeJobs(uint32_t seed, const AlignmentParameters& opt,
+                    std::vector<std::pair<std::string, std::string>>& seqs,
+                    std::vector<AlignmentJob>& jobs, std::vector<AlignmentResult>& expected)
+{
+    std::mt19937 gen(seed);
+    for (int32_t i = 0; i < 200; ++i) {
+        auto pair = HelperRandomPair(gen, 1 + gen() % 1000, gen() % 10);
+        if (pair.second.empty()) {
+            continue;
+        }
+        seqs.emplace_back(std::move(pair));
+    }
+    for (size_t i = 0; i < seqs.size(); ++i) {
+        const auto& query = seqs[i].first;
+        const auto& target = seqs[i].second;
+        jobs.emplace_back(
+            AlignmentJob(query.c_str(), query.size(), target.c_str(), target.size(),
+                         (i % 3 == 0) ? AlignmentMode::EXTEND : AlignmentMode::GLOBAL));
+    }
+
+    auto aligner = AlignerFactory(AlignerType::KSW2, opt);
+    for (const auto& job : jobs) {
+        if (job.mode == AlignmentMode::GLOBAL) {
+            expected.emplace_back(aligner->Global(job.qseq, job.qlen, job.tseq, job.tlen));
+        } else {
+            expected.emplace_back(aligner->Extend(job.qseq, job.qlen, job.tseq, job.tlen));
+        }
+    }
+}
+
+void HelperExpectSameResults(const std::vector<AlignmentResult>& expected,
+                             const std::vector<AlignmentResult>& results)
+{
+    ASSERT_EQ(expected.size(), results.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        SCOPED_TRACE("jobId = " + std::to_string(i));
+        EXPECT_EQ(expected[i].cigar, results[i].cigar);
+        EXPECT_EQ(expected[i].valid, results[i].valid);
+        EXPECT_EQ(expected[i].score, results[i].score);
+        EXPECT_EQ(expected[i].lastQueryPos, results[i].lastQueryPos);
+        EXPECT_EQ(expected[i].lastTargetPos, results[i].lastTargetPos);
+    }
+}
+
+TEST(AlignerBatchExecutor, SameResultsAsSingleAlignments)
+{
+    /*
+     * A batch of mixed global and extension jobs has to give the same results, in the
+     * same order, as aligning the jobs one by one. This is checked for the default
+     * AlignBatch (one thread) and for the thread pool.
+    */
+    AlignmentParameters opt;
+    std::vector<std::pair<std::string, std::string>> seqs;
+    std::vector<AlignmentJob> jobs;
+    std::vector<AlignmentResult> expected;
+    HelperMakeJobs(41, opt, seqs, jobs, expected);
+
+    for (const int32_t numThreads : {1, 4}) {
+        SCOPED_TRACE("numThreads = " + std::to_string(numThreads));
+        AlignerBatchExecutor executor(AlignerType::KSW2, opt, numThreads);
+        EXPECT_EQ(numThreads, executor.NumThreads());
+
+        // The second batch reuses the results of the first one.
+        std::vector<AlignmentResult> results;
+        for (int32_t batchId = 0; batchId < 2; ++batchId) {
+            executor.AlignBatch(jobs, results);
+            HelperExpectSameResults(expected, results);
+        }
+
+        // An empty batch.
+        executor.AlignBatch({}, results);
+        EXPECT_TRUE(results.empty());
+    }
+}
+
+TEST(AlignerBatchExecutor, SharedPool)
+{
+    /*
+     * Two executors share a pool with fewer threads than they have aligners, and are
+     * used at the same time from two threads. Each has to give the serial results.
+    */
+    AlignmentParameters opt;
+    std::vector<std::pair<std::string, std::string>> seqs[2];
+    std::vector<AlignmentJob> jobs[2];
+    std::vector<AlignmentResult> expected[2];
+    HelperMakeJobs(43, opt, seqs[0], jobs[0], expected[0]);
+    HelperMakeJobs(47, opt, seqs[1], jobs[1], expected[1]);
+
+    PacBio::Parallel::FireAndForget faf(2);
+    AlignerBatchExecutor executor0(AlignerType::KSW2, opt, 4, &faf);
+    AlignerBatchExecutor executor1(AlignerType::KSW2, opt, 4, &faf);
+
+    std::vector<AlignmentResult> results[2];
+    std::thread thread1([&]() { executor1.AlignBatch(jobs[1], results[1]); });
+    executor0.AlignBatch(jobs[0], results[0]);
+    thread1.join();
+    faf.Finalize();
+
+    HelperExpectSameResults(expected[0], results[0]);
+    HelperExpectSameResults(expected[1], results[1]);
+}
+
+TEST(AlignerBatchExecutor, InvalidNumberOfThreadsThrows)
+{
+    AlignmentParameters opt;
+    EXPECT_THROW(AlignerBatchExecutor(AlignerType::KSW2, opt, 0), std::runtime_error);
+}
+
+}  // namespace Test
+}  // namespace Pancake
+}  // namespace PacBio
@@ -0,0 +1,171 @@
+// Authors: Ivan Sovic
+
+#include <PancakeTestHelpers.h>
+#include <gtest/gtest.h>
+#include <pacbio/pancake/AlignerKSW2.h>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace PacBio {
+namespace Pancake {
+namespace Test {
+
+void HelperExpectSameResult(const AlignmentResult& expected, const AlignmentResult& result)
+{
+    EXPECT_EQ(expected.cigar, result.cigar);
+    EXPECT_EQ(expected.valid, result.valid);
+    EXPECT_EQ(expected.score, result.score);
+    EXPECT_EQ(expected.maxScore, result.maxScore);
+    EXPECT_EQ(expected.zdropped, result.zdropped);
+    EXPECT_EQ(expected.lastQueryPos, result.lastQueryPos);
+    EXPECT_EQ(expected.lastTargetPos, result.lastTargetPos);
+    EXPECT_EQ(expected.maxQueryPos, result.maxQueryPos);
+    EXPECT_EQ(expected.maxTargetPos, result.maxTargetPos);
+}
+
+TEST(AlignerKSW2, ReusedResultSameAsFreshAligner)
+{
+    /*
+     * One aligner and one result object are reused for alignments of varying lengths,
+     * in both modes. Each result has to be the same as the one of a new aligner.
+    */
+    std::mt19937 gen(29);
+    AlignmentParameters opt;
+    auto aligner = CreateAlignerKSW2(opt);
+    AlignmentResult result;
+
+    for (int32_t testId = 0; testId < 100; ++testId) {
+        const auto seqs = HelperRandomPair(gen, 1 + gen() % 2000, gen() % 10);
+        const std::string& query = seqs.first;
+        const std::string& target = seqs.second;
+        if (target.empty()) {
+            continue;
+        }
+        SCOPED_TRACE("testId = " + std::to_string(testId));
+
+        auto alignerFresh = CreateAlignerKSW2(opt);
+        if (testId % 2 == 0) {
+            const AlignmentResult expected =
+                alignerFresh->Global(query.c_str(), query.size(), target.c_str(), target.size());
+            aligner->GlobalInto(query.c_str(), query.size(), target.c_str(), target.size(), result);
+            HelperExpectSameResult(expected, result);
+        } else {
+            const AlignmentResult expected =
+                alignerFresh->Extend(query.c_str(), query.size(), target.c_str(), target.size());
+            aligner->ExtendInto(query.c_str(), query.size(), target.c_str(), target.size(), result);
+            HelperExpectSameResult(expected, result);
+        }
+    }
+}
+
+TEST(AlignerKSW2, GlobalBandDoubling)
+{
+    /*
+     * The spans are equal, but the path moves off the main diagonal because of a deletion
+     * which is later compensated by an insertion. With alignBandwidth = 10 the initial band
+     * is 16. The band is doubled only if the path comes within one diagonal of its edge.
+    */
+    std::mt19937 gen(31);
+    const std::string bases("ACGT");
+    const auto RandomSeq = [&](int32_t len) {
+        std::string seq;
+        for (int32_t i = 0; i < len; ++i) {
+            seq += bases[gen() % 4];
+        }
+        return seq;
+    };
+
+    AlignmentParameters optFull;
+    optFull.alignBandwidth = 1000;
+    AlignmentParameters opt;
+    opt.alignBandwidth = 10;
+
+    // clang-format off
+    std::vector<std::tuple<std::string, int32_t, int32_t, std::vector<int64_t>>> testData = {
+        // Test name, gap length, max bandwidth, expected band level counts.
+        {"GapWellWithinBand", 10, 10000, {1}},
+        {"GapTouchesBandEdge", 15, 10000, {0, 1}},
+        {"GapTouchesBandEdgeCapped", 15, 0, {1}},
+        {"GapBeyondBand", 40, 10000, {0, 0, 1}},
+    };
+    // clang-format on
+
+    for (const auto& data : testData) {
+        const std::string& testName = std::get<0>(data);
+        const int32_t gapLen = std::get<1>(data);
+        const std::vector<int64_t>& expectedCounts = std::get<3>(data);
+        SCOPED_TRACE(testName);
+
+        const std::string prefix = RandomSeq(200);
+        const std::string moved = RandomSeq(gapLen);
+        const std::string middle = RandomSeq(300);
+        const std::string suffix = RandomSeq(200);
+        const std::string query = prefix + moved + middle + suffix;
+        const std::string target = prefix + middle + moved + suffix;
+
+        auto alignerFull = CreateAlignerKSW2(optFull);
+        const AlignmentResult expected =
+            alignerFull->Global(query.c_str(), query.size(), target.c_str(), target.size());
+
+        opt.alignMaxBandwidth = std::get<2>(data);
+        auto aligner = std::make_shared<AlignerKSW2>(opt);
+        const AlignmentResult result =
+            aligner->Global(query.c_str(), query.size(), target.c_str(), target.size());
+
+        EXPECT_TRUE(result.valid);
+        EXPECT_EQ(expected.score, result.score);
+        EXPECT_EQ(expected.cigar, result.cigar);
+        EXPECT_EQ(expectedCounts, aligner->GetBandLevelCounts());
+
+        // The score-only alignment has to double the band the same way.
+        auto alignerScore = std::make_shared<AlignerKSW2>(opt);
+        AlignmentResult resultScore =
+            alignerScore->GlobalScore(query.c_str(), query.size(), target.c_str(), target.size());
+        EXPECT_TRUE(resultScore.cigar.empty());
+        EXPECT_EQ(expectedCounts, alignerScore->GetBandLevelCounts());
+        resultScore.cigar = result.cigar;
+        HelperExpectSameResult(result, resultScore);
+    }
+}
+
+TEST(AlignerKSW2, ScoreOnlySameAsWithTraceback)
+{
+    /*
+     * The score-only alignments skip the traceback, but have to end up with the same
+     * scores and positions.
+    */
+    std::mt19937 gen(37);
+    AlignmentParameters opt;
+    auto aligner = CreateAlignerKSW2(opt);
+
+    for (int32_t testId = 0; testId < 100; ++testId) {
+        const auto seqs = HelperRandomPair(gen, 1 + gen() % 1000, gen() % 10);
+        const std::string& query = seqs.first;
+        const std::string& target = seqs.second;
+        if (target.empty()) {
+            continue;
+        }
+        SCOPED_TRACE("testId = " + std::to_string(testId));
+
+        AlignmentResult expected;
+        AlignmentResult result;
+        if (testId % 2 == 0) {
+            expected = aligner->Global(query.c_str(), query.size(), target.c_str(), target.size());
+            result =
+                aligner->GlobalScore(query.c_str(), query.size(), target.c_str(), target.size());
+        } else {
+            expected = aligner->Extend(query.c_str(), query.size(), target.c_str(), target.size());
+            result =
+                aligner->ExtendScore(query.c_str(), query.size(), target.c_str(), target.size());
+        }
+        EXPECT_TRUE(result.cigar.empty());
+        expected.cigar.clear();
+        HelperExpectSameResult(expected, result);
+    }
+}
+
+}  // namespace Test
+}  // namespace Pancake
+}  // namespace PacBio
@@ -0,0 +1,106 @@
+// Authors: Ivan Sovic
+
+#include <PancakeTestHelpers.h>
+#include <gtest/gtest.h>
+#include <pacbio/pancake/AlignerFactory.h>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace PacBio {
+namespace Pancake {
+namespace Test {
+
+/*
+ * Generates a query and a target which differs from it only by mismatches, at least
+ * minSpacing bases apart, so that the optimal edit path has no indels.
+*/
+std::pair<std::string, std::string> HelperRandomMismatchPair(std::mt19937& gen, int32_t len,
+                                                             int32_t minSpacing)
+{
+    const std::string bases("ACGT");
+    std::string query;
+    for (int32_t i = 0; i < len; ++i) {
+        query += bases[gen() % 4];
+    }
+    std::string target = query;
+    for (int32_t i = gen() % minSpacing; i < len; i += minSpacing + gen() % minSpacing) {
+        target[i] = bases[(bases.find(query[i]) + 1 + gen() % 3) % 4];
+    }
+    return std::make_pair(query, target);
+}
+
+void HelperExpectSameGlobalScore(AlignerBasePtr& aligner, const std::string& query,
+                                 const std::string& target)
+{
+    const AlignmentResult expected =
+        aligner->Global(query.c_str(), query.size(), target.c_str(), target.size());
+    const AlignmentResult result =
+        aligner->GlobalScore(query.c_str(), query.size(), target.c_str(), target.size());
+    EXPECT_TRUE(result.cigar.empty());
+    EXPECT_EQ(expected.valid, result.valid);
+    EXPECT_EQ(expected.score, result.score);
+    EXPECT_EQ(expected.maxScore, result.maxScore);
+    EXPECT_EQ(expected.lastQueryPos, result.lastQueryPos);
+    EXPECT_EQ(expected.lastTargetPos, result.lastTargetPos);
+    EXPECT_EQ(expected.maxQueryPos, result.maxQueryPos);
+    EXPECT_EQ(expected.maxTargetPos, result.maxTargetPos);
+}
+
+TEST(AlignerScoreOnly, GlobalScoreSameAsGlobalForMismatches)
+{
+    /*
+     * Without the traceback, the edit distance aligners score the edits as mismatches,
+     * which is exact when the alignment has only mismatches.
+    */
+    // clang-format off
+    std::vector<std::tuple<std::string, AlignerType>> testData = {
+        {"Edlib", AlignerType::EDLIB},
+        {"SES1", AlignerType::SES1},
+        {"SES2", AlignerType::SES2},
+    };
+    // clang-format on
+
+    AlignmentParameters opt;
+    for (const auto& data : testData) {
+        SCOPED_TRACE(std::get<0>(data));
+        auto aligner = AlignerFactory(std::get<1>(data), opt);
+
+        {
+            SCOPED_TRACE("SingleMismatch");
+            const AlignmentResult result = aligner->GlobalScore("ACGTACGTAC", 10, "ACGTTCGTAC", 10);
+            EXPECT_EQ(14, result.score);
+            HelperExpectSameGlobalScore(aligner, "ACGTACGTAC", "ACGTTCGTAC");
+        }
+
+        std::mt19937 gen(53);
+        for (int32_t testId = 0; testId < 50; ++testId) {
+            SCOPED_TRACE("testId = " + std::to_string(testId));
+            const auto seqs = HelperRandomMismatchPair(gen, 1 + gen() % 1000, 10);
+            HelperExpectSameGlobalScore(aligner, seqs.first, seqs.second);
+        }
+    }
+}
+
+TEST(AlignerScoreOnly, GlobalScoreSameAsGlobalSES1)
+{
+    /*
+     * SES1 aligns the whole pair for the score, so the scores are the same with indels too.
+    */
+    AlignmentParameters opt;
+    auto aligner = AlignerFactory(AlignerType::SES1, opt);
+    std::mt19937 gen(59);
+    for (int32_t testId = 0; testId < 50; ++testId) {
+        SCOPED_TRACE("testId = " + std::to_string(testId));
+        const auto seqs = HelperRandomPair(gen, 1 + gen() % 1000, gen() % 10);
+        if (seqs.second.empty()) {
+            continue;
+        }
+        HelperExpectSameGlobalScore(aligner, seqs.first, seqs.second);
+    }
+}
+
+}  // namespace Test
+}  // namespace Pancake
+}  // namespace PacBio
@@ -0,0 +1,200 @@
+// Authors: Ivan Sovic
+
+#include <PancakeTestHelpers.h>
+#include <gtest/gtest.h>
+#include <pacbio/alignment/AlignmentTools.h>
+#include <pacbio/pancake/AlignerKSW2.h>
+#include <pacbio/pancake/AlignerWFA.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace PacBio {
+namespace Pancake {
+namespace Test {
+
+/*
+ * Scores the CIGAR the same way as KSW2 does: a gap of length l costs
+ * min(gapOpen1 + l * gapExtend1, gapOpen2 + l * gapExtend2).
+*/
+int32_t HelperScoreCigarDualAffine(const PacBio::Data::Cigar& cigar, const AlignmentParameters& opt)
+{
+    int32_t score = 0;
+    for (const auto& op : cigar) {
+        const int32_t len = op.Length();
+        const auto type = op.Type();
+        if (type == PacBio::Data::CigarOperationType::SEQUENCE_MATCH) {
+            score += len * opt.matchScore;
+        } else if (type == PacBio::Data::CigarOperationType::SEQUENCE_MISMATCH) {
+            score -= len * opt.mismatchPenalty;
+        } else if (type == PacBio::Data::CigarOperationType::INSERTION ||
+                   type == PacBio::Data::CigarOperationType::DELETION) {
+            score -=
+                std::min(opt.gapOpen1 + len * opt.gapExtend1, opt.gapOpen2 + len * opt.gapExtend2);
+        }
+    }
+    return score;
+}
+
+TEST(AlignerWFA, GlobalArrayOfTests)
+{
+    // clang-format off
+    std::vector<std::tuple<std::string, std::string, std::string, int32_t, std::string>>
+        testData = {
+        // Test name, query, target, expected score, expected CIGAR.
+        {"EmptyQueryEmptyTarget", "", "", 0, ""},
+        {"EmptyTarget", "ACGT", "", -12, "4I"},
+        {"EmptyQuery", "", "ACGT", -12, "4D"},
+        {"ExactMatch", "ACGTACGT", "ACGTACGT", 16, "8="},
+        {"SingleMismatch", "ACGTACGT", "ACGAACGT", 10, "3=1X4="},
+        {"SingleInsertion", "ACGTTACGT", "ACGTACGT", 10, "4=1I4="},
+        {"SingleDeletion", "ACGTACGT", "ACGTTACGT", 10, "4=1D4="},
+        {"LongDeletionUsesSecondGapPiece", "CAGTCAGGTCAGTTCAGC",
+                                           "CAGTCAGGTAAAAAAAAAAAAAAAAAAAAAAAAAAAAAACAGTTCAGC", -18,
+                                           "9=30D9="},
+    };
+    // clang-format on
+
+    AlignmentParameters opt;
+    for (const auto& data : testData) {
+        const std::string& testName = std::get<0>(data);
+        const std::string& query = std::get<1>(data);
+        const std::string& target = std::get<2>(data);
+        const int32_t expectedScore = std::get<3>(data);
+        const PacBio::Data::Cigar expectedCigar(std::get<4>(data));
+        SCOPED_TRACE(testName);
+
+        auto aligner = CreateAlignerWFA(opt);
+        const AlignmentResult result =
+            aligner->Global(query.c_str(), query.size(), target.c_str(), target.size());
+
+        EXPECT_TRUE(result.valid);
+        EXPECT_EQ(expectedScore, result.score);
+        EXPECT_EQ(expectedCigar, result.cigar);
+        EXPECT_EQ(static_cast<int32_t>(query.size()), result.lastQueryPos);
+        EXPECT_EQ(static_cast<int32_t>(target.size()), result.lastTargetPos);
+    }
+}
+
+TEST(AlignerWFA, InvalidParametersThrow)
+{
+    AlignmentParameters opt;
+    opt.matchScore = 2;
+    opt.mismatchPenalty = -3;
+    EXPECT_THROW(CreateAlignerWFA(opt), std::runtime_error);
+}
+
+TEST(AlignerWFA, GlobalRandomSameScoreAsKSW2)
+{
+    /*
+     * The alignments can differ on ties, but the scores of the optimal alignments
+     * have to be the same as in KSW2, and the CIGAR has to produce that score.
+    */
+    std::mt19937 gen(17);
+    std::vector<AlignmentParameters> params(2);
+    params[1].gapOpen2 = params[1].gapOpen1;
+    params[1].gapExtend2 = params[1].gapExtend1;
+
+    for (const auto& opt : params) {
+        auto alignerWFA = CreateAlignerWFA(opt);
+        auto alignerKSW2 = CreateAlignerKSW2(opt);
+
+        for (int32_t testId = 0; testId < 200; ++testId) {
+            const auto seqs = HelperRandomPair(gen, 1 + gen() % 500, gen() % 15, 5);
+            const std::string& query = seqs.first;
+            const std::string& target = seqs.second;
+            if (target.empty()) {
+                continue;
+            }
+            SCOPED_TRACE("testId = " + std::to_string(testId));
+
+            const AlignmentResult resultKSW2 =
+                alignerKSW2->Global(query.c_str(), query.size(), target.c_str(), target.size());
+            const AlignmentResult resultWFA =
+                alignerWFA->Global(query.c_str(), query.size(), target.c_str(), target.size());
+
+            ASSERT_TRUE(resultWFA.valid);
+            EXPECT_EQ(resultKSW2.score, resultWFA.score);
+            EXPECT_EQ(resultWFA.score, HelperScoreCigarDualAffine(resultWFA.cigar, opt));
+            EXPECT_NO_THROW(ValidateCigar(query.c_str(), query.size(), target.c_str(),
+                                          target.size(), resultWFA.cigar, "WFA"));
+        }
+    }
+}
+
+TEST(AlignerWFA, ExtendRandomSameMaxAsKSW2)
+{
+    /*
+     * Without the Z-drop, both aligners find the maximum scoring extension, and extend
+     * to the end of the query under the same condition.
+    */
+    std::mt19937 gen(19);
+    AlignmentParameters opt;
+    opt.zdrop = -1;
+    auto alignerWFA = CreateAlignerWFA(opt);
+    auto alignerKSW2 = CreateAlignerKSW2(opt);
+
+    for (int32_t testId = 0; testId < 200; ++testId) {
+        auto seqs = HelperRandomPair(gen, 1 + gen() % 500, gen() % 15, 5);
+        const std::string& query = seqs.first;
+        std::string& target = seqs.second;
+        // Extensions end somewhere within the target, so add some random bases to it.
+        for (int32_t i = gen() % 50; i > 0; --i) {
+            target += "ACGT"[gen() % 4];
+        }
+        SCOPED_TRACE("testId = " + std::to_string(testId));
+
+        const AlignmentResult resultKSW2 =
+            alignerKSW2->Extend(query.c_str(), query.size(), target.c_str(), target.size());
+        const AlignmentResult resultWFA =
+            alignerWFA->Extend(query.c_str(), query.size(), target.c_str(), target.size());
+
+        EXPECT_EQ(resultKSW2.valid, resultWFA.valid);
+        EXPECT_EQ(resultKSW2.maxScore, resultWFA.maxScore);
+        EXPECT_EQ(resultWFA.score, HelperScoreCigarDualAffine(resultWFA.cigar, opt));
+        EXPECT_NO_THROW(ValidateCigar(query.c_str(), resultWFA.lastQueryPos, target.c_str(),
+                                      resultWFA.lastTargetPos, resultWFA.cigar, "WFA"));
+        if (resultWFA.valid) {
+            EXPECT_EQ(static_cast<int32_t>(query.size()), resultWFA.lastQueryPos);
+        }
+    }
+}
+
+TEST(AlignerWFA, ExtendStopsOnDivergentSuffix)
+{
+    /*
+     * Both sequences share a 200bp prefix, followed by unrelated bases. The X-drop
+     * should stop the extension, which ends at the end of the shared prefix.
+    */
+    std::mt19937 gen(23);
+    const std::string bases("ACGT");
+    std::string prefix;
+    for (int32_t i = 0; i < 200; ++i) {
+        prefix += bases[gen() % 4];
+    }
+    std::string query = prefix;
+    std::string target = prefix;
+    for (int32_t i = 0; i < 1000; ++i) {
+        query += bases[gen() % 4];
+        target += bases[gen() % 4];
+    }
+
+    AlignmentParameters opt;
+    auto aligner = CreateAlignerWFA(opt);
+    const AlignmentResult result =
+        aligner->Extend(query.c_str(), query.size(), target.c_str(), target.size());
+
+    EXPECT_FALSE(result.valid);
+    EXPECT_TRUE(result.zdropped);
+    EXPECT_GE(result.lastQueryPos, 200);
+    EXPECT_LT(result.lastQueryPos, 220);
+    EXPECT_GE(result.maxScore, 400);
+    EXPECT_EQ(result.maxScore, result.score);
+    EXPECT_EQ(result.score, HelperScoreCigarDualAffine(result.cigar, opt));
+}
+
+}  // namespace Test
+}  // namespace Pancake
+}  // namespace PacBio
@@ -1,10 +1,12 @@
 #include <gtest/gtest.h>
 
+#include <pacbio/pancake/AlignerBatchExecutor.h>
 #include <pacbio/pancake/AlignmentSeeded.h>
 #include <pacbio/pancake/Overlap.h>
 #include <pacbio/pancake/OverlapWriterBase.h>
 
 #include <cstdint>
+#include <random>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -653,4 +655,171 @@ TEST(AlignmentSeeded, AlignmentSeeded_ArrayOfTests)
             EXPECT_EQ(data.expectedOvl, *result);
         }
     }
-}
\ No newline at end of file
+}
+
+TEST(AlignmentSeeded, AlignmentSeeded_ParallelSameAsSerial)
+{
+    /*
+     * A long mapping is aligned once with a single global aligner, and once with the
+     * internal regions spread over a thread pool. The overlaps need to be identical.
+     * The query has random mismatches and indels, apart from 20bp windows every 1000bp
+     * of the target which are copied exactly and used as seed hits.
+    */
+    std::mt19937 gen(43);
+    const std::string bases("ACGT");
+    std::string targetSeq;
+    for (int32_t i = 0; i < 60000; ++i) {
+        targetSeq += bases[gen() % 4];
+    }
+    std::string querySeq;
+    std::vector<SeedHit> sortedHits;
+    for (int32_t i = 0; i < static_cast<int32_t>(targetSeq.size()); ++i) {
+        if ((i % 1000) == 0) {
+            // targetId, targetRev, targetPos, queryPos, targetSpan, querySpan, flags
+            sortedHits.emplace_back(SeedHit(0, false, i, querySeq.size(), 15, 15, 0));
+        }
+        const int32_t r = gen() % 100;
+        if ((i % 1000) < 20 || r >= 6) {
+            querySeq += targetSeq[i];
+        } else if (r < 3) {
+            querySeq += bases[gen() % 4];
+        } else if (r < 5) {
+            querySeq += bases[gen() % 4];
+            querySeq += targetSeq[i];
+        }
+    }
+    const std::string querySeqRev =
+        PacBio::Pancake::ReverseComplement(querySeq, 0, querySeq.size());
+    const Overlap ovl(0, 0, 0.0, 0.0, false, sortedHits.front().queryPos,
+                      sortedHits.back().queryPos, querySeq.size(), false,
+                      sortedHits.front().targetPos, sortedHits.back().targetPos, targetSeq.size());
+
+    AlignmentParameters alnParams;
+    AlignerBasePtr alignerSerial = AlignerFactory(AlignerType::KSW2, alnParams);
+    AlignerBasePtr alignerParallel =
+        std::make_shared<AlignerBatchExecutor>(AlignerType::KSW2, alnParams, 4);
+    AlignerBasePtr alignerExt = AlignerFactory(AlignerType::KSW2, alnParams);
+
+    OverlapPtr resultSerial = AlignmentSeeded(
+        createOverlap(ovl), sortedHits, targetSeq.c_str(), targetSeq.size(), querySeq.c_str(),
+        querySeqRev.c_str(), querySeq.size(), 200, 5000, alignerSerial, alignerExt);
+    OverlapPtr resultParallel = AlignmentSeeded(
+        createOverlap(ovl), sortedHits, targetSeq.c_str(), targetSeq.size(), querySeq.c_str(),
+        querySeqRev.c_str(), querySeq.size(), 200, 5000, alignerParallel, alignerExt);
+
+    ASSERT_NE(nullptr, resultSerial);
+    ASSERT_NE(nullptr, resultParallel);
+    EXPECT_FALSE(resultSerial->Cigar.empty());
+    EXPECT_EQ(*resultSerial, *resultParallel);
+}
+
+TEST(AlignmentSeeded, AlignmentSeeded_RegionFastPaths)
+{
+    /*
+     * Three internal regions: an exact match, a single substitution, and a region with
+     * many substitutions and an insertion. Each should be aligned by a different tier.
+     * Disabling the fast paths has to give the same overlap, with all regions aligned
+     * by the global aligner.
+    */
+    std::mt19937 gen(47);
+    const std::string bases("ACGT");
+    std::string targetSeq;
+    for (int32_t i = 0; i < 1600; ++i) {
+        targetSeq += bases[gen() % 4];
+    }
+    std::string querySeq = targetSeq;
+    querySeq[700] = (querySeq[700] == 'A') ? 'C' : 'A';
+    for (int32_t i = 1010; i < 1490; i += 20) {
+        querySeq[i] = (querySeq[i] == 'G') ? 'T' : 'G';
+    }
+    querySeq.insert(querySeq.begin() + 1200, 'A');
+
+    // targetId, targetRev, targetPos, queryPos, targetSpan, querySpan, flags
+    const std::vector<SeedHit> sortedHits = {
+        SeedHit(0, false, 0, 0, 15, 15, 0), SeedHit(0, false, 500, 500, 15, 15, 0),
+        SeedHit(0, false, 1000, 1000, 15, 15, 0), SeedHit(0, false, 1500, 1501, 15, 15, 0),
+    };
+    const std::string querySeqRev =
+        PacBio::Pancake::ReverseComplement(querySeq, 0, querySeq.size());
+    const Overlap ovl(0, 0, 0.0, 0.0, false, sortedHits.front().queryPos,
+                      sortedHits.back().queryPos, querySeq.size(), false,
+                      sortedHits.front().targetPos, sortedHits.back().targetPos, targetSeq.size());
+
+    AlignmentParameters alnParams;
+    AlignerBasePtr alignerGlobal = AlignerFactory(AlignerType::KSW2, alnParams);
+    AlignerBasePtr alignerExt = AlignerFactory(AlignerType::KSW2, alnParams);
+
+    // The same scratch is reused for both alignments.
+    AlignRegionsGenericScratch scratch;
+
+    RegionAlignmentCounts countsFast;
+    OverlapPtr resultFast = AlignmentSeeded(
+        createOverlap(ovl), sortedHits, targetSeq.c_str(), targetSeq.size(), querySeq.c_str(),
+        querySeqRev.c_str(), querySeq.size(), 200, 5000, alignerGlobal, alignerExt,
+        DEFAULT_REGION_FAST_PATH_MAX_DIFFS, alnParams, scratch, countsFast);
+
+    RegionAlignmentCounts countsAligner;
+    OverlapPtr resultAligner =
+        AlignmentSeeded(createOverlap(ovl), sortedHits, targetSeq.c_str(), targetSeq.size(),
+                        querySeq.c_str(), querySeqRev.c_str(), querySeq.size(), 200, 5000,
+                        alignerGlobal, alignerExt, -1, alnParams, scratch, countsAligner);
+
+    ASSERT_NE(nullptr, resultFast);
+    ASSERT_NE(nullptr, resultAligner);
+    EXPECT_EQ(*resultAligner, *resultFast);
+    EXPECT_EQ("700=1X", resultFast->Cigar.ToStdString().substr(0, 6));
+
+    EXPECT_EQ(1, countsFast.numExact);
+    EXPECT_EQ(1, countsFast.numSES);
+    EXPECT_EQ(1, countsFast.numAligner);
+
+    EXPECT_EQ(0, countsAligner.numExact);
+    EXPECT_EQ(0, countsAligner.numSES);
+    EXPECT_EQ(3, countsAligner.numAligner);
+}
+
+TEST(AlignmentSeeded, AlignSingleRegion_FastPathScore)
+{
+    /*
+     * The fast paths score their CIGARs in the same way as the global aligner for
+     * an exact match and for mismatches.
+    */
+    const std::string targetSeq = "ACTGACTGAAGGTTCCAAGGTTCCACTGACTG";
+    std::string querySeq = targetSeq;
+    querySeq[10] = 'T';
+    const std::string querySeqRev =
+        PacBio::Pancake::ReverseComplement(querySeq, 0, querySeq.size());
+
+    AlignmentParameters alnParams;
+    AlignerBasePtr alignerGlobal = AlignerFactory(AlignerType::KSW2, alnParams);
+    AlignerBasePtr alignerExt = AlignerFactory(AlignerType::KSW2, alnParams);
+    auto sesScratch = std::make_shared<Alignment::SESScratchSpace>();
+
+    // qStart, qSpan, tStart, tSpan, queryRev, type, regionId
+    const std::vector<AlignmentRegion> regions = {
+        {0, 8, 0, 8, false, RegionType::GLOBAL, 0}, {0, 20, 0, 20, false, RegionType::GLOBAL, 1},
+    };
+
+    RegionAlignmentCounts counts;
+    for (const auto& region : regions) {
+        SCOPED_TRACE("regionId = " + std::to_string(region.regionId));
+        AlignmentResult result;
+        AlignSingleRegion(targetSeq.c_str(), targetSeq.size(), querySeq.c_str(),
+                          querySeqRev.c_str(), querySeq.size(), alignerGlobal, alignerExt, region,
+                          DEFAULT_REGION_FAST_PATH_MAX_DIFFS, alnParams, sesScratch, result,
+                          counts);
+        const AlignmentResult expected =
+            alignerGlobal->Global(querySeq.c_str() + region.qStart, region.qSpan,
+                                  targetSeq.c_str() + region.tStart, region.tSpan);
+        EXPECT_EQ(expected.cigar, result.cigar);
+        EXPECT_EQ(expected.score, result.score);
+        EXPECT_EQ(expected.lastQueryPos, result.lastQueryPos);
+        EXPECT_EQ(expected.lastTargetPos, result.lastTargetPos);
+        // The max positions point to the last aligned bases, as they do for KSW2 extension.
+        EXPECT_EQ(region.qSpan - 1, result.maxQueryPos);
+        EXPECT_EQ(region.tSpan - 1, result.maxTargetPos);
+    }
+    EXPECT_EQ(1, counts.numExact);
+    EXPECT_EQ(1, counts.numSES);
+    EXPECT_EQ(0, counts.numAligner);
+}
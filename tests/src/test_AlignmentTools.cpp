@@ -1122,4 +1122,53 @@ TEST(Test_AlignmentTools_ScoreCigarAlignment, ArrayOfTests)
         EXPECT_EQ(data.expectedScore, result);
     }
 }
+
+TEST(Test_AlignmentTools_ScoreEditDistance, ArrayOfTests)
+{
+    // clang-format off
+    struct TestDataStruct {
+        std::string name;
+        int32_t editDistance = 0;
+        int32_t queryLen = 0;
+        int32_t targetLen = 0;
+        int32_t expectedScore = 0;
+    };
+    // Scores: match = 8, mismatch = 4, gapOpen = 4, gapExtend = 2.
+    std::vector<TestDataStruct> testData = {
+        {"Empty input", 0, 0, 0, 0},
+        {"Exact match", 0, 1000, 1000, 8000},
+        {"Only mismatches", 10, 1000, 1000, 990 * 8 - 10 * 4},
+        {"Only the span difference", 5, 1000, 995, 995 * 8 - (4 + 4 * 2)},
+        {"Span difference and mismatches", 7, 995, 1000, 993 * 8 - 2 * 4 - (4 + 4 * 2)},
+        {"Empty target", 10, 10, 0, -(4 + 9 * 2)},
+    };
+    // clang-format on
+
+    for (const auto& data : testData) {
+        // Name the test.
+        SCOPED_TRACE("ScoreEditDistance-" + data.name);
+
+        const int32_t result = PacBio::Pancake::ScoreEditDistance(data.editDistance, data.queryLen,
+                                                                  data.targetLen, 8, 4, 4, 2);
+        EXPECT_EQ(data.expectedScore, result);
+
+        // Must be the same as the score of the CIGAR with mismatches and one gap at the end.
+        const int32_t numX = data.editDistance - std::abs(data.queryLen - data.targetLen);
+        const int32_t numEq = std::min(data.queryLen, data.targetLen) - numX;
+        std::ostringstream oss;
+        if (numEq > 0) {
+            oss << numEq << "=";
+        }
+        if (numX > 0) {
+            oss << numX << "X";
+        }
+        if (data.queryLen != data.targetLen) {
+            oss << std::abs(data.queryLen - data.targetLen)
+                << (data.queryLen > data.targetLen ? "I" : "D");
+        }
+        const int32_t cigarScore =
+            PacBio::Pancake::ScoreCigarAlignment(PacBio::BAM::Cigar(oss.str()), 8, 4, 4, 2);
+        EXPECT_EQ(cigarScore, result);
+    }
+}
 }
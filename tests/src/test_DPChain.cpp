@@ -1,8 +1,12 @@
 #include <gtest/gtest.h>
 
 #include <pacbio/pancake/DPChain.h>
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
+#include <random>
+#include <string>
+#include <tuple>
 #include <vector>
 
 using namespace PacBio::Pancake;
@@ -308,3 +312,146 @@ TEST(DPChain, DiagonalGroup_ArrayOfTests)
         }
     }
 }
+
+TEST(DPChain, ChainHits_SIMDSameAsScalar)
+{
+    /*
+     * Chaining with the vectorized predecessor scan should produce exactly
+     * the same chains as the scalar scan. The hits are dense around a few
+     * diagonals on two targets and both strands, with some noise, so that
+     * all of the break and skip conditions of the scan get exercised.
+    */
+    std::mt19937 gen(1234);
+    std::uniform_int_distribution<int32_t> distNoise(-30, 30);
+    std::uniform_int_distribution<int32_t> distStep(1, 40);
+    std::uniform_int_distribution<int32_t> distSpan(10, 20);
+    std::uniform_int_distribution<int32_t> distDiag(0, 3);
+
+    std::vector<SeedHit> hits;
+    for (int32_t targetId = 0; targetId < 2; ++targetId) {
+        for (const bool targetRev : {false, true}) {
+            int32_t queryPos = 0;
+            for (int32_t i = 0; i < 1500; ++i) {
+                queryPos += distStep(gen);
+                const int32_t diag = distDiag(gen) * 2000 + distNoise(gen);
+                const int32_t span = distSpan(gen);
+                hits.emplace_back(
+                    SeedHit(targetId, targetRev, queryPos + diag, queryPos, span, span, 0));
+            }
+        }
+    }
+    std::sort(hits.begin(), hits.end(), [](const SeedHit& a, const SeedHit& b) {
+        return std::make_tuple(a.targetId, a.targetRev, a.targetPos, a.queryPos) <
+               std::make_tuple(b.targetId, b.targetRev, b.targetPos, b.queryPos);
+    });
+
+    // Tuple: <chainMaxSkip, chainMaxPredecessors, seedJoinDist, diagMargin>
+    const std::vector<std::tuple<int32_t, int32_t, int32_t, int32_t>> params = {
+        {25, 500, 10000, 500}, {1, 500, 10000, 500}, {25, 0, 10000, 500},
+        {25, 7, 10000, 500},   {25, 500, 200, 50},   {1000, 1000, 10000, 5000},
+    };
+
+    for (const auto& param : params) {
+        const auto[chainMaxSkip, chainMaxPredecessors, seedJoinDist, diagMargin] = param;
+        SCOPED_TRACE("chainMaxSkip = " + std::to_string(chainMaxSkip) +
+                     ", chainMaxPredecessors = " + std::to_string(chainMaxPredecessors));
+
+        const std::vector<ChainedHits> expected =
+            ChainHits(hits.data(), hits.size(), chainMaxSkip, chainMaxPredecessors, seedJoinDist,
+                      diagMargin, 3, 0, 0, false);
+        const std::vector<ChainedHits> result =
+            ChainHits(hits.data(), hits.size(), chainMaxSkip, chainMaxPredecessors, seedJoinDist,
+                      diagMargin, 3, 0, 0, true);
+
+        ASSERT_FALSE(expected.empty());
+        ASSERT_EQ(expected.size(), result.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            EXPECT_EQ(expected[i].targetId, result[i].targetId);
+            EXPECT_EQ(expected[i].targetRev, result[i].targetRev);
+            EXPECT_EQ(expected[i].score, result[i].score);
+            EXPECT_EQ(expected[i].coveredBasesQuery, result[i].coveredBasesQuery);
+            EXPECT_EQ(expected[i].coveredBasesTarget, result[i].coveredBasesTarget);
+            EXPECT_EQ(expected[i].hits, result[i].hits);
+        }
+    }
+}
+
+TEST(DPChain, ChainHitsRMQ_CollinearSameAsChainHits)
+{
+    /*
+     * On clean collinear hits, the RMQ chaining should produce the same chains
+     * as the regular chaining, separately for each target and strand.
+    */
+    std::vector<SeedHit> hits;
+    for (int32_t targetId = 0; targetId < 2; ++targetId) {
+        for (const bool targetRev : {false, true}) {
+            for (int32_t i = 0; i < 100; ++i) {
+                hits.emplace_back(SeedHit(targetId, targetRev, 1000 + i * 20, i * 20, 15, 15, 0));
+            }
+        }
+    }
+
+    const std::vector<ChainedHits> expected =
+        ChainHits(hits.data(), hits.size(), 25, 500, 10000, 500, 3, 0, 0);
+    const std::vector<ChainedHits> result =
+        ChainHitsRMQ(hits.data(), hits.size(), 32, 10000, 500, 3, 0, 0);
+
+    ASSERT_EQ(4, expected.size());
+    ASSERT_EQ(expected.size(), result.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i].targetId, result[i].targetId);
+        EXPECT_EQ(expected[i].targetRev, result[i].targetRev);
+        EXPECT_EQ(expected[i].score, result[i].score);
+        EXPECT_EQ(expected[i].hits, result[i].hits);
+    }
+
+    // Empty input.
+    EXPECT_TRUE(ChainHitsRMQ(nullptr, 0, 32, 10000, 500, 3, 0, 0).empty());
+}
+
+TEST(DPChain, ChainHitsRMQ_BridgesGapOverManyUnrelatedHits)
+{
+    /*
+     * Two collinear blocks of hits are separated by a long gap, which contains
+     * more unrelated hits than chainMaxPredecessors. The regular chaining cannot
+     * reach the first block from the second one, but the RMQ chaining finds the
+     * predecessor regardless of the number of hits in between.
+     * The unrelated hits are within the query and target distance of the second
+     * block, but off its diagonal, so they are never valid predecessors. They are
+     * further along the query and target than the first block, so the RMQ would
+     * prefer them if it ignored the diagonal.
+    */
+    std::vector<SeedHit> hits;
+    for (int32_t i = 0; i < 50; ++i) {
+        hits.emplace_back(SeedHit(0, false, i * 20, i * 20, 15, 15, 0));
+    }
+    for (int32_t i = 0; i < 600; ++i) {
+        const int32_t targetPos = 1000 + i * 5;
+        const int32_t queryPos = (i % 2 == 0) ? (targetPos + 600 + (i * 7919) % 1500)
+                                              : (targetPos - 600 - (i * 7919) % 400);
+        hits.emplace_back(SeedHit(0, false, targetPos, queryPos, 15, 15, 0));
+    }
+    for (int32_t i = 0; i < 50; ++i) {
+        hits.emplace_back(SeedHit(0, false, 4000 + i * 20, 4000 + i * 20, 15, 15, 0));
+    }
+
+    // The unrelated hits can chain among themselves, so only the chain which
+    // ends in the second block is checked.
+    const SeedHit lastHit = hits.back();
+    auto ChainLengthOfLastHit = [&lastHit](const std::vector<ChainedHits>& chains) {
+        for (const auto& chain : chains) {
+            if (chain.hits.empty() == false && chain.hits.back() == lastHit) {
+                return chain.hits.size();
+            }
+        }
+        return static_cast<size_t>(0);
+    };
+
+    const std::vector<ChainedHits> resultRegular =
+        ChainHits(hits.data(), hits.size(), 25, 500, 10000, 500, 3, 0, 0);
+    const std::vector<ChainedHits> resultRMQ =
+        ChainHitsRMQ(hits.data(), hits.size(), 32, 10000, 500, 3, 0, 0);
+
+    EXPECT_EQ(50, ChainLengthOfLastHit(resultRegular));
+    EXPECT_EQ(100, ChainLengthOfLastHit(resultRMQ));
+}
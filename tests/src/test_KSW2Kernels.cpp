@@ -0,0 +1,258 @@
+// Authors: Ivan Sovic
+
+#include <gtest/gtest.h>
+#include <lib/ksw2/kalloc.h>
+#include <lib/ksw2/ksw2.h>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * The AVX2 and AVX-512 kernels are only compiled when the runtime dispatcher is built,
+ * and are called here directly, so that each of them is compared against the SSE4.1
+ * kernel regardless of which one the dispatcher would pick on this CPU.
+*/
+#if defined(KSW_CPU_DISPATCH) && (defined(KSW_AVX2_DISPATCH) || defined(KSW_AVX512_DISPATCH))
+
+void ksw_extz2_sse41(void* km, int qlen, const uint8_t* query, int tlen, const uint8_t* target,
+                     int8_t m, const int8_t* mat, int8_t q, int8_t e, int w, int zdrop,
+                     int end_bonus, int flag, ksw_extz_t* ez);
+void ksw_extd2_sse41(void* km, int qlen, const uint8_t* query, int tlen, const uint8_t* target,
+                     int8_t m, const int8_t* mat, int8_t q, int8_t e, int8_t q2, int8_t e2, int w,
+                     int zdrop, int end_bonus, int flag, ksw_extz_t* ez);
+void ksw_exts2_sse41(void* km, int qlen, const uint8_t* query, int tlen, const uint8_t* target,
+                     int8_t m, const int8_t* mat, int8_t q, int8_t e, int8_t q2, int8_t noncan,
+                     int zdrop, int flag, ksw_extz_t* ez);
+#ifdef KSW_AVX2_DISPATCH
+void ksw_extz2_avx2(void* km, int qlen, const uint8_t* query, int tlen, const uint8_t* target,
+                    int8_t m, const int8_t* mat, int8_t q, int8_t e, int w, int zdrop,
+                    int end_bonus, int flag, ksw_extz_t* ez);
+void ksw_extd2_avx2(void* km, int qlen, const uint8_t* query, int tlen, const uint8_t* target,
+                    int8_t m, const int8_t* mat, int8_t q, int8_t e, int8_t q2, int8_t e2, int w,
+                    int zdrop, int end_bonus, int flag, ksw_extz_t* ez);
+void ksw_exts2_avx2(void* km, int qlen, const uint8_t* query, int tlen, const uint8_t* target,
+                    int8_t m, const int8_t* mat, int8_t q, int8_t e, int8_t q2, int8_t noncan,
+                    int zdrop, int flag, ksw_extz_t* ez);
+#endif
+#ifdef KSW_AVX512_DISPATCH
+void ksw_extz2_avx512(void* km, int qlen, const uint8_t* query, int tlen, const uint8_t* target,
+                      int8_t m, const int8_t* mat, int8_t q, int8_t e, int w, int zdrop,
+                      int end_bonus, int flag, ksw_extz_t* ez);
+void ksw_extd2_avx512(void* km, int qlen, const uint8_t* query, int tlen, const uint8_t* target,
+                      int8_t m, const int8_t* mat, int8_t q, int8_t e, int8_t q2, int8_t e2, int w,
+                      int zdrop, int end_bonus, int flag, ksw_extz_t* ez);
+void ksw_exts2_avx512(void* km, int qlen, const uint8_t* query, int tlen, const uint8_t* target,
+                      int8_t m, const int8_t* mat, int8_t q, int8_t e, int8_t q2, int8_t noncan,
+                      int zdrop, int flag, ksw_extz_t* ez);
+#endif
+
+namespace PacBio {
+namespace Pancake {
+namespace Test {
+
+using KSWExtz2Func = void (*)(void*, int, const uint8_t*, int, const uint8_t*, int8_t,
+                              const int8_t*, int8_t, int8_t, int, int, int, int, ksw_extz_t*);
+using KSWExtd2Func = void (*)(void*, int, const uint8_t*, int, const uint8_t*, int8_t,
+                              const int8_t*, int8_t, int8_t, int8_t, int8_t, int, int, int, int,
+                              ksw_extz_t*);
+using KSWExts2Func = void (*)(void*, int, const uint8_t*, int, const uint8_t*, int8_t,
+                              const int8_t*, int8_t, int8_t, int8_t, int8_t, int, int, ksw_extz_t*);
+
+/*
+ * A random query encoded as 0-3 (with rare 'N' bases encoded as 4), and a target which
+ * differs from it by mismatches, insertions and deletions with the error rate in percent.
+*/
+std::pair<std::vector<uint8_t>, std::vector<uint8_t>> HelperRandomEncodedPair(std::mt19937& gen,
+                                                                              int32_t len,
+                                                                              int32_t errorRate)
+{
+    std::vector<uint8_t> query(len);
+    for (auto& c : query) {
+        c = (gen() % 50 == 0) ? 4 : (gen() % 4);
+    }
+    std::vector<uint8_t> target;
+    for (const uint8_t c : query) {
+        const int32_t r = gen() % 100;
+        if (r < errorRate) {
+            target.emplace_back(gen() % 4);
+        } else if (r < 2 * errorRate) {
+            target.emplace_back(gen() % 4);
+            target.emplace_back(c);
+        } else if (r >= 3 * errorRate) {
+            target.emplace_back(c);
+        }
+    }
+    if (target.empty()) {
+        target.emplace_back(0);
+    }
+    return std::make_pair(query, target);
+}
+
+void HelperExpectSameExtz(const ksw_extz_t& expected, const ksw_extz_t& result)
+{
+    EXPECT_EQ(expected.max, result.max);
+    EXPECT_EQ(expected.zdropped, result.zdropped);
+    EXPECT_EQ(expected.max_q, result.max_q);
+    EXPECT_EQ(expected.max_t, result.max_t);
+    EXPECT_EQ(expected.mqe, result.mqe);
+    EXPECT_EQ(expected.mqe_t, result.mqe_t);
+    EXPECT_EQ(expected.mte, result.mte);
+    EXPECT_EQ(expected.mte_q, result.mte_q);
+    EXPECT_EQ(expected.score, result.score);
+    EXPECT_EQ(expected.reach_end, result.reach_end);
+    EXPECT_EQ(std::vector<uint32_t>(expected.cigar, expected.cigar + expected.n_cigar),
+              std::vector<uint32_t>(result.cigar, result.cigar + result.n_cigar));
+}
+
+/*
+ * Runs the SSE4.1 kernels and the given wide kernels on the same random pairs, in the
+ * global and in the extension mode, and checks that the results are identical.
+*/
+void HelperCompareKernels(KSWExtz2Func extz2, KSWExtd2Func extd2, uint32_t seed)
+{
+    std::mt19937 gen(seed);
+    void* km = km_init();
+
+    for (int32_t testId = 0; testId < 300; ++testId) {
+        const auto seqs = HelperRandomEncodedPair(gen, 1 + gen() % 2000, gen() % 15);
+        const std::vector<uint8_t>& query = seqs.first;
+        const std::vector<uint8_t>& target = seqs.second;
+
+        const int8_t a = 2;
+        const int8_t b = 4;
+        std::vector<int8_t> mat(25, 0);
+        for (int32_t i = 0; i < 4; ++i) {
+            for (int32_t j = 0; j < 4; ++j) {
+                mat[i * 5 + j] = (i == j) ? a : -b;
+            }
+            mat[i * 5 + 4] = mat[4 * 5 + i] = -1;
+        }
+        const int32_t w = (testId % 3 == 0) ? -1 : (gen() % 500);
+        const int32_t zdrop = (testId % 2 == 0) ? -1 : 100 + gen() % 300;
+        const int32_t endBonus = (testId % 2 == 0) ? 0 : 50;
+        const int32_t flag = (testId % 2 == 0) ? 0 : KSW_EZ_EXTZ_ONLY;
+        SCOPED_TRACE("testId = " + std::to_string(testId) + ", qlen = " +
+                     std::to_string(query.size()) + ", tlen = " + std::to_string(target.size()) +
+                     ", w = " + std::to_string(w) + ", flag = " + std::to_string(flag));
+
+        ksw_extz_t expected;
+        ksw_extz_t result;
+        std::memset(&expected, 0, sizeof(expected));
+        std::memset(&result, 0, sizeof(result));
+
+        ksw_extz2_sse41(km, query.size(), query.data(), target.size(), target.data(), 5, mat.data(),
+                        4, 2, w, zdrop, endBonus, flag, &expected);
+        extz2(km, query.size(), query.data(), target.size(), target.data(), 5, mat.data(), 4, 2, w,
+              zdrop, endBonus, flag, &result);
+        HelperExpectSameExtz(expected, result);
+
+        ksw_extd2_sse41(km, query.size(), query.data(), target.size(), target.data(), 5, mat.data(),
+                        4, 2, 24, 1, w, zdrop, endBonus, flag, &expected);
+        extd2(km, query.size(), query.data(), target.size(), target.data(), 5, mat.data(), 4, 2, 24,
+              1, w, zdrop, endBonus, flag, &result);
+        HelperExpectSameExtz(expected, result);
+
+        kfree(km, expected.cigar);
+        kfree(km, result.cigar);
+    }
+
+    km_destroy(km);
+}
+
+/*
+ * Same as HelperCompareKernels, for the spliced kernels. An intron with the forward
+ * (GT..AG) or the reverse (CT..AC) splice signals is inserted into each target, and the
+ * kernels are run with the splice flags.
+*/
+void HelperCompareSpliceKernels(KSWExts2Func exts2, uint32_t seed)
+{
+    std::mt19937 gen(seed);
+    void* km = km_init();
+
+    // clang-format off
+    const std::vector<int32_t> flags = {
+        KSW_EZ_SPLICE_FOR,
+        KSW_EZ_SPLICE_REV,
+        KSW_EZ_SPLICE_FOR | KSW_EZ_SPLICE_FLANK,
+        KSW_EZ_SPLICE_REV | KSW_EZ_SPLICE_FLANK | KSW_EZ_RIGHT,
+        KSW_EZ_SPLICE_FOR | KSW_EZ_SPLICE_REV | KSW_EZ_APPROX_MAX,
+        KSW_EZ_SPLICE_FOR | KSW_EZ_EXTZ_ONLY,
+    };
+    // clang-format on
+
+    for (int32_t testId = 0; testId < 120; ++testId) {
+        const auto seqs = HelperRandomEncodedPair(gen, 1 + gen() % 1000, gen() % 10);
+        const std::vector<uint8_t>& query = seqs.first;
+        std::vector<uint8_t> target = seqs.second;
+
+        const bool rev = (gen() % 2) == 1;
+        std::vector<uint8_t> intron = {static_cast<uint8_t>(rev ? 1 : 2), 3};
+        for (int32_t i = 20 + gen() % 300; i > 0; --i) {
+            intron.emplace_back(gen() % 4);
+        }
+        intron.emplace_back(0);
+        intron.emplace_back(rev ? 1 : 2);
+        target.insert(target.begin() + gen() % (target.size() + 1), intron.begin(), intron.end());
+
+        const int8_t a = 1;
+        const int8_t b = 2;
+        std::vector<int8_t> mat(25, 0);
+        for (int32_t i = 0; i < 4; ++i) {
+            for (int32_t j = 0; j < 4; ++j) {
+                mat[i * 5 + j] = (i == j) ? a : -b;
+            }
+            mat[i * 5 + 4] = mat[4 * 5 + i] = -1;
+        }
+        const int32_t zdrop = (testId % 2 == 0) ? -1 : 200 + gen() % 200;
+        const int32_t flag = flags[testId % flags.size()];
+        SCOPED_TRACE("testId = " + std::to_string(testId) + ", qlen = " +
+                     std::to_string(query.size()) + ", tlen = " + std::to_string(target.size()) +
+                     ", flag = " + std::to_string(flag));
+
+        ksw_extz_t expected;
+        ksw_extz_t result;
+        std::memset(&expected, 0, sizeof(expected));
+        std::memset(&result, 0, sizeof(result));
+
+        ksw_exts2_sse41(km, query.size(), query.data(), target.size(), target.data(), 5, mat.data(),
+                        2, 1, 32, 9, zdrop, flag, &expected);
+        exts2(km, query.size(), query.data(), target.size(), target.data(), 5, mat.data(), 2, 1, 32,
+              9, zdrop, flag, &result);
+        HelperExpectSameExtz(expected, result);
+
+        kfree(km, expected.cigar);
+        kfree(km, result.cigar);
+    }
+
+    km_destroy(km);
+}
+
+#ifdef KSW_AVX2_DISPATCH
+TEST(KSW2Kernels, AVX2SameAsSSE41)
+{
+    if (__builtin_cpu_supports("avx2") == 0) {
+        return;
+    }
+    HelperCompareKernels(ksw_extz2_avx2, ksw_extd2_avx2, 11);
+    HelperCompareSpliceKernels(ksw_exts2_avx2, 17);
+}
+#endif
+
+#ifdef KSW_AVX512_DISPATCH
+TEST(KSW2Kernels, AVX512SameAsSSE41)
+{
+    if (__builtin_cpu_supports("avx512f") == 0 || __builtin_cpu_supports("avx512bw") == 0) {
+        return;
+    }
+    HelperCompareKernels(ksw_extz2_avx512, ksw_extd2_avx512, 13);
+    HelperCompareSpliceKernels(ksw_exts2_avx512, 19);
+}
+#endif
+
+}  // namespace Test
+}  // namespace Pancake
+}  // namespace PacBio
+
+#endif
@@ -119,3 +119,74 @@ TEST(LIS, RealTest1)
 
     ASSERT_EQ(expected, result);
 }
+
+TEST(LIS, ReusedBuffersSameAsSingleCall)
+{
+    /*
+     * The same buffers are reused for several inputs and ranges, and the results
+     * should be identical to the ones computed with fresh memory.
+    */
+    std::vector<Point> data1 = {
+        {4342, 24},   {4349, 31},   {4353, 38},   {4940, 1113}, {4975, 679},  {4983, 687},
+        {5035, 947},  {5035, 1040}, {5035, 1101}, {5043, 1046}, {5043, 1108}, {5048, 1113},
+        {5048, 1228}, {5065, 1299}, {5072, 846},  {5074, 848},  {5095, 947},  {5095, 1040},
+    };
+    std::vector<Point> data2 = {
+        {1, 1}, {2, 2}, {3, 1}, {4, 4}, {5, 5},
+    };
+
+    std::vector<int64_t> dp;
+    std::vector<int64_t> pred;
+    std::vector<Point> result;
+
+    // Tuple: <data, begin, end>
+    const std::vector<std::tuple<const std::vector<Point>*, int64_t, int64_t>> testData = {
+        {&data1, 0, static_cast<int64_t>(data1.size())},
+        {&data2, 0, static_cast<int64_t>(data2.size())},
+        {&data1, 3, 12},
+        {&data2, 2, 2},
+        {&data2, 1, 4},
+    };
+
+    for (const auto& data : testData) {
+        const auto& points = *std::get<0>(data);
+        const int64_t begin = std::get<1>(data);
+        const int64_t end = std::get<2>(data);
+        const std::vector<Point> expected = istl::LIS<Point>(points, begin, end, ComparisonLIS);
+        istl::LIS<Point>(points, begin, end, ComparisonLIS, dp, pred, result);
+        EXPECT_EQ(expected, result);
+    }
+}
+
+TEST(LIS, IndicesWithInlinedComparisonSameAsPoints)
+{
+    /*
+     * Computing the LIS over an array of indices, with a lambda which compares
+     * the referenced points, should select the same points as the LIS over
+     * the points themselves.
+    */
+    const std::vector<Point> points = {
+        {4342, 24},   {4349, 31},   {4353, 38},   {4940, 1113}, {4975, 679},  {4983, 687},
+        {5035, 947},  {5035, 1040}, {5035, 1101}, {5043, 1046}, {5043, 1108}, {5048, 1113},
+        {5048, 1228}, {5065, 1299}, {5072, 846},  {5074, 848},  {5095, 947},  {5095, 1040},
+    };
+    const std::vector<Point> expected = istl::LIS<Point>(points, 0, points.size(), ComparisonLIS);
+
+    std::vector<int32_t> ids(points.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ids[i] = i;
+    }
+    auto CompareIds = [&points](const int32_t a, const int32_t b) {
+        return points[a].x < points[b].x && points[a].y < points[b].y;
+    };
+    std::vector<int64_t> dp;
+    std::vector<int64_t> pred;
+    std::vector<int32_t> lisIds;
+    istl::LIS(ids, 0, ids.size(), CompareIds, dp, pred, lisIds);
+
+    std::vector<Point> result;
+    for (const auto& id : lisIds) {
+        result.emplace_back(points[id]);
+    }
+    EXPECT_EQ(expected, result);
+}
@@ -2,6 +2,8 @@
 #include <pacbio/pancake/Minimizers.h>
 #include <pacbio/pancake/Seed.h>
 #include <pacbio/util/CommonTypes.h>
+#include <tuple>
+#include <vector>
 // #include <iostream>
 
 using namespace PacBio::Pancake;
@@ -709,3 +711,40 @@ TEST(GenerateMinimizers, FromStrings)
     EXPECT_EQ(expectedSeeds, results);
     EXPECT_EQ(expectedSequenceLengths, sequenceLengths);
 }
+
+TEST(SubsampleRepetitiveQuerySeeds, VariousInputs)
+{
+    /*
+     * Keys which repeat more than maxOccurrences times in the query should be
+     * reduced to exactly maxOccurrences occurrences, evenly spread.
+    */
+    auto MakeSeeds = [](const std::vector<uint64_t>& keys) {
+        std::vector<PacBio::Pancake::Int128t> seeds;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            seeds.emplace_back(PacBio::Pancake::SeedDB::Seed::Encode(keys[i], 15, 0, i, false));
+        }
+        return seeds;
+    };
+
+    // Tuple: <keys, maxOccurrences, expected keep>
+    const std::vector<std::tuple<std::vector<uint64_t>, int32_t, std::vector<uint8_t>>> testData = {
+        // Empty input.
+        {std::vector<uint64_t>(), 2, std::vector<uint8_t>()},
+        // Turned off.
+        {{7, 7, 7, 7}, 0, {1, 1, 1, 1}},
+        // No key repeats more than allowed.
+        {{1, 2, 1, 3, 2}, 2, {1, 1, 1, 1, 1}},
+        // Key 7 occurs 6 times and is reduced to 2 occurrences, key 5 to 2 out of 3.
+        {{7, 5, 7, 7, 5, 7, 7, 5, 7, 1}, 2, {1, 1, 0, 0, 0, 1, 0, 1, 0, 1}},
+        // Only the first occurrence is kept.
+        {{4, 4, 4, 4}, 1, {1, 0, 0, 0}},
+    };
+
+    for (const auto& data : testData) {
+        const auto seeds = MakeSeeds(std::get<0>(data));
+        std::vector<uint8_t> result;
+        PacBio::Pancake::SeedDB::SubsampleRepetitiveQuerySeeds(result, seeds.data(), seeds.size(),
+                                                               std::get<1>(data));
+        EXPECT_EQ(std::get<2>(data), result);
+    }
+}
@@ -0,0 +1,92 @@
+// Authors: Ivan Sovic
+
+#include <gtest/gtest.h>
+#include <pacbio/pancake/SeedHit.h>
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <tuple>
+#include <vector>
+
+namespace {
+std::vector<std::tuple<int32_t, int32_t, int32_t, int32_t>> HitsToTuples(
+    const std::vector<PacBio::Pancake::SeedHit>& hits)
+{
+    std::vector<std::tuple<int32_t, int32_t, int32_t, int32_t>> ret;
+    for (const auto& hit : hits) {
+        ret.emplace_back(PacBio::Pancake::PackSeedHitWithDiagonalToTuple(hit));
+    }
+    return ret;
+}
+}  // namespace
+
+TEST(SeedHit, SortSeedHitsByDiagonal_EmptyInput)
+{
+    std::vector<PacBio::Pancake::SeedHit> hits;
+    PacBio::Pancake::SortSeedHitsByDiagonal(hits);
+    EXPECT_TRUE(hits.empty());
+}
+
+TEST(SeedHit, SortSeedHitsByDiagonal_SmallHandmade)
+{
+    /*
+     * Includes negative diagonals and both strands.
+    */
+    // clang-format off
+    std::vector<PacBio::Pancake::SeedHit> hits = {
+        {1, true, 100, 50, 15, 15, 0},
+        {0, false, 10, 200, 15, 15, 0},
+        {1, false, 100, 50, 15, 15, 0},
+        {0, false, 300, 10, 15, 15, 0},
+        {0, false, 5, 195, 15, 15, 0},
+        {0, true, 0, 0, 15, 15, 0},
+    };
+    const std::vector<PacBio::Pancake::SeedHit> expected = {
+        {0, false, 5, 195, 15, 15, 0},
+        {0, false, 10, 200, 15, 15, 0},
+        {0, false, 300, 10, 15, 15, 0},
+        {0, true, 0, 0, 15, 15, 0},
+        {1, false, 100, 50, 15, 15, 0},
+        {1, true, 100, 50, 15, 15, 0},
+    };
+    // clang-format on
+
+    PacBio::Pancake::SortSeedHitsByDiagonal(hits);
+    EXPECT_EQ(expected, hits);
+}
+
+TEST(SeedHit, SortSeedHitsByDiagonal_SameAsComparatorSort)
+{
+    /*
+     * Random hits are sorted with the radix sort and with std::sort using the
+     * PackSeedHitWithDiagonalToTuple comparator. The order of the sorting components
+     * needs to be identical, and the radix sort needs to be a permutation of the input.
+    */
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int32_t> distTargetId(0, 20);
+    std::uniform_int_distribution<int32_t> distStrand(0, 1);
+    std::uniform_int_distribution<int32_t> distPos(0, 5000);
+    std::uniform_int_distribution<int32_t> distSpan(10, 20);
+
+    for (int32_t numHits : {1, 2, 10, 1000, 50000}) {
+        std::vector<PacBio::Pancake::SeedHit> hits;
+        for (int32_t i = 0; i < numHits; ++i) {
+            hits.emplace_back(PacBio::Pancake::SeedHit(distTargetId(rng), distStrand(rng),
+                                                       distPos(rng), distPos(rng), distSpan(rng),
+                                                       distSpan(rng), 0));
+        }
+
+        std::vector<PacBio::Pancake::SeedHit> expected = hits;
+        std::stable_sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) {
+            return PacBio::Pancake::PackSeedHitWithDiagonalToTuple(a) <
+                   PacBio::Pancake::PackSeedHitWithDiagonalToTuple(b);
+        });
+
+        std::vector<PacBio::Pancake::SeedHit> results = hits;
+        PacBio::Pancake::SortSeedHitsByDiagonal(results);
+
+        // Ties keep their input order, same as the stable sort.
+        EXPECT_EQ(HitsToTuples(expected), HitsToTuples(results));
+        EXPECT_EQ(expected, results);
+    }
+}
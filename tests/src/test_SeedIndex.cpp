@@ -5,6 +5,9 @@
 #include <pacbio/pancake/Seed.h>
 #include <pacbio/pancake/SeedIndex.h>
 #include <pacbio/util/CommonTypes.h>
+#include <algorithm>
+#include <numeric>
+#include <random>
 #include <sstream>
 #include <tuple>
 
@@ -433,6 +436,74 @@ B	0	0	1	96
     EXPECT_EQ(expected, results);
 }
 
+TEST(SeedIndex, ComputeQueryFreqCutoffHitBudget)
+{
+    /*
+     * Tests lowering the frequency cutoff for a single query so that the
+     * number of collected hits fits the given budget.
+     * Key frequencies in the index: 0 -> 2, 123 -> 3, 5 -> 3, 7 -> 1.
+     * Using all target seeds as the query, there are 23 hits in total.
+    */
+    const int32_t targetId = 0;
+    std::vector<PacBio::Pancake::SeedDB::SeedRaw> targetSeeds = {
+        PacBio::Pancake::SeedDB::Seed::Encode(0, targetId, 0, false),
+        PacBio::Pancake::SeedDB::Seed::Encode(123, targetId, 1, false),
+        PacBio::Pancake::SeedDB::Seed::Encode(5, targetId, 2, false),
+        PacBio::Pancake::SeedDB::Seed::Encode(7, targetId, 3, false),
+        PacBio::Pancake::SeedDB::Seed::Encode(5, targetId, 4, false),
+        PacBio::Pancake::SeedDB::Seed::Encode(0, targetId, 5, false),
+        PacBio::Pancake::SeedDB::Seed::Encode(123, targetId, 6, false),
+        PacBio::Pancake::SeedDB::Seed::Encode(5, targetId, 7, false),
+        PacBio::Pancake::SeedDB::Seed::Encode(123, targetId, 8, false),
+    };
+    const std::vector<PacBio::Pancake::SeedDB::SeedRaw> querySeeds = targetSeeds;
+    const std::vector<PacBio::Pancake::SeedDB::SeedRaw> queryRepeatSeeds = {
+        PacBio::Pancake::SeedDB::Seed::Encode(123, targetId, 0, false),
+        PacBio::Pancake::SeedDB::Seed::Encode(123, targetId, 1, false),
+        PacBio::Pancake::SeedDB::Seed::Encode(123, targetId, 2, false),
+    };
+    const int32_t queryLen = 38;
+
+    const PacBio::Pancake::SeedDB::SeedDBParameters seedParams{30, 80, 0, false, true, 10, true};
+    const std::vector<int32_t> targetLengths = {queryLen};
+    PacBio::Pancake::SeedIndex si(seedParams, targetLengths, std::move(targetSeeds));
+
+    // Tuple: <query, global freqCutoff, maxHits, expected cutoff, expected capped, expected num hits>
+    const std::vector<std::tuple<const std::vector<PacBio::Pancake::SeedDB::SeedRaw>*, int64_t,
+                                 int64_t, int64_t, bool, int64_t>>
+        testData = {
+            // No budget.
+            {&querySeeds, 0, 0, 0, false, 23},
+            // Budget is not exceeded.
+            {&querySeeds, 0, 23, 0, false, 23},
+            {&querySeeds, 2, 5, 2, false, 5},
+            // Keys with frequency 3 are dropped.
+            {&querySeeds, 0, 22, 2, true, 5},
+            {&querySeeds, 0, 5, 2, true, 5},
+            // Keys with frequency 3 and 2 are dropped.
+            {&querySeeds, 0, 4, 1, true, 1},
+            {&querySeeds, 2, 4, 1, true, 1},
+            // The least frequent keys are always kept.
+            {&querySeeds, 0, 1, 1, true, 1},
+            {&queryRepeatSeeds, 0, 2, 3, true, 9},
+        };
+
+    for (const auto& data : testData) {
+        const auto& query = *std::get<0>(data);
+        const int64_t freqCutoff = std::get<1>(data);
+        const int64_t maxHits = std::get<2>(data);
+        bool capped = false;
+        const int64_t result =
+            si.ComputeQueryFreqCutoff(query.data(), query.size(), freqCutoff, maxHits, capped);
+        EXPECT_EQ(std::get<3>(data), result);
+        EXPECT_EQ(std::get<4>(data), capped);
+
+        std::vector<PacBio::Pancake::SeedHit> hits;
+        si.CollectHits(query, queryLen, hits, result);
+        EXPECT_EQ(std::get<5>(data), static_cast<int64_t>(hits.size()));
+    }
+}
+
 TEST(SeedIndex, CollectHitsReverseStrand)
 {
     /*
@@ -547,6 +618,154 @@ B	0	0	1	96
     EXPECT_EQ(expected, results);
 }
 
+TEST(SeedIndex, CollectHitsMergeJoinSameAsHash)
+{
+    /*
+     * The merge-join and the hash lookup strategies should produce identical
+     * hits, in identical order.
+     * Keys are drawn from a small pool so that there are plenty of repeats, and
+     * some of the keys use the top key bit to check that the sort order of the
+     * target seeds is followed correctly. Those keys have to produce hits as well.
+    */
+    const int32_t k = 28;
+    const int32_t numTargets = 3;
+    const int32_t targetLen = 10000;
+    const uint64_t topKeyBit = static_cast<uint64_t>(1) << 55;
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<uint64_t> distKey(0, 499);
+    std::uniform_int_distribution<int32_t> distPos(0, targetLen - k);
+    std::uniform_int_distribution<int32_t> distBool(0, 1);
+    auto RandomKey = [&]() {
+        const uint64_t key = distKey(gen);
+        return (key % 3 == 0) ? (key | topKeyBit) : key;
+    };
+
+    std::vector<PacBio::Pancake::SeedDB::SeedRaw> targetSeeds;
+    for (int32_t i = 0; i < 5000; ++i) {
+        targetSeeds.emplace_back(PacBio::Pancake::SeedDB::Seed::Encode(
+            RandomKey(), k, i % numTargets, distPos(gen), distBool(gen)));
+    }
+    std::vector<PacBio::Pancake::SeedDB::SeedRaw> querySeeds;
+    for (int32_t i = 0; i < 300; ++i) {
+        querySeeds.emplace_back(
+            PacBio::Pancake::SeedDB::Seed::Encode(RandomKey(), k, 0, distPos(gen), distBool(gen)));
+    }
+    // A key which doesn't exist in the index.
+    querySeeds.emplace_back(PacBio::Pancake::SeedDB::Seed::Encode(100000, k, 0, 0, false));
+    const int32_t queryLen = targetLen;
+
+    const PacBio::Pancake::SeedDB::SeedDBParameters seedParams{k, 10, 0, false, true, 255, true};
+    const std::vector<int32_t> targetLengths(numTargets, targetLen);
+    PacBio::Pancake::SeedIndex si(seedParams, targetLengths, std::move(targetSeeds));
+
+    for (const int64_t freqCutoff : {0, 5, 15}) {
+        for (const int32_t maxQueryKeyOccurrences : {0, 1, 2}) {
+            std::vector<PacBio::Pancake::SeedHit> resultsHash;
+            std::vector<PacBio::Pancake::SeedHit> resultsMergeJoin;
+            si.CollectHitsHash(querySeeds.data(), querySeeds.size(), queryLen, resultsHash,
+                               freqCutoff, maxQueryKeyOccurrences);
+            si.CollectHitsMergeJoin(querySeeds.data(), querySeeds.size(), queryLen,
+                                    resultsMergeJoin, freqCutoff, maxQueryKeyOccurrences);
+            EXPECT_FALSE(resultsHash.empty());
+            EXPECT_EQ(resultsHash, resultsMergeJoin);
+        }
+    }
+
+    // Only the query seeds with the top key bit set.
+    std::vector<PacBio::Pancake::SeedDB::SeedRaw> topBitQuerySeeds;
+    for (const auto& seed : querySeeds) {
+        if ((PacBio::Pancake::SeedDB::Seed(seed).key & topKeyBit) != 0) {
+            topBitQuerySeeds.emplace_back(seed);
+        }
+    }
+    ASSERT_FALSE(topBitQuerySeeds.empty());
+    std::vector<PacBio::Pancake::SeedHit> resultsHash;
+    std::vector<PacBio::Pancake::SeedHit> resultsMergeJoin;
+    si.CollectHitsHash(topBitQuerySeeds.data(), topBitQuerySeeds.size(), queryLen, resultsHash, 0);
+    si.CollectHitsMergeJoin(topBitQuerySeeds.data(), topBitQuerySeeds.size(), queryLen,
+                            resultsMergeJoin, 0);
+    EXPECT_FALSE(resultsHash.empty());
+    EXPECT_EQ(resultsHash, resultsMergeJoin);
+}
+
+TEST(SeedIndex, CollectHitsIntoDiagonalBucketsSameAsSortedHits)
+{
+    /*
+     * Collecting the hits directly into diagonal buckets should produce exactly
+     * the same hits, in the same order, as collecting them and then sorting
+     * them with SortSeedHitsByDiagonal. This should hold for any bucket width,
+     * including the negative diagonals.
+    */
+    const int32_t k = 28;
+    const int32_t numTargets = 3;
+    const int32_t targetLen = 10000;
+
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<uint64_t> distKey(0, 299);
+    std::uniform_int_distribution<int32_t> distPos(0, targetLen - k);
+    std::uniform_int_distribution<int32_t> distBool(0, 1);
+
+    std::vector<PacBio::Pancake::SeedDB::SeedRaw> targetSeeds;
+    for (int32_t i = 0; i < 5000; ++i) {
+        targetSeeds.emplace_back(PacBio::Pancake::SeedDB::Seed::Encode(
+            distKey(gen), k, i % numTargets, distPos(gen), distBool(gen)));
+    }
+    std::vector<PacBio::Pancake::SeedDB::SeedRaw> querySeeds;
+    for (int32_t i = 0; i < 300; ++i) {
+        querySeeds.emplace_back(
+            PacBio::Pancake::SeedDB::Seed::Encode(distKey(gen), k, 0, distPos(gen), distBool(gen)));
+    }
+    const int32_t queryLen = targetLen;
+
+    const PacBio::Pancake::SeedDB::SeedDBParameters seedParams{k, 10, 0, false, true, 255, true};
+    const std::vector<int32_t> targetLengths(numTargets, targetLen);
+    PacBio::Pancake::SeedIndex si(seedParams, targetLengths, std::move(targetSeeds));
+
+    // The full query is dense enough for the merge-join lookup, and the first 100 seeds
+    // use the hash lookup. The same scratch is reused for all the calls.
+    PacBio::Pancake::DiagonalBucketScratch scratch;
+    for (const int64_t querySeedsSize : {300, 100}) {
+        for (const int64_t freqCutoff : {0, 15}) {
+            for (const int32_t maxQueryKeyOccurrences : {0, 2}) {
+                std::vector<PacBio::Pancake::SeedHit> expected;
+                si.CollectHits(querySeeds.data(), querySeedsSize, queryLen, expected, freqCutoff,
+                               maxQueryKeyOccurrences);
+                PacBio::Pancake::SortSeedHitsByDiagonal(expected);
+                ASSERT_FALSE(expected.empty());
+
+                for (const int32_t bucketWidth : {1, 7, 100, 500, 100000}) {
+                    std::vector<PacBio::Pancake::SeedHit> results;
+                    const bool rv = si.CollectHitsIntoDiagonalBuckets(
+                        querySeeds.data(), querySeedsSize, queryLen, results, freqCutoff,
+                        bucketWidth, maxQueryKeyOccurrences);
+                    EXPECT_TRUE(rv);
+                    EXPECT_EQ(expected, results);
+
+                    std::vector<PacBio::Pancake::SeedHit> resultsScratch;
+                    si.CollectHitsIntoDiagonalBuckets(querySeeds.data(), querySeedsSize, queryLen,
+                                                      resultsScratch, freqCutoff, bucketWidth,
+                                                      scratch, maxQueryKeyOccurrences);
+                    EXPECT_EQ(expected, resultsScratch);
+                }
+            }
+        }
+    }
+
+    // No hits.
+    const std::vector<PacBio::Pancake::SeedDB::SeedRaw> missingSeeds = {
+        PacBio::Pancake::SeedDB::Seed::Encode(100000, k, 0, 0, false)};
+    std::vector<PacBio::Pancake::SeedHit> results;
+    EXPECT_FALSE(si.CollectHitsIntoDiagonalBuckets(missingSeeds.data(), missingSeeds.size(),
+                                                   queryLen, results, 0, 100));
+    EXPECT_TRUE(results.empty());
+
+    // Invalid bucket width.
+    EXPECT_THROW(si.CollectHitsIntoDiagonalBuckets(querySeeds.data(), querySeeds.size(), queryLen,
+                                                   results, 0, 0),
+                 std::runtime_error);
+}
+
 TEST(SeedIndex, ComputeFrequencyStatsEmptyIndex)
 {
     /*
@@ -628,6 +847,63 @@ TEST(SeedIndex, ComputeFrequencyStatsNormal)
         std::make_tuple(resultFreqMax, resultFreqAvg, resultFreqMedian, resultFreqCutoff));
 }
 
+TEST(SeedIndex, ComputeFrequencyStatsMatchesSortedFrequencies)
+{
+    /*
+     * Compares the seed statistics against values computed directly
+     * from a sorted list of key frequencies, for several percentiles.
+    */
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int32_t> distNumKeys(0, 1000);
+    std::uniform_int_distribution<int32_t> distFreq(1, 50);
+
+    // Generate keys with random frequencies.
+    std::vector<PacBio::Pancake::Int128t> inSeeds;
+    std::vector<int64_t> freqs;
+    const int32_t numKeys = 500 + distNumKeys(gen);
+    for (int32_t key = 0; key < numKeys; ++key) {
+        // Make a few very frequent keys.
+        const int32_t freq = (key % 97 == 0) ? (1000 + key) : distFreq(gen);
+        for (int32_t i = 0; i < freq; ++i) {
+            inSeeds.emplace_back(PacBio::Pancake::SeedDB::Seed::Encode(key, 0, i, false));
+        }
+        freqs.emplace_back(freq);
+    }
+    std::sort(freqs.begin(), freqs.end());
+    const int64_t n = freqs.size();
+
+    // Dummy SeedDB cache.
+    // No cache information is needed for this test.
+    std::shared_ptr<PacBio::Pancake::SeedDBIndexCache> dummySeedDBCache(
+        new PacBio::Pancake::SeedDBIndexCache);
+    PacBio::Pancake::SeedIndex si(dummySeedDBCache, std::move(inSeeds));
+
+    for (const double freqPercentile : {0.0, 0.0002, 0.01, 0.1, 0.5, 0.9, 1.0}) {
+        // Expected results.
+        const int64_t cutoffId =
+            std::max(0.0, std::floor(static_cast<double>(n) * (1.0 - freqPercentile)));
+        const int64_t expectedFreqMax = freqs.back();
+        const int64_t expectedFreqCutoff = (cutoffId >= n) ? (freqs.back() + 1) : freqs[cutoffId];
+        const double expectedFreqAvg =
+            static_cast<double>(std::accumulate(freqs.begin(), freqs.end(), 0)) / n;
+        const double expectedFreqMedian =
+            (static_cast<double>(freqs[n / 2]) + static_cast<double>(freqs[(n - 1) / 2])) / 2.0;
+
+        // Run the unit under test.
+        int64_t resultFreqMax = 0;
+        double resultFreqAvg = 0.0;
+        double resultFreqMedian = 0.0;
+        int64_t resultFreqCutoff = 0;
+        si.ComputeFrequencyStats(freqPercentile, resultFreqMax, resultFreqAvg, resultFreqMedian,
+                                 resultFreqCutoff);
+
+        // Evaluate.
+        EXPECT_EQ(std::make_tuple(expectedFreqMax, expectedFreqMedian, expectedFreqCutoff),
+                  std::make_tuple(resultFreqMax, resultFreqMedian, resultFreqCutoff));
+        EXPECT_DOUBLE_EQ(expectedFreqAvg, resultFreqAvg);
+    }
+}
+
 TEST(SeedIndex, ComputeFrequencyThresholdOutOfBounds)
 {
     /*
@@ -4,6 +4,7 @@
 #include <gtest/gtest.h>
 #include <pacbio/pancake/SeqDBReader.h>
 #include <pacbio/pancake/SeqDBReaderCachedBlock.h>
+#include <pacbio/util/Util.h>
 #include <iostream>
 
 TEST(SeqDBReaderCachedBlock, BatchCompareWithSeqDBReader_UncompressedInput)
@@ -415,6 +416,48 @@ TEST(SeqDBReaderCachedBlock, LoadAndHPCompress_From_in_2_small)
     }
 }
 
+TEST(SeqDBReaderCachedBlock, ComputeReverseComplements)
+{
+    /*
+     * The cached reverse complements should be the same as reverse complementing each
+     * loaded sequence, also after homopolymer compression, and regardless of the number
+     * of threads. Loading a new block should release them.
+    */
+
+    const std::vector<std::string> inDBs = {
+        PacBio::PancakeTestsConfig::Data_Dir + "/seqdb-writer/test-10a-compressed-in-2-small.seqdb",
+        PacBio::PancakeTestsConfig::Data_Dir + "/seqdb-writer/test-7-uncompressed-2blocks.seqdb",
+    };
+
+    for (const auto& inSeqDB : inDBs) {
+        std::shared_ptr<PacBio::Pancake::SeqDBIndexCache> seqDBCache =
+            PacBio::Pancake::LoadSeqDBIndexCache(inSeqDB);
+
+        for (const bool useHPC : {false, true}) {
+            for (const int32_t numThreads : {1, 2, 16}) {
+                SCOPED_TRACE(inSeqDB + ", useHPC = " + std::to_string(useHPC) + ", numThreads = " +
+                             std::to_string(numThreads));
+
+                PacBio::Pancake::SeqDBReaderCachedBlock readerTest(seqDBCache, useHPC);
+                readerTest.LoadBlocks({0});
+                EXPECT_EQ(nullptr, readerTest.GetReverseComplement(readerTest.records()[0].Id()));
+
+                readerTest.ComputeReverseComplements(numThreads);
+                for (const auto& record : readerTest.records()) {
+                    const std::string expected = PacBio::Pancake::ReverseComplement(
+                        record.Bases(), record.Size(), 0, record.Size());
+                    const char* result = readerTest.GetReverseComplement(record.Id());
+                    ASSERT_NE(nullptr, result);
+                    EXPECT_EQ(expected, std::string(result, record.Size()));
+                }
+
+                readerTest.LoadBlocks({0});
+                EXPECT_EQ(nullptr, readerTest.GetReverseComplement(readerTest.records()[0].Id()));
+            }
+        }
+    }
+}
+
 TEST(SeqDBReaderCachedBlock, GetSeqDBContiguousParts_NormalSingleBlock)
 {
     /*
@@ -258,6 +258,40 @@ TEST(SES2AlignBanded_Global, AllTests)
         }
     }
 }
+
+TEST(SES2AlignBanded_Global, ReusedScratchSpace)
+{
+    /*
+     * The traceback matrix in the scratch space grows with the number of computed
+     * cells. Running all tests through one scratch space, in the forward and then in
+     * the reverse order, should give the same results as a fresh scratch space.
+    */
+    auto ss = std::make_shared<SESScratchSpace>();
+    std::vector<TestData> testData = testDataGlobal;
+    testData.insert(testData.end(), testDataGlobal.rbegin(), testDataGlobal.rend());
+    for (const auto& data : testData) {
+        SCOPED_TRACE("Global-" + data.testName);
+        Alignment::SesResults result =
+            Alignment::SES2AlignBanded<Alignment::SESAlignMode::Global,
+                                       Alignment::SESTrimmingMode::Disabled,
+                                       Alignment::SESTracebackMode::Enabled>(
+                data.query.c_str(), data.query.size(), data.target.c_str(), data.target.size(),
+                data.maxDiffs, data.bandwidth, ss);
+        EXPECT_EQ(data.expectedGlobal, result);
+    }
+}
+
+TEST(SES2AlignBanded_TracebackCell, EncodeDecode)
+{
+    for (const int32_t x : {-3, -1, 0, 1, 2, 1000, 1 << 28}) {
+        for (const int32_t prevKOffset : {-1, 0, 1}) {
+            const int32_t cell = EncodeTracebackCell(x, prevKOffset);
+            EXPECT_EQ(x, DecodeTracebackX(cell)) << "x = " << x << ", offset = " << prevKOffset;
+            EXPECT_EQ(prevKOffset + 1, DecodeTracebackDir(cell)) << "x = " << x
+                                                                 << ", offset = " << prevKOffset;
+        }
+    }
+}
 }
 }
 }
@@ -0,0 +1,127 @@
+// Authors: Ivan Sovic
+
+#include <gtest/gtest.h>
+#include <pacbio/alignment/SesMatchExtension.h>
+#include <random>
+#include <string>
+#include <tuple>
+
+namespace PacBio {
+namespace Pancake {
+namespace Alignment {
+namespace Test {
+
+int32_t CountMatchingPrefixPerBase(const char* a, const char* b, int32_t maxLen)
+{
+    int32_t moves = 0;
+    while (moves < maxLen && a[moves] == b[moves]) {
+        ++moves;
+    }
+    return moves;
+}
+
+TEST(SesMatchExtension, CountMatchingPrefix_ArrayOfTests)
+{
+    // clang-format off
+    std::vector<std::tuple<std::string, std::string, std::string, int32_t, int32_t>> testData = {
+        // Test name, a, b, maxLen, expected.
+        {"Empty", "", "", 0, 0},
+        {"NegativeMaxLen", "ACTG", "ACTG", -1, 0},
+        {"ExactMatch", "ACTG", "ACTG", 4, 4},
+        {"FirstBaseMismatch", "ACTG", "TCTG", 4, 0},
+        {"LimitedByMaxLen", "ACTGACTGACTG", "ACTGACTGACTG", 5, 5},
+        {"MismatchInWordBlock", "ACTGACTGACTG", "ACTGACTTACTG", 12, 7},
+        {"MismatchInVectorBlock", "ACTGACTGACTGACTGACTG", "ACTGACTGACTGAGTGACTG", 20, 13},
+        {"MismatchAfterVectorBlock", "ACTGACTGACTGACTGACTG", "ACTGACTGACTGACTGACTT", 20, 19},
+        {"MismatchAfterMaxLen", "ACTGACTGACTGACTGACTG", "ACTGACTGACTGACTGACTT", 18, 18},
+    };
+    // clang-format on
+
+    for (const auto& data : testData) {
+        // Inputs.
+        const std::string& testName = std::get<0>(data);
+        const std::string& a = std::get<1>(data);
+        const std::string& b = std::get<2>(data);
+        const int32_t maxLen = std::get<3>(data);
+        const int32_t expected = std::get<4>(data);
+        SCOPED_TRACE(testName);
+
+        // Run.
+        const int32_t result = CountMatchingPrefix(a.c_str(), b.c_str(), maxLen);
+
+        // Evaluate.
+        EXPECT_EQ(expected, result);
+    }
+}
+
+TEST(SesMatchExtension, CountMatchingPrefix_SameAsPerBaseComparison)
+{
+    /*
+     * Places a single mismatch at every position of sequences of various
+     * lengths, with various offsets into the buffers (unaligned loads),
+     * and compares the result with the per-base loop.
+    */
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int32_t> distBase(0, 3);
+    const std::string bases("ACGT");
+
+    for (int32_t len = 0; len <= 70; ++len) {
+        for (int32_t offset = 0; offset < 3; ++offset) {
+            std::string a(offset, 'N');
+            for (int32_t i = 0; i < len; ++i) {
+                a += bases[distBase(gen)];
+            }
+            for (int32_t mismatchPos = 0; mismatchPos <= len; ++mismatchPos) {
+                std::string b = a;
+                if (mismatchPos < len) {
+                    b[offset + mismatchPos] = 'N';
+                }
+                const int32_t expected =
+                    CountMatchingPrefixPerBase(a.c_str() + offset, b.c_str() + offset, len);
+                const int32_t result =
+                    CountMatchingPrefix(a.c_str() + offset, b.c_str() + offset, len);
+                EXPECT_EQ(expected, result) << "len = " << len << ", offset = " << offset
+                                            << ", mismatchPos = " << mismatchPos;
+            }
+        }
+    }
+}
+
+TEST(SesMatchExtension, ApplyMatchesToTrimmingWindow_SameAsPerBaseUpdate)
+{
+    /*
+     * The bulk update of the trimming window should produce the same
+     * bit history and match count as applying the matches one by one.
+    */
+    const uint64_t C = 60;
+    const uint64_t MASKC = static_cast<uint64_t>(1) << (C - 1);
+    std::mt19937_64 gen(11);
+
+    for (int32_t numMatches = 0; numMatches <= 130; ++numMatches) {
+        for (int32_t trial = 0; trial < 20; ++trial) {
+            const uint64_t bStart = gen();
+            const int32_t mStart = static_cast<int32_t>(gen() % 100);
+
+            uint64_t expectedB = bStart;
+            int32_t expectedM = mStart;
+            for (int32_t i = 0; i < numMatches; ++i) {
+                if ((expectedB & MASKC) == 0) {
+                    ++expectedM;
+                }
+                expectedB = (expectedB << 1) | 1;
+            }
+
+            uint64_t resultB = bStart;
+            int32_t resultM = mStart;
+            ApplyMatchesToTrimmingWindow(resultB, resultM, numMatches, C);
+
+            EXPECT_EQ(expectedM, resultM) << "numMatches = " << numMatches;
+            EXPECT_EQ(expectedB, resultB) << "numMatches = " << numMatches;
+        }
+    }
+}
+
+}  // namespace Test
+}  // namespace Alignment
+}  // namespace Pancake
+}  // namespace PacBio
@@ -0,0 +1,126 @@
+// Authors: Ivan Sovic
+
+#include <PancakeTestData.h>
+#include <gtest/gtest.h>
+#include <pacbio/pancake/Minimizers.h>
+#include <pacbio/pancake/SeedDBIndexCache.h>
+#include <pacbio/pancake/SeedIndex.h>
+#include <pacbio/pancake/SeqDBReaderCachedBlock.h>
+#include <pacbio/pancake/SharedTargetBlock.h>
+#include <cstdio>
+#include <iostream>
+#include <tuple>
+
+TEST(SharedTargetBlock, RoundTrip_CompareWithInMemoryIndex)
+{
+    /*
+     * Writes a target block (sequences and seeds) into a shared file, maps
+     * it back and compares the sequences, seeds and the collected hits
+     * with the in-memory versions.
+    */
+
+    const std::string inSeqDB =
+        PacBio::PancakeTestsConfig::Data_Dir + "/seqdb-writer/test-7-uncompressed-2blocks.seqdb";
+    const std::string outFile =
+        PacBio::PancakeTestsConfig::GeneratedData_Dir + "/test-shared-target-block.bin";
+    const int32_t blockId = 0;
+
+    // Load the target sequences.
+    std::shared_ptr<PacBio::Pancake::SeqDBIndexCache> seqDBCache =
+        PacBio::Pancake::LoadSeqDBIndexCache(inSeqDB);
+    PacBio::Pancake::SeqDBReaderCachedBlock seqReader(seqDBCache, false);
+    seqReader.LoadBlocks({blockId});
+    std::vector<std::string> targetSeqs;
+    for (const auto& record : seqReader.records()) {
+        targetSeqs.emplace_back(std::string(record.Bases(), record.Size()));
+    }
+
+    // Compute the seeds and build the in-memory index.
+    std::shared_ptr<PacBio::Pancake::SeedDBIndexCache> seedDBCache(
+        new PacBio::Pancake::SeedDBIndexCache);
+    seedDBCache->seedParams.KmerSize = 15;
+    seedDBCache->seedParams.MinimizerWindow = 5;
+    std::vector<PacBio::Pancake::Int128t> seeds;
+    std::vector<int32_t> seqLengths;
+    PacBio::Pancake::SeedDB::GenerateMinimizers(
+        seeds, seqLengths, targetSeqs, seedDBCache->seedParams.KmerSize,
+        seedDBCache->seedParams.MinimizerWindow, seedDBCache->seedParams.Spacing,
+        seedDBCache->seedParams.UseRC, seedDBCache->seedParams.UseHPC,
+        seedDBCache->seedParams.MaxHPCLen);
+    for (const auto& len : seqLengths) {
+        PacBio::Pancake::SeedDBSeedsLine sl;
+        sl.numBases = len;
+        seedDBCache->seedLines.emplace_back(sl);
+    }
+    const std::vector<PacBio::Pancake::Int128t> querySeeds = seeds;
+    PacBio::Pancake::SeedIndex indexInMemory(seedDBCache, std::move(seeds));
+
+    // Write and map the shared block.
+    PacBio::Pancake::SharedTargetBlock::Write(outFile, blockId, seqReader, false, indexInMemory);
+    PacBio::Pancake::SharedTargetBlock shared(outFile);
+
+    // Evaluate the header info.
+    EXPECT_EQ(blockId, shared.TargetBlockId());
+    EXPECT_EQ(false, shared.SeqsUseHPC());
+    EXPECT_EQ(seedDBCache->seedParams, shared.SeedParams());
+
+    // Evaluate the sequences.
+    ASSERT_EQ(seqReader.records().size(), shared.Records().size());
+    for (size_t i = 0; i < shared.Records().size(); ++i) {
+        const auto& expected = seqReader.records()[i];
+        const auto& result = shared.Records()[i];
+        EXPECT_EQ(expected.Name(), result.Name());
+        EXPECT_EQ(expected.Id(), result.Id());
+        EXPECT_EQ(std::string(expected.Bases(), expected.Size()),
+                  std::string(result.Bases(), result.Size()));
+    }
+
+    // Evaluate the seeds.
+    ASSERT_EQ(indexInMemory.GetNumSeeds(), shared.NumSeeds());
+    const std::vector<PacBio::Pancake::Int128t> expectedSeeds(
+        indexInMemory.GetSortedSeeds(), indexInMemory.GetSortedSeeds() + shared.NumSeeds());
+    const std::vector<PacBio::Pancake::Int128t> resultSeeds(shared.Seeds(),
+                                                            shared.Seeds() + shared.NumSeeds());
+    EXPECT_EQ(expectedSeeds, resultSeeds);
+
+    // The index over the mapped seeds should give the same hits and statistics.
+    PacBio::Pancake::SeedIndex indexShared(seedDBCache, shared.Seeds(), shared.NumSeeds());
+    std::vector<PacBio::Pancake::SeedHit> expectedHits;
+    std::vector<PacBio::Pancake::SeedHit> resultHits;
+    indexInMemory.CollectHits(querySeeds, 0, expectedHits, 0);
+    indexShared.CollectHits(querySeeds, 0, resultHits, 0);
+    EXPECT_EQ(expectedHits, resultHits);
+
+    int64_t expectedFreqMax = 0, resultFreqMax = 0;
+    double expectedFreqAvg = 0.0, resultFreqAvg = 0.0;
+    double expectedFreqMedian = 0.0, resultFreqMedian = 0.0;
+    int64_t expectedFreqCutoff = 0, resultFreqCutoff = 0;
+    indexInMemory.ComputeFrequencyStats(0.01, expectedFreqMax, expectedFreqAvg, expectedFreqMedian,
+                                        expectedFreqCutoff);
+    indexShared.ComputeFrequencyStats(0.01, resultFreqMax, resultFreqAvg, resultFreqMedian,
+                                      resultFreqCutoff);
+    EXPECT_EQ(
+        std::make_tuple(expectedFreqMax, expectedFreqAvg, expectedFreqMedian, expectedFreqCutoff),
+        std::make_tuple(resultFreqMax, resultFreqAvg, resultFreqMedian, resultFreqCutoff));
+
+    // The reader can use the mapped sequences directly.
+    PacBio::Pancake::SeqDBReaderCachedBlock sharedReader(seqDBCache, false);
+    sharedReader.LoadExternalRecords(shared.Records());
+    for (const auto& record : seqReader.records()) {
+        const auto& result = sharedReader.GetSequence(record.Id());
+        EXPECT_EQ(std::string(record.Bases(), record.Size()),
+                  std::string(result.Bases(), result.Size()));
+    }
+
+    std::remove(outFile.c_str());
+}
+
+TEST(SharedTargetBlock, InvalidFileShouldThrow)
+{
+    /*
+     * A file which is not a shared target block should not be attached.
+    */
+    const std::string inSeqDB =
+        PacBio::PancakeTestsConfig::Data_Dir + "/seqdb-writer/test-7-uncompressed-2blocks.seqdb";
+    EXPECT_THROW({ PacBio::Pancake::SharedTargetBlock shared(inSeqDB); }, std::runtime_error);
+}
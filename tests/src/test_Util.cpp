@@ -91,3 +91,31 @@ TEST(Util, JoinPathWindows)
         EXPECT_EQ(expected, result);
     }
 }
+
+TEST(Util, ReverseComplementIntoBuffer)
+{
+    // Tuple: <seq, start, end, expected>
+    std::vector<std::tuple<std::string, int64_t, int64_t, std::string>> testData = {
+        {"", 0, 0, ""},
+        {"A", 0, 1, "T"},
+        {"ACTG", 0, 4, "CAGT"},
+        {"AACCGGTTA", 0, 9, "TAACCGGTT"},
+        {"AACCGGTTA", 2, 7, "ACCGG"},
+        {"AACCGGTTA", 8, 9, "T"},
+    };
+
+    // The same buffer is reused for all inputs.
+    std::string result = "some previous content";
+    for (const auto& data : testData) {
+        const auto& seq = std::get<0>(data);
+        const int64_t start = std::get<1>(data);
+        const int64_t end = std::get<2>(data);
+        const auto& expected = std::get<3>(data);
+        PacBio::Pancake::ReverseComplement(seq.c_str(), seq.size(), start, end, result);
+        EXPECT_EQ(expected, result);
+    }
+
+    std::string buffer;
+    EXPECT_THROW({ PacBio::Pancake::ReverseComplement("ACTG", 4, 2, 1, buffer); },
+                 std::runtime_error);
+}